@@ -0,0 +1,49 @@
+#!/usr/bin/env bash
+# Runs ActionSystem.NetBench on loopback: one headless dedicated server and CLIENTS headless clients.
+# Results are written by the server to <Project>/Saved/Profiling/ActionSystem/NetBench-<time>.json
+#
+# Usage: UE4_ROOT=/path/to/UnrealEngine Scripts/RunNetBench.sh [clients] [bots] [seconds per phase]
+# Extra server command line arguments can be passed in NETBENCH_SERVER_ARGS, e.g. "-trace=net -NetTrace=1"
+# to also capture a Networking Insights trace with the per-property bit counts.
+
+set -euo pipefail
+
+CLIENTS=${1:-4}
+BOTS=${2:-100}
+DURATION=${3:-30}
+PORT=${NETBENCH_PORT:-7777}
+MAP=${NETBENCH_MAP:-/Game/TestMap}
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+PROJECT="$(cd "$SCRIPT_DIR/../../.." && pwd)/ActionSystem.uproject"
+EDITOR="${UE4_ROOT:?Set UE4_ROOT to the engine directory}/Engine/Binaries/Linux/UE4Editor"
+LOG_DIR="$(dirname "$PROJECT")/Saved/Logs/NetBench"
+mkdir -p "$LOG_DIR"
+
+COMMON_ARGS=(-nullrhi -nosound -unattended -nosplash -NoVerifyGC -stdout -FullStdOutLogOutput)
+
+"$EDITOR" "$PROJECT" "$MAP" -server -port="$PORT" "${COMMON_ARGS[@]}" ${NETBENCH_SERVER_ARGS:-} \
+	-ExecCmds="ActionSystem.NetBench Bots=$BOTS Clients=$CLIENTS Duration=$DURATION Quit" \
+	-abslog="$LOG_DIR/Server.log" > /dev/null &
+SERVER_PID=$!
+
+CLIENT_PIDS=()
+cleanup()
+{
+	for PID in "${CLIENT_PIDS[@]}"; do
+		kill "$PID" 2> /dev/null || true
+	done
+}
+trap cleanup EXIT
+
+# give the server time to load the map before the clients try to join
+sleep "${NETBENCH_SERVER_STARTUP:-20}"
+
+for ((i = 0; i < CLIENTS; i++)); do
+	"$EDITOR" "$PROJECT" "127.0.0.1:$PORT" -game "${COMMON_ARGS[@]}" \
+		-abslog="$LOG_DIR/Client$i.log" > /dev/null &
+	CLIENT_PIDS+=($!)
+done
+
+wait "$SERVER_PID"
+grep "ActionSystem.NetBench\|ActionSystem NetBench" "$LOG_DIR/Server.log" || true
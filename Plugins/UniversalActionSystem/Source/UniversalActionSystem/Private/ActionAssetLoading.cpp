@@ -0,0 +1,124 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ActionAssetLoading.h"
+#include "StatEffect.h"
+#include "Engine/AssetManager.h"
+#include "Engine/StreamableManager.h"
+
+static int32 GLogActivationSyncLoads = 1;
+static FAutoConsoleVariableRef CVarLogActivationSyncLoads(
+	TEXT("ActionSystem.LogActivationSyncLoads"),
+	GLogActivationSyncLoads,
+	TEXT("Log packages loaded synchronously while an action starts or a stat effect is applied. Declare them as asset dependencies instead."));
+
+FStreamableManager& FActionAssetLoading::GetStreamableManager()
+{
+	if (UAssetManager::IsValid())
+	{
+		return UAssetManager::GetStreamableManager();
+	}
+	static FStreamableManager StreamableManager;
+	return StreamableManager;
+}
+
+TSharedPtr<FStreamableHandle> FActionAssetLoading::RequestAsyncLoad(TArray<FSoftObjectPath> Paths, const FString& DebugName)
+{
+	if (Paths.Num() == 0)
+	{
+		return nullptr;
+	}
+	return GetStreamableManager().RequestAsyncLoad(MoveTemp(Paths), FStreamableDelegate(), FStreamableManager::DefaultAsyncLoadPriority, false, false, DebugName);
+}
+
+bool FActionAssetLoading::AreLoaded(const TArray<FSoftObjectPath>& Paths)
+{
+	for (const FSoftObjectPath& Path : Paths)
+	{
+		if (!Path.ResolveObject())
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void FActionAssetLoading::GatherPaths(const TArray<TSoftObjectPtr<UObject>>& Assets, const TArray<TSoftClassPtr<UObject>>& Classes, TArray<FSoftObjectPath>& OutPaths)
+{
+	for (const TSoftObjectPtr<UObject>& Asset : Assets)
+	{
+		if (!Asset.IsNull())
+		{
+			OutPaths.Add(Asset.ToSoftObjectPath());
+		}
+	}
+	for (const TSoftClassPtr<UObject>& Class : Classes)
+	{
+		if (!Class.IsNull())
+		{
+			OutPaths.Add(Class.ToSoftObjectPath());
+		}
+	}
+}
+
+void FActionAssetLoading::GatherEffectPaths(const TArray<FSoftObjectPath>& Paths, TArray<FSoftObjectPath>& OutPaths)
+{
+	for (const FSoftObjectPath& Path : Paths)
+	{
+		const UClass* Class = Cast<UClass>(Path.ResolveObject());
+		if (Class && Class->IsChildOf(UStatEffect::StaticClass()))
+		{
+			Class->GetDefaultObject<UStatEffect>()->GetAssetDependencies(OutPaths);
+		}
+	}
+}
+
+#if !UE_BUILD_SHIPPING
+static const UObject* GSyncLoadContext = nullptr;
+static int32 GSyncLoadCount = 0;
+
+static void OnSyncLoadPackage(const FString& PackageName)
+{
+	if (!GSyncLoadContext)
+	{
+		return;
+	}
+	GSyncLoadCount++;
+	if (GLogActivationSyncLoads)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Sync load of %s while activating %s. Add it to the asset dependencies."), *PackageName, *GetNameSafe(GSyncLoadContext->GetClass()));
+	}
+}
+#endif
+
+FActionSyncLoadScope::FActionSyncLoadScope(const UObject* Context)
+{
+#if !UE_BUILD_SHIPPING
+	static bool bRegistered = false;
+	if (!bRegistered)
+	{
+		bRegistered = true;
+		FCoreUObjectDelegates::OnSyncLoadPackage.AddStatic(&OnSyncLoadPackage);
+	}
+
+	check(IsInGameThread());
+	PreviousContext = GSyncLoadContext;
+	GSyncLoadContext = Context;
+#endif
+}
+
+FActionSyncLoadScope::~FActionSyncLoadScope()
+{
+#if !UE_BUILD_SHIPPING
+	GSyncLoadContext = PreviousContext;
+#endif
+}
+
+int32 FActionSyncLoadScope::GetSyncLoadCount()
+{
+#if !UE_BUILD_SHIPPING
+	return GSyncLoadCount;
+#else
+	return 0;
+#endif
+}
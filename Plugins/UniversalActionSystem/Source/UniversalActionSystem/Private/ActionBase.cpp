@@ -3,9 +3,13 @@
 
 #include "ActionBase.h"
 #include "ActionComponent.h"
+#include "StatsComponent.h"
 #include "GameFramework/Character.h"
 #include "Net/UnrealNetwork.h"
 #include "Tasks/ActionTask.h"
+#include "ActionDefinition.h"
+#include "UniversalActionSystem.h"
+#include "Engine/BlueprintGeneratedClass.h"
 
 void UActionBase::Initialize(UActionComponent* NewActionComp)
 {
@@ -14,13 +18,49 @@ void UActionBase::Initialize(UActionComponent* NewActionComp)
 	RepData.Instigator = NewActionComp->GetOwner();
 }
 
+void UActionBase::ResetAction()
+{
+	// runtime state only; designer data lives on the class, so there is nothing else to copy back
+	ActionComp = nullptr;
+	RepData = FActionRepData();
+	TimeStarted = -1.0f;
+	CooldownCommitTime = -1.0f;
+	bInputPressed = false;
+	LastFailureReason = EFailureReason::AlreadyRunning;
+	DEC_DWORD_STAT_BY(STAT_ActionSystem_ActiveTasks, ActiveTasks.Num());
+	ActiveTasks.Reset();
+	ActionStopped.Clear();
+
+	OnActionReset();
+}
+
+FActionStateRef UActionBase::GetState()
+{
+	if (IsInstantiated())
+	{
+		return { RepData, TimeStarted, CooldownCommitTime, bInputPressed, LastFailureReason };
+	}
+
+	FActionExecutionState* SharedState = FNonInstancedActionScope::FindState(this);
+	if (!ensureMsgf(SharedState, TEXT("Non-instanced action %s used outside of a component running it."), *GetNameSafe(GetClass())))
+	{
+		// throwaway state, so misuse can never write to the class default
+		static FActionExecutionState DetachedState;
+		DetachedState = FActionExecutionState();
+		SharedState = &DetachedState;
+	}
+	return { SharedState->RepData, SharedState->TimeStarted, SharedState->CooldownCommitTime, SharedState->bInputPressed, SharedState->LastFailureReason };
+}
+
 UWorld* UActionBase::GetWorld() const
 {
 	if (!IsInstantiated())
 	{
 		// If we are a CDO, we must return nullptr instead of calling Outer->GetWorld() to fool UObject::ImplementsGetWorld.
+		// Non-instanced actions running for a component use that component's world
 		// UE_LOG(LogTemp, Warning, TEXT("GetWorld Returning nullptr; Not instantiated"))
-		return nullptr;
+		const UActionComponent* Comp = FNonInstancedActionScope::FindComponent(this);
+		return Comp ? Comp->GetWorld() : nullptr;
 	}
 	return GetOuter()->GetWorld();
 }
@@ -33,13 +73,92 @@ bool UActionBase::IsInstantiated() const
 	return !HasAllFlags(RF_ClassDefaultObject);
 }
 
+bool UActionBase::IsGrantedAsClassDefault() const
+{
+	return GetDefinition().InstancingPolicy != EActionInstancingPolicy::InstancedPerActor;
+}
+
+const FActionDefinition& UActionBase::GetDefinition() const
+{
+	const FActionSparseClassData* ClassData = GetActionSparseClassData();
+	return ClassData->DefinitionAsset ? ClassData->DefinitionAsset->Definition : ClassData->ClassDefinition;
+}
+
+FActionDefinition UActionBase::K2_GetDefinition() const
+{
+	return GetDefinition();
+}
+
+void UActionBase::GetAssetDependencies(TArray<FSoftObjectPath>& OutPaths) const
+{
+	GetDefinition().GetAssetDependencies(OutPaths);
+}
+
+void UActionBase::PostInitProperties()
+{
+	Super::PostInitProperties();
+
+	if (!HasAnyFlags(RF_ClassDefaultObject | RF_ArchetypeObject))
+	{
+		INC_DWORD_STAT(STAT_ActionSystem_ActionObjects);
+		INC_MEMORY_STAT_BY(STAT_ActionSystem_ActionObjectMemory, GetClass()->GetStructureSize());
+	}
+}
+
+void UActionBase::BeginDestroy()
+{
+	if (!HasAnyFlags(RF_ClassDefaultObject | RF_ArchetypeObject))
+	{
+		DEC_DWORD_STAT(STAT_ActionSystem_ActionObjects);
+		DEC_MEMORY_STAT_BY(STAT_ActionSystem_ActionObjectMemory, GetClass()->GetStructureSize());
+	}
+
+	Super::BeginDestroy();
+}
+
+#if WITH_EDITOR
+void UActionBase::MoveDataToSparseClassDataStruct() const
+{
+	// Blueprints saved since the move already serialize their sparse data; never overwrite it
+	const UBlueprintGeneratedClass* BPClass = Cast<UBlueprintGeneratedClass>(GetClass());
+	if (!BPClass || BPClass->bIsSparseClassDataSerializable)
+	{
+		return;
+	}
+
+	Super::MoveDataToSparseClassDataStruct();
+
+	FActionSparseClassData* ClassData = GetActionSparseClassData();
+	ClassData->DefinitionAsset = DefinitionAsset_DEPRECATED;
+	FActionDefinition& Definition = ClassData->ClassDefinition;
+	Definition.ActionTag = ActionTag_DEPRECATED;
+	Definition.GrantsTags = GrantsTags_DEPRECATED;
+	Definition.BlockedTags = BlockedTags_DEPRECATED;
+	Definition.CancelTags = CancelTags_DEPRECATED;
+	Definition.ActionName = ActionName_DEPRECATED;
+	Definition.Cooldown = Cooldown_DEPRECATED;
+	Definition.CooldownPolicy = CooldownPolicy_DEPRECATED;
+	Definition.CooldownTag = CooldownTag_DEPRECATED;
+	Definition.Costs = Costs_DEPRECATED;
+	Definition.InstancingPolicy = InstancingPolicy_DEPRECATED;
+	Definition.Priority = Priority_DEPRECATED;
+	Definition.bAutoStart = bAutoStart_DEPRECATED;
+	Definition.bUsesQueue = bUsesQueue_DEPRECATED;
+	Definition.bShouldActionTick = bShouldActionTick_DEPRECATED;
+	Definition.bAllowTickWhenNotRunning = bAllowTickWhenNotRunning_DEPRECATED;
+	Definition.Icon = Icon_DEPRECATED;
+	Definition.AssetDependencies = AssetDependencies_DEPRECATED;
+	Definition.ClassDependencies = ClassDependencies_DEPRECATED;
+}
+#endif
+
 UActionComponent* UActionBase::GetOwningComponent() const
 {
 	// Not sure why this was there. maybe helpful?
 	//AActor* Actor = Cast<AActor>(GetOuter());
 	//return Actor->GetComponentByClass(UActionBaseComponent::StaticClass());
 	
-	return ActionComp;
+	return IsInstantiated() ? ActionComp : FNonInstancedActionScope::FindComponent(this);
 }
 
 AActor* UActionBase::GetOwner() const
@@ -59,19 +178,26 @@ ACharacter* UActionBase::GetOwnerAsCharacter() const
 
 // COOLDOWN
 
+// every cooldown lives in the component's store; actions without a CooldownTag get an entry of their own
 void UActionBase::CommitCooldown()
 {
-	CooldownCommitTime = GetWorld()->TimeSeconds;
+	GetState().CooldownCommitTime = GetWorld()->TimeSeconds;
+	GetOwningComponent()->CommitActionCooldown(this, GetDefinition().Cooldown);
 }
 
 bool UActionBase::IsOffCooldown()
 {
-	return GetTimeSinceCooldownCommit() > Cooldown || CooldownCommitTime < 0.0f;
+	return GetOwningComponent()->FindActiveActionCooldown(this) == nullptr;
+}
+
+FGameplayTag UActionBase::GetCooldownTag() const
+{
+	return GetDefinition().GetCooldownTag();
 }
 
 float UActionBase::GetTimeSinceCooldownCommit()
 {
-	return GetWorld()->TimeSeconds - CooldownCommitTime;
+	return GetWorld()->TimeSeconds - GetState().CooldownCommitTime;
 }
 
 
@@ -110,7 +236,12 @@ void UActionBase::OnGameplayTaskInitialized(UGameplayTask& Task)
 void UActionBase::OnGameplayTaskActivated(UGameplayTask& Task)
 {
 	UE_LOG(LogTemp, Warning, TEXT("Running New GameplayTask"))
+	if (!IsInstantiated())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Non-instanced action %s is running a task; use InstancedPerExecution instead."), *GetNameSafe(GetClass()));
+	}
 	ActiveTasks.Add(&Task);
+	INC_DWORD_STAT(STAT_ActionSystem_ActiveTasks);
 	UActionTask* ActionTask = Cast<UActionTask>(&Task);
 	if (IsValid(ActionTask))
 	{
@@ -121,54 +252,74 @@ void UActionBase::OnGameplayTaskActivated(UGameplayTask& Task)
 
 void UActionBase::OnGameplayTaskDeactivated(UGameplayTask& Task)
 {
-	ActiveTasks.Remove(&Task);
+	if (ActiveTasks.Remove(&Task) > 0)
+	{
+		DEC_DWORD_STAT(STAT_ActionSystem_ActiveTasks);
+	}
 	IGameplayTaskOwnerInterface::OnGameplayTaskDeactivated(Task);
 }
 
 bool UActionBase::ShouldTick() const
 {
-	return IsRunning() || bAllowTickWhenNotRunning;
+	return IsRunning() || GetDefinition().bAllowTickWhenNotRunning;
 }
 
 bool UActionBase::IsInputPressed() const
 {
+	if (!IsInstantiated())
+	{
+		const FActionExecutionState* SharedState = FNonInstancedActionScope::FindState(this);
+		return SharedState && SharedState->bInputPressed;
+	}
 	return bInputPressed;
 }
 
 bool UActionBase::IsRunning() const
 {
+	if (!IsInstantiated())
+	{
+		const FActionExecutionState* SharedState = FNonInstancedActionScope::FindState(this);
+		return SharedState && SharedState->RepData.bIsRunning;
+	}
 	return RepData.bIsRunning;
 }
 
 FGameplayTag UActionBase::GetActionTag() const
 {
-	return ActionTag;
+	return GetDefinition().ActionTag;
 }
 
 FGameplayTagContainer UActionBase::GetGrantedTags() const
 {
-	return GrantsTags;
+	return GetDefinition().GrantsTags;
 }
 
 FGameplayTagContainer UActionBase::GetBlockedTags() const
 {
-	return BlockedTags;
+	return GetDefinition().BlockedTags;
 }
 
 bool UActionBase::CanStart_Implementation(AActor* Instigator)
+{
+	return CheckCanStart(GetState().LastFailureReason);
+}
+
+bool UActionBase::CheckCanStart(EFailureReason& OutFailureReason)
 {
 	if (IsRunning())
 	{
 		// UE_LOG(LogTemp, Warning, TEXT("Action Activation Failed: Already active."))
-		LastFailureReason = EFailureReason::AlreadyRunning;
+		OutFailureReason = EFailureReason::AlreadyRunning;
 		return false;
 	}
 
-	if (CooldownPolicy != ECooldownMethod::NoCooldown && Cooldown != 0.0f)
+	const FActionDefinition& Definition = GetDefinition();
+
+	if (Definition.CooldownPolicy != ECooldownMethod::NoCooldown && Definition.Cooldown != 0.0f)
 	{
 		if (!IsOffCooldown())
 		{
-			LastFailureReason = EFailureReason::OnCooldown;
+			OutFailureReason = EFailureReason::OnCooldown;
 			// UE_LOG(LogTemp, Warning, TEXT("Action Activation Failed: On Cooldown."))
 			return false;
 		}
@@ -176,16 +327,63 @@ bool UActionBase::CanStart_Implementation(AActor* Instigator)
 
 	UActionComponent* Comp = GetOwningComponent();
 	
-	if (Comp->ActiveGameplayTags.HasAny(BlockedTags))
+	if (Comp->ActiveGameplayTags.HasAny(Definition.BlockedTags))
 	{
-		LastFailureReason = EFailureReason::TagBlocked;
+		OutFailureReason = EFailureReason::TagBlocked;
 		// UE_LOG(LogTemp, Warning, TEXT("Action Activation Failed: Blocked Tags."))
 		return false;
 	}
 
+	if (!CanAffordCosts())
+	{
+		OutFailureReason = EFailureReason::Cost;
+		return false;
+	}
+
 	return true;
 }
 
+bool UActionBase::CanAffordCosts() const
+{
+	const TArray<FActionStatCost>& ActionCosts = GetDefinition().Costs;
+	if (ActionCosts.Num() == 0)
+	{
+		return true;
+	}
+
+	UStatsComponent* Stats = GetOwningComponent()->GetOwnerStatsComponent();
+	if (!IsValid(Stats))
+	{
+		return false;
+	}
+
+	for (const FActionStatCost& Cost : ActionCosts)
+	{
+		if (Stats->GetStatCurrentValue(Cost.Stat) < Cost.Amount)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void UActionBase::CommitCosts()
+{
+	const TArray<FActionStatCost>& ActionCosts = GetDefinition().Costs;
+	if (ActionCosts.Num() == 0 || GetOwner()->GetLocalRole() != ROLE_Authority)
+	{
+		return;
+	}
+
+	if (UStatsComponent* Stats = GetOwningComponent()->GetOwnerStatsComponent())
+	{
+		for (const FActionStatCost& Cost : ActionCosts)
+		{
+			Stats->ModifyStatAdditive(Cost.Stat, -Cost.Amount);
+		}
+	}
+}
+
 void UActionBase::StartAction(bool SetInputPressed)
 {
 	UE_LOG(LogTemp, Log, TEXT("Started: %s"), *GetNameSafe(this));
@@ -193,26 +391,32 @@ void UActionBase::StartAction(bool SetInputPressed)
 
 	if (SetInputPressed)
 	{
-		bInputPressed = SetInputPressed;
+		GetState().bInputPressed = SetInputPressed;
 	}
 	
-	UActionComponent* Comp = GetOwningComponent();	
-	Comp->AddActiveTags(GrantsTags);
-	Comp->CancelActionsByTag(CancelTags);
-
-	RepData.bIsRunning = true;
-	RepData.Instigator = GetOwner();
+	const FActionDefinition& Definition = GetDefinition();
+	UActionComponent* Comp = GetOwningComponent();
+	FScopedActionTransaction Transaction(Comp);
+	Comp->AddActiveTags(Definition.GrantsTags);
+	Comp->CancelActionTargets(this);
 
+	FActionStateRef State = GetState();
+	State.RepData.bIsRunning = true;
+	State.RepData.Instigator = GetOwner();
 	if (GetOwner()->GetLocalRole() == ROLE_Authority)
 	{
-		TimeStarted = GetWorld()->TimeSeconds;
+		State.TimeStarted = GetWorld()->TimeSeconds;
 	}
-	if (CooldownPolicy == ECooldownMethod::AutoFromActivation)
+	Comp->SetActionRunning(this, true);
+
+	if (Definition.CooldownPolicy == ECooldownMethod::AutoFromActivation)
 	{
 		CommitCooldown();
 	}
+	CommitCosts();
+	Comp->InvalidateStartableActions();
 
-	Comp->OnActionStarted.Broadcast(GetOwningComponent(), this);
+	Comp->NotifyActionStarted(this);
 	OnActionStarted(GetOwner());
 }
 
@@ -221,22 +425,28 @@ void UActionBase::StartActionWithInfo(FActionActivationInfo ActivationInfo)
 	UE_LOG(LogTemp, Log, TEXT("Started: %s"), *GetNameSafe(this));
 	//LogOnScreen(this, FString::Printf(TEXT("Started: %s"), *ActionName.ToString()), FColor::Green);
 
-	UActionComponent* Comp = GetOwningComponent();	
-	Comp->AddActiveTags(GrantsTags);
-
-	RepData.bIsRunning = true;
-	RepData.Instigator = GetOwner();
+	const FActionDefinition& Definition = GetDefinition();
+	UActionComponent* Comp = GetOwningComponent();
+	FScopedActionTransaction Transaction(Comp);
+	Comp->AddActiveTags(Definition.GrantsTags);
 
+	FActionStateRef State = GetState();
+	State.RepData.bIsRunning = true;
+	State.RepData.Instigator = GetOwner();
 	if (GetOwner()->GetLocalRole() == ROLE_Authority)
 	{
-		TimeStarted = GetWorld()->TimeSeconds;
+		State.TimeStarted = GetWorld()->TimeSeconds;
 	}
-	if (CooldownPolicy == ECooldownMethod::AutoFromActivation)
+	Comp->SetActionRunning(this, true);
+
+	if (Definition.CooldownPolicy == ECooldownMethod::AutoFromActivation)
 	{
 		CommitCooldown();
 	}
+	CommitCosts();
+	Comp->InvalidateStartableActions();
 
-	GetOwningComponent()->OnActionStarted.Broadcast(GetOwningComponent(), this);
+	Comp->NotifyActionStarted(this);
 	OnActionStartedWithInfo(GetOwner(), ActivationInfo);
 }
 
@@ -252,21 +462,27 @@ void UActionBase::StopAction()
 
 	//ensureAlways(bIsRunning);
 
+	const FActionDefinition& Definition = GetDefinition();
 	UActionComponent* Comp = GetOwningComponent();
-	Comp->RemoveActiveTags(GrantsTags);
+	FScopedActionTransaction Transaction(Comp);
+	Comp->RemoveActiveTags(Definition.GrantsTags);
 
-	RepData.bIsRunning = false;
-	RepData.Instigator = GetOwner();
+	FActionStateRef State = GetState();
+	State.RepData.bIsRunning = false;
+	State.RepData.Instigator = GetOwner();
+	Comp->SetActionRunning(this, false);
 
-	if (CooldownPolicy == ECooldownMethod::AutoFromFinish)
+	if (Definition.CooldownPolicy == ECooldownMethod::AutoFromFinish)
 	{
 		CommitCooldown();
 	}
+	Comp->InvalidateStartableActions();
 
-	GetOwningComponent()->OnActionStopped.Broadcast(GetOwningComponent(), this);
-	GetOwningComponent()->OnActionFinished.Broadcast(false);
+	Comp->NotifyActionStopped(this, false);
 	OnActionStopped(GetOwner(), false);
 	ActionStopped.Broadcast(this, false);
+
+	Comp->ScheduleActionQueue();
 }
 
 void UActionBase::CancelAction()
@@ -276,38 +492,49 @@ void UActionBase::CancelAction()
 
 	//ensureAlways(bIsRunning);
 
+	const FActionDefinition& Definition = GetDefinition();
 	UActionComponent* Comp = GetOwningComponent();
-	Comp->RemoveActiveTags(GrantsTags);
+	FScopedActionTransaction Transaction(Comp);
+	Comp->RemoveActiveTags(Definition.GrantsTags);
 
-	RepData.bIsRunning = false;
-	RepData.Instigator = GetOwner();
+	FActionStateRef State = GetState();
+	State.RepData.bIsRunning = false;
+	State.RepData.Instigator = GetOwner();
+	Comp->SetActionRunning(this, false);
 
-	if (CooldownPolicy == ECooldownMethod::AutoFromFinish)
+	if (Definition.CooldownPolicy == ECooldownMethod::AutoFromFinish)
 	{
 		CommitCooldown();
 	}
+	Comp->InvalidateStartableActions();
 
-	GetOwningComponent()->OnActionStopped.Broadcast(GetOwningComponent(), this);
-	GetOwningComponent()->OnActionFinished.Broadcast(true);
+	Comp->NotifyActionStopped(this, true);
 	OnActionStopped(GetOwner(), true);
 	ActionStopped.Broadcast(this, true);
+
+	Comp->ScheduleActionQueue();
 }
 
 void UActionBase::InputReleased()
 {
-	bInputPressed = false;
+	GetState().bInputPressed = false;
 	OnInputReleased();
 }
 
 void UActionBase::InputPressed()
 {
-	bInputPressed = true;
+	GetState().bInputPressed = true;
 	OnInputPressed();
 }
 
 float UActionBase::GetCooldownTimeRemaining()
 {
-	return Cooldown - GetTimeSinceCooldownCommit();
+	const UActionComponent* Component = GetOwningComponent();
+	if (const FActionCooldown* Entry = Component->FindActiveActionCooldown(this))
+	{
+		return Entry->EndTime - Component->GetCooldownClockTime();
+	}
+	return 0.0f;
 }
 
 void UActionBase::GetLifetimeReplicatedProps(TArray<class FLifetimeProperty>& OutLifetimeProps) const
@@ -3,12 +3,144 @@
 
 #include "ActionComponent.h"
 #include "ActionBase.h"
-#include "UniversalActionSystem/Public/UniversalActionSystem.h"
+#include "StatsComponent.h"
+#include "ActionPoolSubsystem.h"
+#include "ActionGrantSet.h"
+#include "ActionAssetLoading.h"
+#include "ActionSystemTrace.h"
+#include "Engine/StreamableManager.h"
+#include "UniversalActionSystem.h"
 #include "Net/UnrealNetwork.h"
 #include "Engine/ActorChannel.h"
+#include "GameFramework/GameStateBase.h"
+#include "TimerManager.h"
+#include "Net/Core/PushModel/PushModel.h"
+#include "Serialization/ArchiveCountMem.h"
+#include "UObject/UObjectIterator.h"
+
+DECLARE_CYCLE_STAT(TEXT("StartActionByTag"), STAT_StartActionByTag, STATGROUP_ActionSystem);
+DECLARE_CYCLE_STAT(TEXT("StartActionByClass"), STAT_StartActionByClass, STATGROUP_ActionSystem);
+DECLARE_CYCLE_STAT(TEXT("CanStart"), STAT_CanStartAction, STATGROUP_ActionSystem);
+DECLARE_CYCLE_STAT(TEXT("EvaluateStartableActions"), STAT_EvaluateStartableActions, STATGROUP_ActionSystem);
+DECLARE_CYCLE_STAT(TEXT("AddActiveTags"), STAT_AddActiveTags, STATGROUP_ActionSystem);
+DECLARE_CYCLE_STAT(TEXT("RemoveActiveTags"), STAT_RemoveActiveTags, STATGROUP_ActionSystem);
+DECLARE_CYCLE_STAT(TEXT("Grant/Remove Actions"), STAT_GrantActions, STATGROUP_ActionSystem);
+DECLARE_CYCLE_STAT(TEXT("Tick Actions"), STAT_TickActions, STATGROUP_ActionSystem);
+DECLARE_CYCLE_STAT(TEXT("ReplicateSubobjects"), STAT_ReplicateActionSubobjects, STATGROUP_ActionSystem);
+
+/* CanStart is overridden in Blueprint, or the class derives from a native subclass that may override it */
+static bool HasCustomCanStart(UClass* ActionClass)
+{
+	if (ActionClass->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(UActionBase, CanStart)))
+	{
+		return true;
+	}
+	UClass* NativeClass = ActionClass;
+	while (NativeClass && !NativeClass->HasAnyClassFlags(CLASS_Native))
+	{
+		NativeClass = NativeClass->GetSuperClass();
+	}
+	return NativeClass != UActionBase::StaticClass();
+}
+
+static void ReportActionObjects()
+{
+	int32 NumObjects = 0;
+	int32 NumExecutionInstances = 0;
+	SIZE_T ObjectBytes = 0;
+	for (TObjectIterator<UActionBase> It; It; ++It)
+	{
+		FArchiveCountMem CountMem(*It);
+		ObjectBytes += CountMem.GetMax();
+		NumObjects++;
+		if (It->GetDefinition().InstancingPolicy == EActionInstancingPolicy::InstancedPerExecution)
+		{
+			NumExecutionInstances++;
+		}
+	}
+
+	int32 NumComponents = 0;
+	int32 NumGranted = 0;
+	int32 NumSharedGrants = 0;
+	for (TObjectIterator<UActionComponent> It; It; ++It)
+	{
+		if (!It->GetWorld())
+		{
+			continue;
+		}
+		NumComponents++;
+		for (UActionBase* Action : It->GetActionsArray())
+		{
+			NumGranted++;
+			if (Action && !Action->IsInstantiated())
+			{
+				NumSharedGrants++;
+			}
+		}
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("Action components: %d, granted actions: %d (%d sharing class defaults, ~%d bytes of per-actor state each)"),
+		NumComponents, NumGranted, NumSharedGrants, (int32)sizeof(FGrantedActionRecord));
+	UE_LOG(LogTemp, Display, TEXT("Action objects: %d (%d per-execution), %.1f KB"),
+		NumObjects, NumExecutionInstances, ObjectBytes / 1024.0f);
+}
+
+static FAutoConsoleCommand ReportActionObjectsCommand(
+	TEXT("ActionSystem.ReportActionObjects"),
+	TEXT("Logs the number of live action objects and their memory, and how many granted actions share class defaults."),
+	FConsoleCommandDelegate::CreateStatic(&ReportActionObjects));
+
+TArray<const FNonInstancedActionScope*> FNonInstancedActionScope::ActiveScopes;
+
+FNonInstancedActionScope::FNonInstancedActionScope(UActionBase* InAction, UActionComponent* InComponent)
+{
+	// instances carry their own state
+	if (!InAction || !InComponent || InAction->IsInstantiated())
+	{
+		return;
+	}
+	check(IsInGameThread());
 
-DECLARE_CYCLE_STAT(TEXT("StartActionByName"), STAT_StartActionByName, STATGROUP_STANFORD);
-DECLARE_CYCLE_STAT(TEXT("StartActionByClass"), STAT_StartActionByClass, STATGROUP_STANFORD);
+	Action = InAction;
+	Component = InComponent;
+	ActiveScopes.Push(this);
+}
+
+FNonInstancedActionScope::~FNonInstancedActionScope()
+{
+	if (!Action)
+	{
+		return;
+	}
+	check(ActiveScopes.Num() > 0 && ActiveScopes.Last() == this);
+	ActiveScopes.Pop(false);
+}
+
+const FNonInstancedActionScope* FNonInstancedActionScope::FindScope(const UActionBase* InAction)
+{
+	for (int32 i = ActiveScopes.Num() - 1; i >= 0; i--)
+	{
+		if (ActiveScopes[i]->Action == InAction)
+		{
+			return ActiveScopes[i];
+		}
+	}
+	return nullptr;
+}
+
+UActionComponent* FNonInstancedActionScope::FindComponent(const UActionBase* InAction)
+{
+	const FNonInstancedActionScope* Scope = FindScope(InAction);
+	return Scope ? Scope->Component : nullptr;
+}
+
+FActionExecutionState* FNonInstancedActionScope::FindState(const UActionBase* InAction)
+{
+	// looked up every time; the action may grant or remove actions while it runs
+	const FNonInstancedActionScope* Scope = FindScope(InAction);
+	FGrantedActionRecord* Record = Scope ? Scope->Component->ActionRecords.Find(Scope->Action) : nullptr;
+	return Record ? &Record->SharedState : nullptr;
+}
 
 UActionComponent::UActionComponent(const FObjectInitializer& ObjectInitializer) : UGameplayTasksComponent(ObjectInitializer)
 {
@@ -20,15 +152,46 @@ UActionComponent::UActionComponent(const FObjectInitializer& ObjectInitializer)
 void UActionComponent::BeginPlay()
 {
 	Super::BeginPlay();
+	TRACE_ACTION_COMPONENT_SPEC(this);
 
 	SetComponentTickEnabled(bCanTickActions);
 
+	OwnerStatsComponent = GetOwner()->FindComponentByClass<UStatsComponent>();
+	if (OwnerStatsComponent)
+	{
+		OwnerStatsComponent->OnStatChanged.AddDynamic(this, &UActionComponent::OnOwnerStatChanged);
+		OwnerStatsComponent->OnStatValuesUpdated.AddUObject(this, &UActionComponent::OnOwnerStatValuesUpdated);
+	}
+
 	// Server Only
 	if (GetOwner()->HasAuthority())
 	{
-		for (TSubclassOf<UActionBase> ActionClass : DefaultActions)
+		if (bLazyDefaultActions)
+		{
+			// only actions that run or tick without being asked for are needed up front
+			TArray<TSubclassOf<UActionBase>> EagerActions;
+			for (TSubclassOf<UActionBase> ActionClass : DefaultActions)
+			{
+				if (!ActionClass)
+				{
+					continue;
+				}
+				const FActionDefinition& Definition = ActionClass->GetDefaultObject<UActionBase>()->GetDefinition();
+				if (Definition.bAutoStart || Definition.bAllowTickWhenNotRunning)
+				{
+					EagerActions.Add(ActionClass);
+				}
+				else
+				{
+					LazyActionClasses.Add(ActionClass);
+				}
+			}
+			MARK_PROPERTY_DIRTY_FROM_NAME(UActionComponent, LazyActionClasses, this);
+			AddActions(GetOwner(), EagerActions);
+		}
+		else
 		{
-			AddAction(GetOwner(), ActionClass);
+			AddActions(GetOwner(), DefaultActions);
 		}
 	}
 	
@@ -42,12 +205,16 @@ void UActionComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActo
 
 	if (bCanTickActions)
 	{
+		SCOPE_CYCLE_COUNTER(STAT_TickActions);
 		for (UActionBase* CurrentAction : TickedActions)
 		{
-			if (CurrentAction->ShouldTick())
+			ExecuteOnAction(CurrentAction, [DeltaTime](UActionBase* Action)
 			{
-				CurrentAction->OnActionTick(DeltaTime);
-			}
+				if (Action->ShouldTick())
+				{
+					Action->OnActionTick(DeltaTime);
+				}
+			});
 		}
 	}
 	
@@ -59,7 +226,7 @@ void UActionComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActo
 	 // Draw All Actions
 	for (UActionBase* Action : Actions)
 	{
- 		FColor TextColor = Action->IsRunning() ? FColor::Blue : FColor::White;
+ 		FColor TextColor = IsActionRunning(Action) ? FColor::Blue : FColor::White;
  		FString ActionMsg = FString::Printf(TEXT("[%s] Action: %s"), *GetNameSafe(GetOwner()), *GetNameSafe(Action));
 	
 	}
@@ -72,35 +239,35 @@ bool UActionComponent::GetShouldTick() const
 
 UActionBase* UActionComponent::GetActionByName(FName ActionName)
 {
-	for (UActionBase* Action : Actions)
+	if (UActionBase* Action = FindActionByName(ActionName))
 	{
-		if (Action && Action->ActionName == ActionName)
-		{
-			return Action;
-		}
+		return Action;
 	}
 
-	return nullptr;
+	const int32 LazyIndex = FindLazyActionByName(ActionName);
+	return LazyIndex != INDEX_NONE ? GrantLazyAction(LazyIndex) : nullptr;
 }
 
 bool UActionComponent::StartActionWithInfo(FGameplayTag ActionTag, FActionActivationInfo ActivationInfo)
 {
 	SCOPE_CYCLE_COUNTER(STAT_StartActionByClass);
+	FScopedActionTransaction Transaction(this);
 	
 	if (bActionsInhibited)
 	{
-		OnActionFailed.Broadcast(FindActionByTag(ActionTag), EFailureReason::Inhibited);
+		NotifyActionFailed(FindActionByTag(ActionTag), EFailureReason::Inhibited);
 		return false;
 	}
 
 	if (UActionBase* FoundAction = FindActionByTag(ActionTag))
 	{
 
-		if (!FoundAction->CanStart(GetOwner()))
+		if (!CanStartGrantedAction(FoundAction, GetOwner()))
 		{
-			OnActionFailed.Broadcast(FoundAction, FoundAction->LastFailureReason);
+			NotifyActionFailed(FoundAction, LastStartFailureReason);
 			// FString FailedMsg = FString::Printf(TEXT("Failed to run: %s"), *GetNameSafe(FoundAction));
 			// GEngine->AddOnScreenDebugMessage(-1, 2.0f, FColor::Red, FailedMsg);
+			TryQueueAction(FoundAction, EQueuedActionStartMethod::WithInfo, false, ActivationInfo);
 			return false;
 		}
 		
@@ -108,15 +275,25 @@ bool UActionComponent::StartActionWithInfo(FGameplayTag ActionTag, FActionActiva
 		if (!GetOwner()->HasAuthority())
 		{
 			// UE_LOG(LogTemp, Warning, TEXT("Calling Server Action Start"))
-			ServerStartAction(FoundAction->ActionTag);
+			ServerStartAction(FoundAction->GetDefinition().ActionTag);
 		}
 		
-		// Bookmark for Unreal Insights
-		TRACE_BOOKMARK(TEXT("StartAction::%s"), FoundAction->ActionName);
-		FoundAction->StartActionWithInfo(ActivationInfo);
+		StartGrantedAction(FoundAction, false, &ActivationInfo);
 		
 		return true;
 	}
+
+	// first use of a lazy default action: the server grants it, a client forwards the start to the server
+	const int32 LazyIndex = FindLazyActionByTag(ActionTag);
+	if (LazyIndex != INDEX_NONE)
+	{
+		if (!GetOwner()->HasAuthority())
+		{
+			ServerStartActionWithInfo(ActionTag, ActivationInfo);
+			return true;
+		}
+		return GrantLazyAction(LazyIndex) && StartActionWithInfo(ActionTag, ActivationInfo);
+	}
 	return false;
 }
 
@@ -135,6 +312,12 @@ bool UActionComponent::SwapActionIndices(int IndexFrom, int IndexTo)
 		return false;
 	}
 	Actions.Swap(IndexFrom, IndexTo);
+	ActionDefinitions.Swap(IndexFrom, IndexTo);
+	ActionSlotIndices.Swap(IndexFrom, IndexTo);
+	UpdateDenseIndices(IndexFrom, IndexFrom);
+	UpdateDenseIndices(IndexTo, IndexTo);
+	MarkActionsDirty();
+	InvalidateStartableActions();
 	return true;
 }
 
@@ -143,534 +326,2157 @@ TArray<UActionBase*> UActionComponent::GetActionsArray() const
 	return Actions;
 }
 
-void UActionComponent::AddAction(AActor* Instigator, TSubclassOf<UActionBase> ActionClass)
+FActionHandle UActionComponent::AddAction(AActor* Instigator, TSubclassOf<UActionBase> ActionClass)
 {
-	if (!ensure(ActionClass))
-	{
-		return;
-	}
+	return GrantAction(ActionClass, INDEX_NONE, Instigator);
+}
 
-	// Skip for clients
+TArray<FActionHandle> UActionComponent::AddActions(AActor* Instigator, const TArray<TSubclassOf<UActionBase>>& ActionClasses)
+{
+	TArray<FActionHandle> Handles;
 	if (!GetOwner()->HasAuthority())
 	{
-		UE_LOG(LogTemp, Warning, TEXT("Client attempting to AddAction. [Class: %s]"), *GetNameSafe(ActionClass));
-		return;
+		UE_LOG(LogTemp, Warning, TEXT("Client attempting to AddActions. [Count: %d]"), ActionClasses.Num());
+		return Handles;
 	}
 
-	UActionBase* NewAction = NewObject<UActionBase>(GetOwner(), ActionClass);
-	if (ensure(NewAction))
-	{
-		NewAction->Initialize(this);
+	SCOPE_CYCLE_COUNTER(STAT_GrantActions);
+	FScopedActionTransaction Transaction(this);
 
-		if (NewAction->bShouldActionTick)
-		{
-			TickedActions.Add(NewAction);
-		}
-		
-		Actions.Add(NewAction);
-		NewAction->OnActionAdded();
+	const int32 NewNum = Actions.Num() + ActionClasses.Num();
+	Actions.Reserve(NewNum);
+	ActionDefinitions.Reserve(NewNum);
+	ActionSlotIndices.Reserve(NewNum);
+	ActionRecords.Reserve(NewNum);
+	ActionSlots.Reserve(ActionSlots.Num() + FMath::Max(0, ActionClasses.Num() - FreeActionSlots.Num()));
+	Handles.Reserve(ActionClasses.Num());
 
-		if (NewAction->bAutoStart && ensure(NewAction->CanStart(Instigator)))
+	TArray<UActionBase*> GrantedActions;
+	GrantedActions.Reserve(ActionClasses.Num());
+	for (TSubclassOf<UActionBase> ActionClass : ActionClasses)
+	{
+		const FActionHandle Handle = GrantAction(ActionClass, INDEX_NONE, Instigator, false);
+		Handles.Add(Handle);
+		if (UActionBase* Action = GetActionFromHandle(Handle))
 		{
-			NewAction->StartAction();
+			GrantedActions.Add(Action);
 		}
 	}
+	RequestActionAssets(GrantedActions);
+	return Handles;
 }
 
-void UActionComponent::AddActionAtIndex(TSubclassOf<UActionBase> ActionClass, int Index)
+void UActionComponent::RequestActionAssets(TArrayView<UActionBase* const> GrantedActions)
 {
-	if (!ensure(ActionClass))
+	TArray<FSoftObjectPath> Paths;
+	for (UActionBase* Action : GrantedActions)
 	{
-		return;
+		Action->GetAssetDependencies(Paths);
 	}
-
-	// Skip for clients
-	if (!GetOwner()->HasAuthority())
+	if (Paths.Num() == 0)
 	{
-		UE_LOG(LogTemp, Warning, TEXT("Client attempting to AddAction. [Class: %s]"), *GetNameSafe(ActionClass));
 		return;
 	}
 
-	UActionBase* NewAction = NewObject<UActionBase>(GetOwner(), ActionClass);
-	if (ensure(NewAction))
+	const FString DebugName = GetNameSafe(GetOwner()) + TEXT(" actions");
+	TSharedPtr<FStreamableHandle> AssetHandle = FActionAssetLoading::RequestAsyncLoad(Paths, DebugName);
+	for (UActionBase* Action : GrantedActions)
 	{
-		NewAction->Initialize(this);
-
-		if (NewAction->bShouldActionTick)
-		{
-			TickedActions.Add(NewAction);
-		}
-		Actions.Insert(NewAction, Index);
-		NewAction->OnActionAdded();
-
-		if (NewAction->bAutoStart && ensure(NewAction->CanStart(GetOwner())))
+		if (FGrantedActionRecord* Record = ActionRecords.Find(Action))
 		{
-			NewAction->StartAction();
+			Record->AssetHandle = AssetHandle;
 		}
 	}
-}
 
-void UActionComponent::RemoveAllActions()
-{
-	for (UActionBase* Action : Actions)
+	// stat effect classes only know their own dependencies once they are loaded
+	TWeakObjectPtr<UActionComponent> WeakThis(this);
+	TArray<UActionBase*> Requesters(GrantedActions.GetData(), GrantedActions.Num());
+	auto RequestEffectAssets = [WeakThis, Paths = MoveTemp(Paths), Requesters = MoveTemp(Requesters), DebugName]()
 	{
-		if (!IsValid(Action))
+		UActionComponent* This = WeakThis.Get();
+		if (!This)
 		{
-			continue;
+			return;
 		}
-		if (Action->IsRunning())
+		TArray<FSoftObjectPath> EffectPaths;
+		FActionAssetLoading::GatherEffectPaths(Paths, EffectPaths);
+		const TSharedPtr<FStreamableHandle> EffectHandle = FActionAssetLoading::RequestAsyncLoad(MoveTemp(EffectPaths), DebugName + TEXT(" effects"));
+		for (UActionBase* Action : Requesters)
 		{
-			Action->CancelAction();
+			if (FGrantedActionRecord* Record = This->ActionRecords.Find(Action))
+			{
+				Record->EffectAssetHandle = EffectHandle;
+			}
 		}
+	};
+	if (!AssetHandle.IsValid() || !AssetHandle->BindCompleteDelegate(FStreamableDelegate::CreateLambda(RequestEffectAssets)))
+	{
+		RequestEffectAssets();
 	}
-	Actions.Empty();
-	TickedActions.Empty();
-	DefaultActions.Empty();
 }
 
-void UActionComponent::RemoveAction(UActionBase* ActionToRemove)
+bool UActionComponent::AreActionAssetsLoaded(UActionBase* Action) const
 {
-	if (!IsValid(ActionToRemove))
+	const FGrantedActionRecord* Record = ActionRecords.Find(GetGrantedAction(Action));
+	if (!Record)
 	{
-		return;
+		return false;
 	}
+	return (!Record->AssetHandle.IsValid() || Record->AssetHandle->HasLoadCompleted())
+		&& (!Record->EffectAssetHandle.IsValid() || Record->EffectAssetHandle->HasLoadCompleted());
+}
 
-	if (ActionToRemove->IsRunning())
-	{
-		ActionToRemove->CancelAction();
-	}
+void UActionComponent::RemoveActions(const TArray<TSubclassOf<UActionBase>>& ActionClasses)
+{
+	FScopedActionTransaction Transaction(this);
 
-	if (ActionToRemove->bShouldActionTick)
+	for (TSubclassOf<UActionBase> ActionClass : ActionClasses)
 	{
-		TickedActions.Remove(ActionToRemove);
+		RemoveActionByClass(ActionClass);
 	}
-
-	Actions.Remove(ActionToRemove);
 }
 
-void UActionComponent::RemoveActionByClass(TSubclassOf<UActionBase> ActionToRemove)
+TArray<FActionHandle> UActionComponent::GrantActionSet(AActor* Instigator, UActionGrantSet* GrantSet)
 {
-	RemoveAction(FindActionByClass(ActionToRemove));
+	if (!GrantSet)
+	{
+		return TArray<FActionHandle>();
+	}
+	return AddActions(Instigator, GrantSet->Actions);
 }
 
-TArray<UActionBase*> UActionComponent::GetActionsWithTags(FGameplayTagContainer Tags)
+void UActionComponent::RemoveActionSet(UActionGrantSet* GrantSet)
 {
-	TArray<UActionBase*> OutActions;
-	for (UActionBase* Action : Actions)
+	if (GrantSet)
 	{
-		if (Action->ActionTag.IsValid() && Tags.HasTag(Action->ActionTag))
-		{
-			OutActions.Add(Action);
-		}
+		RemoveActions(GrantSet->Actions);
 	}
-	return OutActions;
 }
 
-UActionBase* UActionComponent::GetActionByClass(TSubclassOf<UActionBase> ActionClass) const
+void UActionComponent::PreloadActionSetAssets(UActionGrantSet* GrantSet)
 {
-	for (UActionBase* Action : Actions)
+	if (!GrantSet || PreloadedActionSets.Contains(GrantSet))
 	{
-		if (Action && Action->IsA(ActionClass))
-		{
-			return Action;
-		}
+		return;
 	}
 
-	return nullptr;
+	TArray<FSoftObjectPath> Paths;
+	GrantSet->GetAssetDependencies(Paths);
+	PreloadedActionSets.Add(GrantSet, FActionAssetLoading::RequestAsyncLoad(MoveTemp(Paths), GetNameSafe(GrantSet)));
 }
 
-bool UActionComponent::StartActionByClass(TSubclassOf<UActionBase> ActionClass, bool SetInputPressed)
+void UActionComponent::ReleaseActionSetAssets(UActionGrantSet* GrantSet)
 {
-	SCOPE_CYCLE_COUNTER(STAT_StartActionByClass);
-
-	if (bActionsInhibited)
+	TSharedPtr<FStreamableHandle> Handle;
+	if (PreloadedActionSets.RemoveAndCopyValue(GrantSet, Handle) && Handle.IsValid())
 	{
-		OnActionFailed.Broadcast(FindActionByClass(ActionClass), EFailureReason::Inhibited);
-		return false;
+		Handle->ReleaseHandle();
 	}
+}
 
-	for (UActionBase* Action : Actions)
+int32 UActionComponent::FindLazyActionByClass(TSubclassOf<UActionBase> ActionClass) const
+{
+	return LazyActionClasses.IndexOfByPredicate([ActionClass](TSubclassOf<UActionBase> LazyClass)
 	{
-		if (Action && Action->IsA(ActionClass))
-		{
-			if (SetInputPressed)
-			{
-				Action->InputPressed();
-			}
-			if (!Action->CanStart(GetOwner()))
-			{
-				OnActionFailed.Broadcast(Action, Action->LastFailureReason);
-				// FString FailedMsg = FString::Printf(TEXT("Failed to run: %s"), *GetNameSafe(Action));
-				// GEngine->AddOnScreenDebugMessage(-1, 2.0f, FColor::Red, FailedMsg);
-				continue;
-			}
+		return LazyClass && LazyClass->IsChildOf(ActionClass);
+	});
+}
 
-			UE_LOG(LogTemp, Warning, TEXT("Calling Action Start"))
-			
-			// Is Client?
-			if (!GetOwner()->HasAuthority())
-			{
-				// UE_LOG(LogTemp, Warning, TEXT("Calling Server Action Start"))
-				ServerStartActionByClass(ActionClass);
-			}
+int32 UActionComponent::FindLazyActionByTag(FGameplayTag Tag) const
+{
+	return LazyActionClasses.IndexOfByPredicate([Tag](TSubclassOf<UActionBase> LazyClass)
+	{
+		return LazyClass && LazyClass->GetDefaultObject<UActionBase>()->GetDefinition().ActionTag.MatchesTagExact(Tag);
+	});
+}
 
-			// Bookmark for Unreal Insights
-			TRACE_BOOKMARK(TEXT("StartAction::%s"), Action->ActionName);
+int32 UActionComponent::FindLazyActionByName(FName ActionName) const
+{
+	return LazyActionClasses.IndexOfByPredicate([ActionName](TSubclassOf<UActionBase> LazyClass)
+	{
+		return LazyClass && LazyClass->GetDefaultObject<UActionBase>()->GetDefinition().ActionName == ActionName;
+	});
+}
 
-			Action->StartAction(SetInputPressed);
-			return true;
-		}
+UActionBase* UActionComponent::GrantLazyAction(int32 LazyIndex)
+{
+	if (!GetOwner()->HasAuthority())
+	{
+		return nullptr;
 	}
 
-	return false;
+	const TSubclassOf<UActionBase> ActionClass = LazyActionClasses[LazyIndex];
+	LazyActionClasses.RemoveAt(LazyIndex);
+	MARK_PROPERTY_DIRTY_FROM_NAME(UActionComponent, LazyActionClasses, this);
+	return GetActionFromHandle(GrantAction(ActionClass, INDEX_NONE, GetOwner()));
 }
 
-bool UActionComponent::StartActionByTag(FGameplayTag ActionTag)
+void UActionComponent::AddActionAtIndex(TSubclassOf<UActionBase> ActionClass, int Index)
 {
-	SCOPE_CYCLE_COUNTER(STAT_StartActionByName);
+	GrantAction(ActionClass, Index, GetOwner());
+}
 
-	if (bActionsInhibited)
+FActionHandle UActionComponent::GrantAction(TSubclassOf<UActionBase> ActionClass, int32 Index, AActor* Instigator, bool bRequestAssets)
+{
+	if (!ensure(ActionClass))
 	{
-		OnActionFailed.Broadcast(FindActionByTag(ActionTag), EFailureReason::Inhibited);
-		return false;
+		return FActionHandle();
 	}
-	
-	for (UActionBase* Action : Actions)
+
+	// Skip for clients
+	if (!GetOwner()->HasAuthority())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Client attempting to AddAction. [Class: %s]"), *GetNameSafe(ActionClass));
+		return FActionHandle();
+	}
+
+	LLM_SCOPE_BYTAG(ActionSystem_Actions);
+	FScopedActionTransaction Transaction(this);
+
+	UActionBase* NewAction = ActionClass->GetDefaultObject<UActionBase>();
+	if (NewAction->IsGrantedAsClassDefault())
 	{
-		if (Action && Action->ActionTag.MatchesTagExact(ActionTag))
+		// the class default is shared by every actor, so it can only be granted once per component
+		if (ActionRecords.Contains(NewAction))
 		{
-			if (!Action->CanStart(GetOwner()))
-			{
-				OnActionFailed.Broadcast(Action, Action->LastFailureReason);
-				// FString FailedMsg = FString::Printf(TEXT("Failed to run: %s"), *ActionTag.ToString());
-				// GEngine->AddOnScreenDebugMessage(-1, 2.0f, FColor::Red, FailedMsg);
-				continue;
-			}
+			UE_LOG(LogTemp, Warning, TEXT("Action is already granted. [Class: %s]"), *GetNameSafe(ActionClass));
+			return FActionHandle();
+		}
+	}
+	else
+	{
+		NewAction = CreateActionObject(ActionClass);
+		if (!ensure(NewAction))
+		{
+			return FActionHandle();
+		}
+		NewAction->Initialize(this);
+	}
+	if (NewAction->GetDefinition().bShouldActionTick)
+	{
+		TickedActions.Add(NewAction);
+	}
 
-			// Is Client?
-			if (!GetOwner()->HasAuthority())
-			{
-				ServerStartAction(ActionTag);
-			}
+	// appending is O(1); only the deprecated AddActionAtIndex shifts later entries
+	const int32 DenseIndex = Index == INDEX_NONE ? Actions.Num() : Index;
+	const int32 SlotIndex = AllocateActionSlot(NewAction, DenseIndex);
+	Actions.Insert(NewAction, DenseIndex);
+	ActionDefinitions.Insert(&NewAction->GetDefinition(), DenseIndex);
+	ActionSlotIndices.Insert(SlotIndex, DenseIndex);
+	if (DenseIndex < Actions.Num() - 1)
+	{
+		UpdateDenseIndices(DenseIndex + 1);
+	}
+	FGrantedActionRecord& NewRecord = ActionRecords.Add(NewAction);
+	NewRecord.SlotIndex = SlotIndex;
+	NewRecord.bHasCustomCanStart = HasCustomCanStart(ActionClass);
+	const FActionHandle Handle = { SlotIndex, ActionSlots[SlotIndex].Generation };
+	if (bRequestAssets)
+	{
+		RequestActionAssets(MakeArrayView(&NewAction, 1));
+	}
 
-			// Bookmark for Unreal Insights
-			TRACE_BOOKMARK(TEXT("StartAction::%s"), *GetNameSafe(Action));
+	LinkCancelGraph(NewAction);
+	MarkActionsDirty();
+	InvalidateStartableActions();
+	NotifyActionAdded(NewAction);
 
-			Action->StartAction();
-			return true;
-		}
+	{
+		FNonInstancedActionScope Scope(NewAction, this);
+		NewAction->OnActionAdded();
 	}
 
-	return false;
+	if (NewAction->GetDefinition().bAutoStart && ensure(CanStartGrantedAction(NewAction, Instigator)))
+	{
+		StartGrantedAction(NewAction, false);
+	}
+	return Handle;
 }
 
-bool UActionComponent::StopActionByClass(TSubclassOf<UActionBase> ActionClass, bool SetInputReleased)
+int32 UActionComponent::AllocateActionSlot(UActionBase* Action, int32 DenseIndex)
 {
-	for (UActionBase* Action : Actions)
-	{
-		if (Action && Action->IsA(ActionClass))
-		{
-			if (Action->IsRunning())
-			{
-				// Is Client?
-				if (!GetOwner()->HasAuthority())
-				{
-					ServerStopAction(Action->ActionTag);
-				}
-				if (SetInputReleased)
-				{
-					Action->InputReleased();
-				}
-				Action->StopAction();
-				return true;
-			}
-		}
-	}
+	const int32 SlotIndex = FreeActionSlots.Num() > 0 ? FreeActionSlots.Pop(false) : ActionSlots.AddDefaulted();
+
+	FActionSlot& Slot = ActionSlots[SlotIndex];
+	Slot.Action = Action;
+	Slot.DenseIndex = DenseIndex;
+	Slot.Priority = Action->GetDefinition().Priority;
+	bPriorityOrderDirty = true;
+	return SlotIndex;
+}
 
-	return false;
+void UActionComponent::FreeActionSlot(int32 SlotIndex)
+{
+	FActionSlot& Slot = ActionSlots[SlotIndex];
+	Slot.Action = nullptr;
+	Slot.DenseIndex = INDEX_NONE;
+	Slot.Generation++;
+	FreeActionSlots.Add(SlotIndex);
+	bPriorityOrderDirty = true;
 }
 
-bool UActionComponent::CancelActionByClass(TSubclassOf<UActionBase> ActionClass)
+const FActionSlot* UActionComponent::FindActionSlot(FActionHandle Handle) const
 {
-	for (UActionBase* Action : Actions)
+	if (!ActionSlots.IsValidIndex(Handle.Index))
 	{
-		if (Action && Action->IsA(ActionClass))
-		{
-			if (Action->IsRunning())
+		return nullptr;
+	}
+	const FActionSlot& Slot = ActionSlots[Handle.Index];
+	return Slot.Generation == Handle.Generation && Slot.Action ? &Slot : nullptr;
+}
+
+void UActionComponent::UpdateDenseIndices(int32 FirstIndex, int32 LastIndex)
+{
+	LastIndex = FMath::Min(LastIndex, ActionSlotIndices.Num() - 1);
+	for (int32 i = FirstIndex; i <= LastIndex; i++)
+	{
+		if (ActionSlotIndices[i] != INDEX_NONE)
+		{
+			ActionSlots[ActionSlotIndices[i]].DenseIndex = i;
+		}
+	}
+}
+
+bool UActionComponent::IsActionHandleValid(FActionHandle Handle) const
+{
+	return FindActionSlot(Handle) != nullptr;
+}
+
+UActionBase* UActionComponent::GetActionFromHandle(FActionHandle Handle) const
+{
+	const FActionSlot* Slot = FindActionSlot(Handle);
+	return Slot ? Slot->Action : nullptr;
+}
+
+FActionHandle UActionComponent::GetActionHandle(UActionBase* Action) const
+{
+	const FGrantedActionRecord* Record = ActionRecords.Find(GetGrantedAction(Action));
+	if (!Record || Record->SlotIndex == INDEX_NONE)
+	{
+		return FActionHandle();
+	}
+	return { Record->SlotIndex, ActionSlots[Record->SlotIndex].Generation };
+}
+
+void UActionComponent::RemoveActionByHandle(FActionHandle Handle)
+{
+	RemoveAction(GetActionFromHandle(Handle));
+}
+
+// a handle names one grant, so these act on that action only, never on another grant of a matching class
+bool UActionComponent::StartActionByHandle(FActionHandle Handle, bool SetInputPressed)
+{
+	return TryStartGrantedAction(GetActionFromHandle(Handle), SetInputPressed);
+}
+
+bool UActionComponent::StopActionByHandle(FActionHandle Handle, bool SetInputReleased)
+{
+	return TryStopGrantedAction(GetActionFromHandle(Handle), SetInputReleased, false);
+}
+
+bool UActionComponent::CancelActionByHandle(FActionHandle Handle)
+{
+	return TryStopGrantedAction(GetActionFromHandle(Handle), false, true);
+}
+
+bool UActionComponent::TryStartGrantedAction(UActionBase* Action, bool SetInputPressed)
+{
+	if (!Action)
+	{
+		return false;
+	}
+	FScopedActionTransaction Transaction(this);
+
+	if (bActionsInhibited)
+	{
+		NotifyActionFailed(Action, EFailureReason::Inhibited);
+		return false;
+	}
+
+	if (SetInputPressed)
+	{
+		ExecuteOnAction(Action, [](UActionBase* Target) { Target->InputPressed(); });
+	}
+	if (!CanStartGrantedAction(Action, GetOwner()))
+	{
+		NotifyActionFailed(Action, LastStartFailureReason);
+		TryQueueAction(Action, EQueuedActionStartMethod::ByAction, SetInputPressed);
+		return false;
+	}
+
+	if (!GetOwner()->HasAuthority())
+	{
+		ServerStartGrantedAction(Action, SetInputPressed);
+	}
+	StartGrantedAction(Action, SetInputPressed);
+	return true;
+}
+
+bool UActionComponent::TryStopGrantedAction(UActionBase* Action, bool SetInputReleased, bool bCancel)
+{
+	if (!IsActionRunning(Action))
+	{
+		return false;
+	}
+	FScopedActionTransaction Transaction(this);
+
+	if (!GetOwner()->HasAuthority())
+	{
+		ServerStopGrantedAction(Action, bCancel);
+	}
+	if (SetInputReleased)
+	{
+		ExecuteOnAction(Action, [](UActionBase* Target) { Target->InputReleased(); });
+	}
+	StopGrantedAction(Action, bCancel);
+	return true;
+}
+
+void UActionComponent::SetActionPriority(FActionHandle Handle, int32 NewPriority)
+{
+	if (FindActionSlot(Handle))
+	{
+		ActionSlots[Handle.Index].Priority = NewPriority;
+		bPriorityOrderDirty = true;
+	}
+}
+
+int32 UActionComponent::GetActionPriority(FActionHandle Handle) const
+{
+	const FActionSlot* Slot = FindActionSlot(Handle);
+	return Slot ? Slot->Priority : 0;
+}
+
+TArray<UActionBase*> UActionComponent::GetActionsByPriority()
+{
+	if (bPriorityOrderDirty)
+	{
+		bPriorityOrderDirty = false;
+
+		TArray<int32> SlotOrder;
+		SlotOrder.Reserve(ActionSlotIndices.Num());
+		for (int32 SlotIndex : ActionSlotIndices)
+		{
+			if (SlotIndex != INDEX_NONE)
+			{
+				SlotOrder.Add(SlotIndex);
+			}
+		}
+		SlotOrder.Sort([this](int32 A, int32 B)
+		{
+			const int32 PriorityA = ActionSlots[A].Priority;
+			const int32 PriorityB = ActionSlots[B].Priority;
+			return PriorityA != PriorityB ? PriorityA > PriorityB : A < B;
+		});
+
+		PrioritySortedActions.Reset(SlotOrder.Num());
+		for (int32 SlotIndex : SlotOrder)
+		{
+			PrioritySortedActions.Add(ActionSlots[SlotIndex].Action);
+		}
+	}
+	return PrioritySortedActions;
+}
+
+UActionBase* UActionComponent::CreateActionObject(TSubclassOf<UActionBase> ActionClass)
+{
+	LLM_SCOPE_BYTAG(ActionSystem_Actions);
+	UActionPoolSubsystem* Pool = GetWorld() ? GetWorld()->GetSubsystem<UActionPoolSubsystem>() : nullptr;
+	if (UActionBase* PooledAction = Pool ? Pool->AcquireAction(ActionClass, GetOwner()) : nullptr)
+	{
+		return PooledAction;
+	}
+	return NewObject<UActionBase>(GetOwner(), ActionClass);
+}
+
+void UActionComponent::ReleaseActionObject(UActionBase* Action)
+{
+	// the stop or remove that released it is still running on the object until the transaction closes
+	if (TransactionDepth > 0)
+	{
+		PendingPoolReleases.Add(Action);
+		return;
+	}
+
+	if (UActionPoolSubsystem* Pool = GetWorld() ? GetWorld()->GetSubsystem<UActionPoolSubsystem>() : nullptr)
+	{
+		Pool->ReleaseAction(Action);
+	}
+}
+
+UActionBase* UActionComponent::GetGrantedAction(UActionBase* Action) const
+{
+	if (Action && Action->IsInstantiated() && Action->GetDefinition().InstancingPolicy == EActionInstancingPolicy::InstancedPerExecution)
+	{
+		return Action->GetClass()->GetDefaultObject<UActionBase>();
+	}
+	return Action;
+}
+
+bool UActionComponent::IsActionRunning(const UActionBase* Action) const
+{
+	if (!Action)
+	{
+		return false;
+	}
+	if (Action->IsInstantiated())
+	{
+		return Action->IsRunning();
+	}
+
+	const FGrantedActionRecord* Record = ActionRecords.Find(Action);
+	if (!Record)
+	{
+		return false;
+	}
+	if (Action->GetDefinition().InstancingPolicy == EActionInstancingPolicy::InstancedPerExecution)
+	{
+		return Record->ExecutionInstance && Record->ExecutionInstance->IsRunning();
+	}
+	return Record->SharedState.RepData.bIsRunning;
+}
+
+bool UActionComponent::ExecuteOnAction(UActionBase* Action, TFunctionRef<void(UActionBase*)> Func)
+{
+	if (!Action)
+	{
+		return false;
+	}
+	if (Action->IsInstantiated())
+	{
+		Func(Action);
+		return true;
+	}
+	if (Action->GetDefinition().InstancingPolicy == EActionInstancingPolicy::InstancedPerExecution)
+	{
+		const FGrantedActionRecord* Record = ActionRecords.Find(Action);
+		if (!Record || !Record->ExecutionInstance)
+		{
+			return false;
+		}
+		Func(Record->ExecutionInstance);
+		return true;
+	}
+
+	FNonInstancedActionScope Scope(Action, this);
+	Func(Action);
+	return true;
+}
+
+bool UActionComponent::CanStartGrantedAction(UActionBase* Action, AActor* Instigator)
+{
+	SCOPE_CYCLE_COUNTER(STAT_CanStartAction);
+	// a per-execution action's class default never runs itself; a live instance means it is already running
+	if (!Action->IsInstantiated() && Action->GetDefinition().InstancingPolicy == EActionInstancingPolicy::InstancedPerExecution && IsActionRunning(Action))
+	{
+		LastStartFailureReason = EFailureReason::AlreadyRunning;
+		return false;
+	}
+
+	FNonInstancedActionScope Scope(Action, this);
+
+	// only pay for the Blueprint dispatch when CanStart may actually be overridden
+	const FGrantedActionRecord* Record = ActionRecords.Find(GetGrantedAction(Action));
+	if (Record && !Record->bHasCustomCanStart)
+	{
+		return Action->CheckCanStart(LastStartFailureReason);
+	}
+	const bool bCanStart = Action->CanStart(Instigator);
+	LastStartFailureReason = Action->GetState().LastFailureReason;
+	return bCanStart;
+}
+
+void UActionComponent::StartGrantedAction(UActionBase* Action, bool bSetInputPressed, const FActionActivationInfo* ActivationInfo)
+{
+	LLM_SCOPE_BYTAG(ActionSystem_Actions);
+	if (!Action->IsInstantiated() && Action->GetDefinition().InstancingPolicy == EActionInstancingPolicy::InstancedPerExecution)
+	{
+		// clients run the server's instance once it replicates
+		if (!GetOwner()->HasAuthority())
+		{
+			return;
+		}
+
+		UActionBase* Instance = CreateActionObject(Action->GetClass());
+		Instance->Initialize(this);
+		ExecutionInstances.Add(Instance);
+		Action = Instance;
+	}
+
+	FNonInstancedActionScope Scope(Action, this);
+	FActionSyncLoadScope SyncLoadScope(Action);
+	if (ActivationInfo)
+	{
+		Action->StartActionWithInfo(*ActivationInfo);
+	}
+	else
+	{
+		Action->StartAction(bSetInputPressed);
+	}
+}
+
+void UActionComponent::StopGrantedAction(UActionBase* Action, bool bCancel)
+{
+	ExecuteOnAction(Action, [bCancel](UActionBase* Target)
+	{
+		if (bCancel)
+		{
+			Target->CancelAction();
+		}
+		else
+		{
+			Target->StopAction();
+		}
+	});
+}
+
+void UActionComponent::RemoveAllActions()
+{
+	FScopedActionTransaction Transaction(this);
+
+	for (UActionBase* Action : Actions)
+	{
+		if (!IsValid(Action))
+		{
+			continue;
+		}
+		if (IsActionRunning(Action))
+		{
+			StopGrantedAction(Action, true);
+		}
+		NotifyActionRemoved(Action);
+		if (Action->IsInstantiated())
+		{
+			ReleaseActionObject(Action);
+		}
+	}
+	for (int32 SlotIndex : ActionSlotIndices)
+	{
+		if (SlotIndex != INDEX_NONE)
+		{
+			FreeActionSlot(SlotIndex);
+		}
+	}
+	Actions.Empty();
+	ActionDefinitions.Empty();
+	ActionSlotIndices.Empty();
+	ActionRecords.Empty();
+	if (NonInstancedStates.Num() > 0)
+	{
+		NonInstancedStates.Empty();
+		MARK_PROPERTY_DIRTY_FROM_NAME(UActionComponent, NonInstancedStates, this);
+	}
+	DEC_DWORD_STAT_BY(STAT_ActionSystem_RunningActions, RunningActions.Num());
+	RunningActions.Empty();
+	MarkActionsDirty();
+	TickedActions.Empty();
+	DefaultActions.Empty();
+	if (LazyActionClasses.Num() > 0)
+	{
+		LazyActionClasses.Empty();
+		MARK_PROPERTY_DIRTY_FROM_NAME(UActionComponent, LazyActionClasses, this);
+	}
+	ActionQueue.Empty();
+	InvalidateStartableActions();
+}
+
+void UActionComponent::RemoveAction(UActionBase* ActionToRemove)
+{
+	ActionToRemove = GetGrantedAction(ActionToRemove);
+	if (!IsValid(ActionToRemove) || !ActionRecords.Contains(ActionToRemove))
+	{
+		return;
+	}
+
+	FScopedActionTransaction Transaction(this);
+
+	if (IsActionRunning(ActionToRemove))
+	{
+		StopGrantedAction(ActionToRemove, true);
+	}
+
+	if (ActionToRemove->GetDefinition().bShouldActionTick)
+	{
+		TickedActions.RemoveSingleSwap(ActionToRemove);
+	}
+
+	UnlinkCancelGraph(ActionToRemove);
+
+	// swap the last entry into the gap instead of shifting everything after it
+	const int32 SlotIndex = ActionRecords.FindChecked(ActionToRemove).SlotIndex;
+	const int32 DenseIndex = ActionSlots[SlotIndex].DenseIndex;
+	Actions.RemoveAtSwap(DenseIndex, 1, false);
+	ActionDefinitions.RemoveAtSwap(DenseIndex, 1, false);
+	ActionSlotIndices.RemoveAtSwap(DenseIndex, 1, false);
+	UpdateDenseIndices(DenseIndex, DenseIndex);
+	FreeActionSlot(SlotIndex);
+	ActionRecords.Remove(ActionToRemove);
+	if (NonInstancedStates.RemoveAll([ActionToRemove](const FNonInstancedActionState& State) { return State.Action == ActionToRemove; }) > 0)
+	{
+		MARK_PROPERTY_DIRTY_FROM_NAME(UActionComponent, NonInstancedStates, this);
+	}
+	MarkActionsDirty();
+	InvalidateStartableActions();
+	ActionQueue.RemoveAll([ActionToRemove](const FQueuedActionRequest& Request) { return Request.Action == ActionToRemove; });
+	NotifyActionRemoved(ActionToRemove);
+
+	if (ActionToRemove->IsInstantiated())
+	{
+		ReleaseActionObject(ActionToRemove);
+	}
+}
+
+void UActionComponent::RemoveActionByClass(TSubclassOf<UActionBase> ActionToRemove)
+{
+	if (UActionBase* Action = FindActionByClass(ActionToRemove))
+	{
+		RemoveAction(Action);
+		return;
+	}
+
+	// never granted, so there is nothing to tear down
+	const int32 LazyIndex = FindLazyActionByClass(ActionToRemove);
+	if (LazyIndex != INDEX_NONE && GetOwner()->HasAuthority())
+	{
+		LazyActionClasses.RemoveAt(LazyIndex);
+		MARK_PROPERTY_DIRTY_FROM_NAME(UActionComponent, LazyActionClasses, this);
+	}
+}
+
+TArray<UActionBase*> UActionComponent::GetActionsWithTags(FGameplayTagContainer Tags)
+{
+	TArray<UActionBase*> OutActions = FindActionsWithTags(Tags);
+
+	for (int32 LazyIndex = LazyActionClasses.Num() - 1; LazyIndex >= 0 && GetOwner()->HasAuthority(); LazyIndex--)
+	{
+		const FGameplayTag ActionTag = LazyActionClasses[LazyIndex] ? LazyActionClasses[LazyIndex]->GetDefaultObject<UActionBase>()->GetDefinition().ActionTag : FGameplayTag();
+		if (ActionTag.IsValid() && Tags.HasTag(ActionTag))
+		{
+			if (UActionBase* Action = GrantLazyAction(LazyIndex))
+			{
+				OutActions.Add(Action);
+			}
+		}
+	}
+	return OutActions;
+}
+
+UActionBase* UActionComponent::GetActionByClass(TSubclassOf<UActionBase> ActionClass)
+{
+	if (UActionBase* Action = FindActionByClass(ActionClass))
+	{
+		return Action;
+	}
+
+	const int32 LazyIndex = FindLazyActionByClass(ActionClass);
+	return LazyIndex != INDEX_NONE ? GrantLazyAction(LazyIndex) : nullptr;
+}
+
+bool UActionComponent::StartActionByClass(TSubclassOf<UActionBase> ActionClass, bool SetInputPressed)
+{
+	SCOPE_CYCLE_COUNTER(STAT_StartActionByClass);
+	FScopedActionTransaction Transaction(this);
+
+	if (bActionsInhibited)
+	{
+		NotifyActionFailed(FindActionByClass(ActionClass), EFailureReason::Inhibited);
+		return false;
+	}
+
+	UActionBase* FailedAction = nullptr;
+	for (UActionBase* Action : Actions)
+	{
+		if (Action && Action->IsA(ActionClass))
+		{
+			if (SetInputPressed)
+			{
+				ExecuteOnAction(Action, [](UActionBase* Target) { Target->InputPressed(); });
+			}
+			if (!CanStartGrantedAction(Action, GetOwner()))
+			{
+				NotifyActionFailed(Action, LastStartFailureReason);
+				// FString FailedMsg = FString::Printf(TEXT("Failed to run: %s"), *GetNameSafe(Action));
+				// GEngine->AddOnScreenDebugMessage(-1, 2.0f, FColor::Red, FailedMsg);
+				FailedAction = FailedAction ? FailedAction : Action;
+				continue;
+			}
+
+			UE_LOG(LogTemp, Warning, TEXT("Calling Action Start"))
+			
+			// Is Client?
+			if (!GetOwner()->HasAuthority())
+			{
+				// UE_LOG(LogTemp, Warning, TEXT("Calling Server Action Start"))
+				ServerStartActionByClass(ActionClass);
+			}
+
+			StartGrantedAction(Action, SetInputPressed);
+			return true;
+		}
+	}
+
+	if (!FailedAction)
+	{
+		// first use of a lazy default action: the server grants it, a client forwards the start to the server
+		const int32 LazyIndex = FindLazyActionByClass(ActionClass);
+		if (LazyIndex != INDEX_NONE)
+		{
+			if (!GetOwner()->HasAuthority())
+			{
+				ServerStartActionByClass(ActionClass);
+				return true;
+			}
+			return GrantLazyAction(LazyIndex) && StartActionByClass(ActionClass, SetInputPressed);
+		}
+	}
+
+	TryQueueAction(FailedAction, EQueuedActionStartMethod::ByClass, SetInputPressed);
+	return false;
+}
+
+bool UActionComponent::StartActionByTag(FGameplayTag ActionTag)
+{
+	SCOPE_CYCLE_COUNTER(STAT_StartActionByTag);
+	FScopedActionTransaction Transaction(this);
+
+	if (bActionsInhibited)
+	{
+		NotifyActionFailed(FindActionByTag(ActionTag), EFailureReason::Inhibited);
+		return false;
+	}
+	
+	UActionBase* FailedAction = nullptr;
+	for (int32 i = 0; i < Actions.Num(); i++)
+	{
+		UActionBase* Action = Actions[i];
+		if (ActionDefinitions[i] && ActionDefinitions[i]->ActionTag.MatchesTagExact(ActionTag))
+		{
+			if (!CanStartGrantedAction(Action, GetOwner()))
+			{
+				NotifyActionFailed(Action, LastStartFailureReason);
+				// FString FailedMsg = FString::Printf(TEXT("Failed to run: %s"), *ActionTag.ToString());
+				// GEngine->AddOnScreenDebugMessage(-1, 2.0f, FColor::Red, FailedMsg);
+				FailedAction = FailedAction ? FailedAction : Action;
+				continue;
+			}
+
+			// Is Client?
+			if (!GetOwner()->HasAuthority())
+			{
+				ServerStartAction(ActionTag);
+			}
+
+			StartGrantedAction(Action, false);
+			return true;
+		}
+	}
+
+	if (!FailedAction)
+	{
+		const int32 LazyIndex = FindLazyActionByTag(ActionTag);
+		if (LazyIndex != INDEX_NONE)
+		{
+			if (!GetOwner()->HasAuthority())
+			{
+				ServerStartAction(ActionTag);
+				return true;
+			}
+			return GrantLazyAction(LazyIndex) && StartActionByTag(ActionTag);
+		}
+	}
+
+	TryQueueAction(FailedAction, EQueuedActionStartMethod::ByTag);
+	return false;
+}
+
+bool UActionComponent::StopActionByClass(TSubclassOf<UActionBase> ActionClass, bool SetInputReleased)
+{
+	FScopedActionTransaction Transaction(this);
+
+	for (UActionBase* Action : Actions)
+	{
+		if (Action && Action->IsA(ActionClass))
+		{
+			if (IsActionRunning(Action))
+			{
+				// Is Client?
+				if (!GetOwner()->HasAuthority())
+				{
+					ServerStopActionByClass(ActionClass);
+				}
+				if (SetInputReleased)
+				{
+					ExecuteOnAction(Action, [](UActionBase* Target) { Target->InputReleased(); });
+				}
+				StopGrantedAction(Action, false);
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+bool UActionComponent::CancelActionByClass(TSubclassOf<UActionBase> ActionClass)
+{
+	FScopedActionTransaction Transaction(this);
+
+	for (UActionBase* Action : Actions)
+	{
+		if (Action && Action->IsA(ActionClass))
+		{
+			if (IsActionRunning(Action))
+			{
+				// Is Client?
+				if (!GetOwner()->HasAuthority())
+				{
+					ServerCancelActionByClass(ActionClass);
+				}
+				StopGrantedAction(Action, true);
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+bool UActionComponent::CancelActionsByTag(FGameplayTagContainer ActionTags)
+{
+	if (ActionTags.IsEmpty() || RunningActions.Num() == 0)
+	{
+		return false;
+	}
+
+	TArray<UActionBase*, TInlineAllocator<8>> ActionsToCancel;
+	for (UActionBase* Action : RunningActions)
+	{
+		if (Action && ActionTags.HasTagExact(Action->GetDefinition().ActionTag))
+		{
+			ActionsToCancel.Add(Action);
+		}
+	}
+
+	CancelRunningActions(ActionsToCancel);
+	return ActionsToCancel.Num() > 0;
+}
+
+bool UActionComponent::CancelActionTargets(UActionBase* Action)
+{
+	const FGrantedActionRecord* Record = ActionRecords.Find(GetGrantedAction(Action));
+	if (!Record || Record->CancelTargets.Num() == 0 || RunningActions.Num() == 0)
+	{
+		return false;
+	}
+
+	// walk whichever side is smaller; both are usually a handful of actions
+	TArray<UActionBase*, TInlineAllocator<8>> ActionsToCancel;
+	if (RunningActions.Num() < Record->CancelTargets.Num())
+	{
+		for (UActionBase* RunningAction : RunningActions)
+		{
+			if (Record->CancelTargets.Contains(RunningAction))
+			{
+				ActionsToCancel.Add(RunningAction);
+			}
+		}
+	}
+	else
+	{
+		for (UActionBase* Target : Record->CancelTargets)
+		{
+			if (IsActionRunning(Target))
+			{
+				ActionsToCancel.Add(Target);
+			}
+		}
+	}
+
+	CancelRunningActions(ActionsToCancel);
+	return ActionsToCancel.Num() > 0;
+}
+
+void UActionComponent::CancelRunningActions(TArrayView<UActionBase* const> ActionsToCancel)
+{
+	FScopedActionTransaction Transaction(this);
+
+	for (UActionBase* Action : ActionsToCancel)
+	{
+		// an earlier cancel may have stopped this one already
+		if (!IsValid(Action) || !IsActionRunning(Action))
+		{
+			continue;
+		}
+		// Is Client?
+		if (!GetOwner()->HasAuthority())
+		{
+			ServerCancelAction(Action->GetDefinition().ActionTag);
+		}
+		StopGrantedAction(Action, true);
+	}
+}
+
+void UActionComponent::SetActionRunning(UActionBase* Action, bool bRunning)
+{
+	UActionBase* GrantedAction = GetGrantedAction(Action);
+	if (bRunning)
+	{
+		if (!RunningActions.Contains(GrantedAction))
+		{
+			RunningActions.Add(GrantedAction);
+			INC_DWORD_STAT(STAT_ActionSystem_RunningActions);
+		}
+	}
+	else if (RunningActions.RemoveSingle(GrantedAction) > 0)
+	{
+		DEC_DWORD_STAT(STAT_ActionSystem_RunningActions);
+	}
+
+	// the class default is shared, so the running state of a non-instanced action replicates through this component
+	if (!Action->IsInstantiated() && GetOwner()->HasAuthority())
+	{
+		if (const FGrantedActionRecord* Record = ActionRecords.Find(Action))
+		{
+			FNonInstancedActionState* Entry = NonInstancedStates.FindByPredicate([Action](const FNonInstancedActionState& State) { return State.Action == Action; });
+			if (!Entry)
+			{
+				Entry = &NonInstancedStates.AddDefaulted_GetRef();
+				Entry->Action = Action;
+			}
+			Entry->RepData = Record->SharedState.RepData;
+			MARK_PROPERTY_DIRTY_FROM_NAME(UActionComponent, NonInstancedStates, this);
+		}
+	}
+
+	// per-execution instance
+	if (GrantedAction != Action)
+	{
+		FGrantedActionRecord* Record = ActionRecords.Find(GrantedAction);
+		if (bRunning)
+		{
+			if (Record)
+			{
+				Record->ExecutionInstance = Action;
+			}
+		}
+		else
+		{
+			if (Record && Record->ExecutionInstance == Action)
+			{
+				Record->ExecutionInstance = nullptr;
+			}
+			// release it; clients stop their copy when it leaves the replicated list
+			if (GetOwner()->HasAuthority())
+			{
+				ExecutionInstances.RemoveSingleSwap(Action);
+				ReleaseActionObject(Action);
+			}
+		}
+	}
+}
+
+void UActionComponent::OnRep_NonInstancedStates()
+{
+	ApplyNonInstancedStates();
+}
+
+void UActionComponent::ApplyNonInstancedStates()
+{
+	if (GetOwner()->HasAuthority())
+	{
+		return;
+	}
+
+	for (const FNonInstancedActionState& State : NonInstancedStates)
+	{
+		// actions that have not replicated yet are applied by SyncReplicatedActions
+		const FGrantedActionRecord* Record = State.Action ? ActionRecords.Find(State.Action) : nullptr;
+		if (!Record || Record->SharedState.RepData.bIsRunning == State.RepData.bIsRunning)
+		{
+			continue;
+		}
+
+		const bool bRunning = State.RepData.bIsRunning;
+		ExecuteOnAction(State.Action, [bRunning](UActionBase* Target)
+		{
+			if (bRunning)
+			{
+				Target->StartAction();
+			}
+			else
+			{
+				Target->StopAction();
+			}
+		});
+	}
+}
+
+void UActionComponent::OnRep_ExecutionInstances(const TArray<UActionBase*>& PreviousInstances)
+{
+	for (UActionBase* Instance : PreviousInstances)
+	{
+		if (IsValid(Instance) && Instance->IsRunning() && !ExecutionInstances.Contains(Instance))
+		{
+			Instance->StopAction();
+		}
+	}
+}
+
+void UActionComponent::LinkCancelGraph(UActionBase* NewAction)
+{
+	// every other granted action already has a record, so FindChecked below never invalidates NewRecord
+	FGrantedActionRecord& NewRecord = ActionRecords.FindOrAdd(NewAction);
+	const FActionDefinition& NewDefinition = NewAction->GetDefinition();
+	for (UActionBase* Other : Actions)
+	{
+		if (!Other)
+		{
+			continue;
+		}
+		const FActionDefinition& OtherDefinition = Other->GetDefinition();
+		if (NewDefinition.CancelTags.HasTagExact(OtherDefinition.ActionTag))
+		{
+			NewRecord.CancelTargets.Add(Other);
+			ActionRecords.FindChecked(Other).CancelSources.Add(NewAction);
+		}
+		if (Other != NewAction && OtherDefinition.CancelTags.HasTagExact(NewDefinition.ActionTag))
+		{
+			ActionRecords.FindChecked(Other).CancelTargets.Add(NewAction);
+			NewRecord.CancelSources.Add(Other);
+		}
+	}
+}
+
+void UActionComponent::UnlinkCancelGraph(UActionBase* OldAction)
+{
+	FGrantedActionRecord* OldRecord = ActionRecords.Find(OldAction);
+	if (!OldRecord)
+	{
+		return;
+	}
+
+	for (UActionBase* Target : OldRecord->CancelTargets)
+	{
+		if (FGrantedActionRecord* TargetRecord = ActionRecords.Find(Target))
+		{
+			TargetRecord->CancelSources.RemoveSingleSwap(OldAction);
+		}
+	}
+	for (UActionBase* Source : OldRecord->CancelSources)
+	{
+		if (FGrantedActionRecord* SourceRecord = ActionRecords.Find(Source))
+		{
+			SourceRecord->CancelTargets.RemoveSingleSwap(OldAction);
+		}
+	}
+	OldRecord->CancelTargets.Reset();
+	OldRecord->CancelSources.Reset();
+}
+
+void UActionComponent::SyncReplicatedActions()
+{
+	TSet<UActionBase*> GrantedSet;
+	GrantedSet.Reserve(Actions.Num());
+	for (UActionBase* Action : Actions)
+	{
+		if (Action)
+		{
+			GrantedSet.Add(Action);
+		}
+	}
+
+	// keep the slot and per-actor state of actions that are still granted, so their handles stay valid
+	for (auto It = ActionRecords.CreateIterator(); It; ++It)
+	{
+		if (!GrantedSet.Contains(It.Key()))
+		{
+			if (It.Value().SlotIndex != INDEX_NONE)
+			{
+				FreeActionSlot(It.Value().SlotIndex);
+			}
+			It.RemoveCurrent();
+			continue;
+		}
+		It.Value().CancelTargets.Reset();
+		It.Value().CancelSources.Reset();
+	}
+
+	TArray<UActionBase*> NewActions;
+	ActionDefinitions.Reset(Actions.Num());
+	ActionSlotIndices.Reset(Actions.Num());
+	for (int32 i = 0; i < Actions.Num(); i++)
+	{
+		UActionBase* Action = Actions[i];
+		if (!Action)
+		{
+			// not resolved yet; picked up by the next OnRep
+			ActionDefinitions.Add(nullptr);
+			ActionSlotIndices.Add(INDEX_NONE);
+			continue;
+		}
+
+		FGrantedActionRecord& Record = ActionRecords.FindOrAdd(Action);
+		if (Record.SlotIndex == INDEX_NONE)
+		{
+			Record.SlotIndex = AllocateActionSlot(Action, i);
+			Record.bHasCustomCanStart = HasCustomCanStart(Action->GetClass());
+			NewActions.Add(Action);
+		}
+		ActionSlots[Record.SlotIndex].DenseIndex = i;
+		ActionDefinitions.Add(&Action->GetDefinition());
+		ActionSlotIndices.Add(Record.SlotIndex);
+	}
+	bPriorityOrderDirty = true;
+	RequestActionAssets(NewActions);
+	UpdateStorageStats();
+
+	// link one at a time against the actions linked so far, exactly like granting them in order
+	TArray<UActionBase*> GrantedActions = MoveTemp(Actions);
+	Actions.Reset(GrantedActions.Num());
+	for (UActionBase* Action : GrantedActions)
+	{
+		Actions.Add(Action);
+		if (Action)
+		{
+			LinkCancelGraph(Action);
+		}
+	}
+
+	ApplyNonInstancedStates();
+}
+
+void UActionComponent::OnRep_Actions()
+{
+	// clients never go through AddAction, so rebuild slots and the cancel graph from the replicated list
+	SyncReplicatedActions();
+	InvalidateStartableActions();
+}
+
+void UActionComponent::ServerCancelAction_Implementation(FGameplayTag ActionTag)
+{
+	CSV_CUSTOM_STAT(ActionSystem, ServerActionRPCs, 1, ECsvCustomStatOp::Accumulate);
+	FActionSystemNetCounters::ServerActionRPCs++;
+	CancelActionByTag(ActionTag);
+}
+
+bool UActionComponent::StopActionByTag(FGameplayTag ActionTag)
+{
+	FScopedActionTransaction Transaction(this);
+
+	for (int32 i = 0; i < Actions.Num(); i++)
+	{
+		UActionBase* Action = Actions[i];
+		if (ActionDefinitions[i] && ActionDefinitions[i]->ActionTag.MatchesTagExact(ActionTag))
+		{
+			if (IsActionRunning(Action))
+			{
+				// Is Client?
+				if (!GetOwner()->HasAuthority())
+				{
+					ServerStopAction(ActionTag);
+				}
+
+				StopGrantedAction(Action, false);
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+bool UActionComponent::CancelActionByTag(FGameplayTag ActionTag)
+{
+	FScopedActionTransaction Transaction(this);
+
+	for (int32 i = 0; i < Actions.Num(); i++)
+	{
+		UActionBase* Action = Actions[i];
+		if (ActionDefinitions[i] && ActionDefinitions[i]->ActionTag.MatchesTagExact(ActionTag))
+		{
+			if (IsActionRunning(Action))
 			{
 				// Is Client?
 				if (!GetOwner()->HasAuthority())
 				{
-					ServerCancelAction(Action->ActionTag);
+					ServerCancelAction(ActionTag);
 				}
-				Action->CancelAction();
+
+				StopGrantedAction(Action, true);
 				return true;
 			}
 		}
 	}
 
-	return false;
+	return false;
+}
+
+bool UActionComponent::CancelAllActions()
+{
+	if (RunningActions.Num() == 0)
+	{
+		return false;
+	}
+
+	const TArray<UActionBase*> ActionsToCancel = RunningActions;
+	CancelRunningActions(ActionsToCancel);
+	return true;
+}
+
+void UActionComponent::SetActionsInhibited(bool bNewInhibited)
+{
+	bActionsInhibited = bNewInhibited;
+	InvalidateStartableActions();
+}
+
+bool UActionComponent::GetActionsInhibited()
+{
+	return bActionsInhibited;
+}
+
+const TBitArray<>& UActionComponent::EvaluateStartableActions()
+{
+	SCOPE_CYCLE_COUNTER(STAT_EvaluateStartableActions);
+	const float Now = GetWorld() ? GetWorld()->GetTimeSeconds() : 0.0f;
+	if (!bStartableActionsDirty && Now < StartableActionsExpireTime && StartableActions.Num() == Actions.Num())
+	{
+		return StartableActions;
+	}
+
+	StartableActions.Init(false, Actions.Num());
+	StartableActionsExpireTime = MAX_flt;
+	bStartableActionsDirty = false;
+
+	if (bActionsInhibited)
+	{
+		return StartableActions;
+	}
+
+	for (int32 i = 0; i < Actions.Num(); i++)
+	{
+		UActionBase* Action = Actions[i];
+		if (!Action)
+		{
+			continue;
+		}
+
+		FNonInstancedActionScope Scope(Action, this);
+		const bool bCanStart = CanStartGrantedAction(Action, GetOwner());
+		StartableActions[i] = bCanStart;
+
+		if (!bCanStart && LastStartFailureReason == EFailureReason::OnCooldown)
+		{
+			StartableActionsExpireTime = FMath::Min(StartableActionsExpireTime, Now + Action->GetCooldownTimeRemaining());
+		}
+	}
+
+	return StartableActions;
+}
+
+TArray<bool> UActionComponent::GetStartableActions()
+{
+	const TBitArray<>& Startable = EvaluateStartableActions();
+
+	TArray<bool> OutStartable;
+	OutStartable.SetNumUninitialized(Startable.Num());
+	for (int32 i = 0; i < Startable.Num(); i++)
+	{
+		OutStartable[i] = Startable[i];
+	}
+	return OutStartable;
+}
+
+bool UActionComponent::IsActionStartable(UActionBase* Action)
+{
+	const FGrantedActionRecord* Record = ActionRecords.Find(GetGrantedAction(Action));
+	if (!Record || Record->SlotIndex == INDEX_NONE)
+	{
+		return false;
+	}
+	const int32 DenseIndex = ActionSlots[Record->SlotIndex].DenseIndex;
+	return EvaluateStartableActions()[DenseIndex];
+}
+
+void UActionComponent::InvalidateStartableActions()
+{
+	bStartableActionsDirty = true;
+}
+
+UStatsComponent* UActionComponent::GetOwnerStatsComponent() const
+{
+	return OwnerStatsComponent;
+}
+
+void UActionComponent::OnOwnerStatChanged(FGameplayTag Stat, float NewValue, float OldValue)
+{
+	InvalidateStartableActions();
+}
+
+void UActionComponent::OnOwnerStatValuesUpdated(UStatsComponent* StatsComponent)
+{
+	InvalidateStartableActions();
+}
+
+void UActionComponent::ActionInputPressedByTag(FGameplayTag Tag)
+{
+	ExecuteOnAction(FindActionByTag(Tag), [](UActionBase* Action) { Action->OnInputPressed(); });
+}
+
+void UActionComponent::ActionInputReleasedByTag(FGameplayTag Tag)
+{
+	ExecuteOnAction(FindActionByTag(Tag), [](UActionBase* Action) { Action->InputReleased(); });
+}
+
+void UActionComponent::ActionInputPressedByClass(TSubclassOf<UActionBase> ActionClass)
+{
+	ExecuteOnAction(FindActionByClass(ActionClass), [](UActionBase* Action) { Action->OnInputPressed(); });
+}
+
+void UActionComponent::ActionInputReleasedByClass(TSubclassOf<UActionBase> ActionClass)
+{
+	ExecuteOnAction(FindActionByClass(ActionClass), [](UActionBase* Action) { Action->InputReleased(); });
+}
+
+void UActionComponent::AddActiveTag(FGameplayTag NewTag)
+{
+	const bool bDeferred = DeferTagNotifications();
+	ActiveGameplayTags.AddTag(NewTag);
+	TRACE_ACTION_TAG_CHANGED(this, NewTag, true);
+	CSV_CUSTOM_STAT(ActionSystem, TagsAdded, 1, ECsvCustomStatOp::Accumulate);
+	InvalidateStartableActions();
+	if (!bDeferred)
+	{
+		OnTagAdded.Broadcast(NewTag);
+	}
+}
+
+void UActionComponent::AddActiveTags(FGameplayTagContainer NewTags)
+{
+	SCOPE_CYCLE_COUNTER(STAT_AddActiveTags);
+	if (!DeferTagNotifications())
+	{
+		TArray<FGameplayTag> Tags;
+		NewTags.GetGameplayTagArray(Tags);
+		for (FGameplayTag CurrentTag : Tags)
+		{
+			OnTagAdded.Broadcast(CurrentTag);
+		}
+	}
+	ActiveGameplayTags.AppendTags(NewTags);
+	TRACE_ACTION_TAGS_CHANGED(this, NewTags, true);
+	CSV_CUSTOM_STAT(ActionSystem, TagsAdded, NewTags.Num(), ECsvCustomStatOp::Accumulate);
+	InvalidateStartableActions();
+}
+
+bool UActionComponent::RemoveActiveTag(FGameplayTag TagToRemove)
+{
+	if (ActiveGameplayTags.HasTag(TagToRemove))
+	{
+		const bool bDeferred = DeferTagNotifications();
+		ActiveGameplayTags.RemoveTag(TagToRemove);
+		TRACE_ACTION_TAG_CHANGED(this, TagToRemove, false);
+		CSV_CUSTOM_STAT(ActionSystem, TagsRemoved, 1, ECsvCustomStatOp::Accumulate);
+		InvalidateStartableActions();
+		if (!bDeferred)
+		{
+			OnTagRemoved.Broadcast(TagToRemove);
+		}
+		ScheduleActionQueue();
+		return true;
+	}
+	return false;
+}
+
+void UActionComponent::ServerStartAction_Implementation(FGameplayTag ActionTag)
+{
+	CSV_CUSTOM_STAT(ActionSystem, ServerActionRPCs, 1, ECsvCustomStatOp::Accumulate);
+	FActionSystemNetCounters::ServerActionRPCs++;
+	UE_LOG(LogTemp, Warning, TEXT("Server Starting action..."))
+	StartActionByTag(ActionTag);
+}
+
+void UActionComponent::ServerStartActionWithInfo_Implementation(FGameplayTag ActionTag, FActionActivationInfo ActivationInfo)
+{
+	CSV_CUSTOM_STAT(ActionSystem, ServerActionRPCs, 1, ECsvCustomStatOp::Accumulate);
+	FActionSystemNetCounters::ServerActionRPCs++;
+	UE_LOG(LogTemp, Warning, TEXT("Server Starting action with info..."))
+	StartActionWithInfo(ActionTag, ActivationInfo);
+}
+
+
+void UActionComponent::RemoveActiveTags(FGameplayTagContainer TagsToRemove)
+{
+	SCOPE_CYCLE_COUNTER(STAT_RemoveActiveTags);
+	if (!DeferTagNotifications())
+	{
+		TArray<FGameplayTag> Tags;
+		TagsToRemove.GetGameplayTagArray(Tags);
+		for (FGameplayTag CurrentTag : Tags)
+		{
+			OnTagRemoved.Broadcast(CurrentTag);
+		}
+	}
+	ActiveGameplayTags.RemoveTags(TagsToRemove);
+	TRACE_ACTION_TAGS_CHANGED(this, TagsToRemove, false);
+	CSV_CUSTOM_STAT(ActionSystem, TagsRemoved, TagsToRemove.Num(), ECsvCustomStatOp::Accumulate);
+	InvalidateStartableActions();
+	ScheduleActionQueue();
+}
+
+void UActionComponent::CommitCooldown(FGameplayTag CooldownTag, float Duration)
+{
+	if (CooldownTag.IsValid())
+	{
+		CommitCooldownEntry(CooldownTag, nullptr, Duration);
+	}
+}
+
+void UActionComponent::CommitActionCooldown(const UActionBase* Action, float Duration)
+{
+	const FGameplayTag CooldownTag = Action->GetCooldownTag();
+	CommitCooldownEntry(CooldownTag, CooldownTag.IsValid() ? nullptr : Action->GetClass(), Duration);
+}
+
+const FActionCooldown* UActionComponent::FindActiveActionCooldown(const UActionBase* Action) const
+{
+	const FGameplayTag CooldownTag = Action->GetCooldownTag();
+	return FindActiveCooldown(CooldownTag, CooldownTag.IsValid() ? nullptr : Action->GetClass());
+}
+
+void UActionComponent::CommitCooldownEntry(FGameplayTag CooldownTag, const UClass* ActionClass, float Duration)
+{
+	if (Duration <= 0.0f)
+	{
+		return;
+	}
+
+	const float Now = GetCooldownClockTime();
+
+	// drop expired entries so the replicated array only ever holds live cooldowns
+	Cooldowns.RemoveAllSwap([Now](const FActionCooldown& Entry) { return Entry.EndTime <= Now; });
+
+	FActionCooldown* Entry = Cooldowns.FindByPredicate([CooldownTag, ActionClass](const FActionCooldown& Cooldown) { return Cooldown.Matches(CooldownTag, ActionClass); });
+	if (!Entry)
+	{
+		Entry = &Cooldowns.AddDefaulted_GetRef();
+		Entry->CooldownTag = CooldownTag;
+		Entry->ActionClass = const_cast<UClass*>(ActionClass);
+	}
+	Entry->EndTime = Now + Duration;
+	Entry->Duration = Duration;
+	InvalidateStartableActions();
+	MarkCooldownsDirty();
+}
+
+void UActionComponent::ClearCooldown(FGameplayTag CooldownTag)
+{
+	const int32 Index = Cooldowns.IndexOfByKey(CooldownTag);
+	if (Index != INDEX_NONE)
+	{
+		Cooldowns.RemoveAtSwap(Index);
+		InvalidateStartableActions();
+		MarkCooldownsDirty();
+	}
+}
+
+bool UActionComponent::IsCooldownActive(FGameplayTag CooldownTag) const
+{
+	return FindActiveCooldown(CooldownTag) != nullptr;
+}
+
+float UActionComponent::GetCooldownTimeRemainingByTag(FGameplayTag CooldownTag) const
+{
+	if (const FActionCooldown* Entry = FindActiveCooldown(CooldownTag))
+	{
+		return Entry->EndTime - GetCooldownClockTime();
+	}
+	return 0.0f;
+}
+
+TMap<FGameplayTag, float> UActionComponent::GetAllCooldownFractions(TMap<TSubclassOf<UActionBase>, float>& OutActionClassFractions) const
+{
+	TMap<FGameplayTag, float> Fractions;
+	Fractions.Reserve(Cooldowns.Num());
+	OutActionClassFractions.Reset();
+
+	const float Now = GetCooldownClockTime();
+	for (const FActionCooldown& Entry : Cooldowns)
+	{
+		if (Entry.EndTime > Now && Entry.Duration > 0.0f)
+		{
+			const float Fraction = FMath::Clamp((Entry.EndTime - Now) / Entry.Duration, 0.0f, 1.0f);
+			if (Entry.ActionClass)
+			{
+				OutActionClassFractions.Add(Entry.ActionClass, Fraction);
+			}
+			else
+			{
+				Fractions.Add(Entry.CooldownTag, Fraction);
+			}
+		}
+	}
+	return Fractions;
+}
+
+TArray<float> UActionComponent::GetCooldownFractions(const TArray<FGameplayTag>& CooldownTags) const
+{
+	TArray<float> Fractions;
+	Fractions.SetNumZeroed(CooldownTags.Num());
+
+	const float Now = GetCooldownClockTime();
+	for (int32 i = 0; i < CooldownTags.Num(); i++)
+	{
+		const FActionCooldown* Entry = Cooldowns.FindByKey(CooldownTags[i]);
+		if (Entry && Entry->EndTime > Now && Entry->Duration > 0.0f)
+		{
+			Fractions[i] = FMath::Clamp((Entry->EndTime - Now) / Entry->Duration, 0.0f, 1.0f);
+		}
+	}
+	return Fractions;
+}
+
+float UActionComponent::GetCooldownClockTime() const
+{
+	UWorld* World = GetWorld();
+	if (!World)
+	{
+		return 0.0f;
+	}
+	if (AGameStateBase* GameState = World->GetGameState())
+	{
+		return GameState->GetServerWorldTimeSeconds();
+	}
+	return World->GetTimeSeconds();
+}
+
+void UActionComponent::OnRep_Cooldowns()
+{
+	InvalidateStartableActions();
+}
+
+void UActionComponent::OnRep_ActiveGameplayTags()
+{
+	InvalidateStartableActions();
+}
+
+const FActionCooldown* UActionComponent::FindActiveCooldown(FGameplayTag CooldownTag, const UClass* ActionClass) const
+{
+	const FActionCooldown* Entry = Cooldowns.FindByPredicate([CooldownTag, ActionClass](const FActionCooldown& Cooldown) { return Cooldown.Matches(CooldownTag, ActionClass); });
+	if (Entry && Entry->EndTime > GetCooldownClockTime())
+	{
+		return Entry;
+	}
+	return nullptr;
+}
+
+void UActionComponent::GetOwnedGameplayTags(FGameplayTagContainer& TagContainer) const
+{
+	TagContainer = ActiveGameplayTags;
+}
+
+bool UActionComponent::HasAllMatchingGameplayTags(const FGameplayTagContainer& GameplayTags) const
+{
+	return ActiveGameplayTags.HasAll(GameplayTags);
+}
+
+bool UActionComponent::HasMatchingGameplayTag(FGameplayTag TagToCheck) const
+{
+	return ActiveGameplayTags.HasTag(TagToCheck);
+}
+
+bool UActionComponent::HasAnyMatchingGameplayTags(const FGameplayTagContainer& GameplayTags) const
+{
+	return ActiveGameplayTags.HasAny(GameplayTags);
 }
 
-bool UActionComponent::CancelActionsByTag(FGameplayTagContainer ActionTags)
+void UActionComponent::ServerStopAction_Implementation(FGameplayTag ActionTag)
 {
-	bool bCanceledAny = false;
-	for (UActionBase* Action : Actions)
-	{
-		if (Action && ActionTags.HasTagExact(Action->ActionTag))
-		{
-			if (Action->IsRunning())
-			{
-				// Is Client?
-				if (!GetOwner()->HasAuthority())
-				{
-					ServerCancelAction(Action->ActionTag);
-				}
-				bCanceledAny = true;
-				Action->CancelAction();
-			}
-		}
-	}
+	CSV_CUSTOM_STAT(ActionSystem, ServerActionRPCs, 1, ECsvCustomStatOp::Accumulate);
+	FActionSystemNetCounters::ServerActionRPCs++;
+	StopActionByTag(ActionTag);
+}
 
-	return bCanceledAny;
+AActor* UActionComponent::GetGameplayTaskAvatar(const UGameplayTask* Task) const
+{
+	return GetOwner();
 }
 
-void UActionComponent::ServerCancelAction_Implementation(FGameplayTag ActionTag)
+void UActionComponent::ServerStartActionByClass_Implementation(TSubclassOf<UActionBase> ActionClass)
 {
-	CancelActionByTag(ActionTag);
+	CSV_CUSTOM_STAT(ActionSystem, ServerActionRPCs, 1, ECsvCustomStatOp::Accumulate);
+	FActionSystemNetCounters::ServerActionRPCs++;
+	StartActionByClass(ActionClass);
 }
 
-bool UActionComponent::StopActionByTag(FGameplayTag ActionTag)
+void UActionComponent::ServerStopActionByClass_Implementation(TSubclassOf<UActionBase> ActionClass)
 {
-	for (UActionBase* Action : Actions)
-	{
-		if (Action && Action->ActionTag.MatchesTagExact(ActionTag))
-		{
-			if (Action->IsRunning())
-			{
-				// Is Client?
-				if (!GetOwner()->HasAuthority())
-				{
-					ServerStopAction(ActionTag);
-				}
+	CSV_CUSTOM_STAT(ActionSystem, ServerActionRPCs, 1, ECsvCustomStatOp::Accumulate);
+	FActionSystemNetCounters::ServerActionRPCs++;
+	StopActionByClass(ActionClass, false);
+}
 
-				Action->StopAction();
-				return true;
-			}
-		}
+void UActionComponent::ServerCancelActionByClass_Implementation(TSubclassOf<UActionBase> ActionClass)
+{
+	CSV_CUSTOM_STAT(ActionSystem, ServerActionRPCs, 1, ECsvCustomStatOp::Accumulate);
+	FActionSystemNetCounters::ServerActionRPCs++;
+	CancelActionByClass(ActionClass);
+}
+
+void UActionComponent::ServerStartGrantedAction_Implementation(UActionBase* Action, bool SetInputPressed)
+{
+	CSV_CUSTOM_STAT(ActionSystem, ServerActionRPCs, 1, ECsvCustomStatOp::Accumulate);
+	FActionSystemNetCounters::ServerActionRPCs++;
+	// only actions granted to this component, whatever the client names
+	if (Actions.Contains(Action))
+	{
+		TryStartGrantedAction(Action, SetInputPressed);
 	}
+}
 
-	return false;
+void UActionComponent::ServerStopGrantedAction_Implementation(UActionBase* Action, bool bCancel)
+{
+	CSV_CUSTOM_STAT(ActionSystem, ServerActionRPCs, 1, ECsvCustomStatOp::Accumulate);
+	FActionSystemNetCounters::ServerActionRPCs++;
+	if (Actions.Contains(Action))
+	{
+		TryStopGrantedAction(Action, false, bCancel);
+	}
 }
 
-bool UActionComponent::CancelActionByTag(FGameplayTag ActionTag)
+void UActionComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-	for (UActionBase* Action : Actions)
+	ClearActionQueue();
+
+	if (OwnerStatsComponent)
 	{
-		if (Action && Action->ActionTag.MatchesTagExact(ActionTag))
-		{
-			if (Action->IsRunning())
-			{
-				// Is Client?
-				if (!GetOwner()->HasAuthority())
-				{
-					ServerCancelAction(ActionTag);
-				}
+		OwnerStatsComponent->OnStatChanged.RemoveAll(this);
+		OwnerStatsComponent->OnStatValuesUpdated.RemoveAll(this);
+	}
 
-				Action->CancelAction();
-				return true;
-			}
+	// Stop all
+	TArray<UActionBase*> ActionsCopy = Actions;
+	for (UActionBase* Action : ActionsCopy)
+	{
+		if (IsActionRunning(Action))
+		{
+			StopGrantedAction(Action, false);
 		}
 	}
+	// anything a stop could not clear must not stay in the running count
+	DEC_DWORD_STAT_BY(STAT_ActionSystem_RunningActions, RunningActions.Num());
+	RunningActions.Empty();
 
-	return false;
+	// pooled objects are outered to our owner and would keep it alive
+	if (UActionPoolSubsystem* Pool = GetWorld() ? GetWorld()->GetSubsystem<UActionPoolSubsystem>() : nullptr)
+	{
+		Pool->DiscardActionsOwnedBy(GetOwner());
+	}
+	UpdateStorageStats(true);
+	PreloadedActionSets.Empty();
+	TRACE_ACTION_COMPONENT_ENDED(this);
+
+	Super::EndPlay(EndPlayReason);
 }
 
-bool UActionComponent::CancelAllActions()
+UActionBase* UActionComponent::FindActionByClass(TSubclassOf<UActionBase> ActionClass) const
 {
-	bool bCanceledAny = false;
 	for (UActionBase* Action : Actions)
 	{
-		if (IsValid(Action) && Action->IsRunning())
+		if (Action && Action->IsA(ActionClass))
 		{
-			// Is Client?
-			if (!GetOwner()->HasAuthority())
-			{
-				ServerCancelAction(Action->ActionTag);
-			}
-			Action->CancelAction();
-			bCanceledAny =  true;
+			return Action;
 		}
 	}
-	return bCanceledAny;
+	return nullptr;
 }
 
-void UActionComponent::SetActionsInhibited(bool bNewInhibited)
+UActionBase* UActionComponent::FindActionByTag(FGameplayTag Tag) const
 {
-	bActionsInhibited = bNewInhibited;
+	for (int32 i = 0; i < Actions.Num(); i++)
+	{
+		UActionBase* Action = Actions[i];
+		if (ActionDefinitions[i] && ActionDefinitions[i]->ActionTag.MatchesTagExact(Tag))
+		{
+			return Action;
+		}
+	}
+	return nullptr;
 }
 
-bool UActionComponent::GetActionsInhibited()
+UActionBase* UActionComponent::FindActionByName(FName ActionName) const
 {
-	return bActionsInhibited;
+	for (int32 i = 0; i < Actions.Num(); i++)
+	{
+		if (ActionDefinitions[i] && ActionDefinitions[i]->ActionName == ActionName)
+		{
+			return Actions[i];
+		}
+	}
+	return nullptr;
 }
 
-void UActionComponent::ActionInputPressedByTag(FGameplayTag Tag)
+TArray<UActionBase*> UActionComponent::FindActionsWithTags(FGameplayTagContainer Tags) const
 {
-	if (UActionBase* FoundAction = FindActionByTag(Tag))
+	TArray<UActionBase*> OutActions;
+	for (int32 i = 0; i < Actions.Num(); i++)
 	{
-		FoundAction->OnInputPressed();
+		const FActionDefinition* Definition = ActionDefinitions[i];
+		if (Definition && Definition->ActionTag.IsValid() && Tags.HasTag(Definition->ActionTag))
+		{
+			OutActions.Add(Actions[i]);
+		}
 	}
+	return OutActions;
 }
 
-void UActionComponent::ActionInputReleasedByTag(FGameplayTag Tag)
+void UActionComponent::ClearActionQueue()
 {
-	if (UActionBase* FoundAction = FindActionByTag(Tag))
-	{
-		FoundAction->InputReleased();
-	}
+	ActionQueue.Empty();
 }
 
-void UActionComponent::ActionInputPressedByClass(TSubclassOf<UActionBase> ActionClass)
+bool UActionComponent::TryQueueAction(UActionBase* Action, EQueuedActionStartMethod Method, bool bSetInputPressed, const FActionActivationInfo& ActivationInfo)
 {
-	if (UActionBase* FoundAction = FindActionByClass(ActionClass))
+	if (!IsValid(Action) || !Action->GetDefinition().bUsesQueue || Action == RetryingQueuedAction || ActionQueueWindow <= 0.0f)
 	{
-		FoundAction->OnInputPressed();
+		return false;
 	}
-}
 
-void UActionComponent::ActionInputReleasedByClass(TSubclassOf<UActionBase> ActionClass)
-{
-	if (UActionBase* FoundAction = FindActionByClass(ActionClass))
+	// only failures that can clear up on their own are worth waiting for
+	if (LastStartFailureReason != EFailureReason::AlreadyRunning && LastStartFailureReason != EFailureReason::TagBlocked)
 	{
-		FoundAction->InputReleased();
+		return false;
 	}
-}
 
-void UActionComponent::AddActiveTag(FGameplayTag NewTag)
-{
-	ActiveGameplayTags.AddTag(NewTag);
-	OnTagAdded.Broadcast(NewTag);
+	// the newest request for an action replaces any older one and goes to the back of the queue
+	ActionQueue.RemoveAll([Action](const FQueuedActionRequest& Request) { return Request.Action == Action; });
+
+	FQueuedActionRequest& Request = ActionQueue.AddDefaulted_GetRef();
+	Request.Action = Action;
+	Request.Method = Method;
+	Request.ExpireTime = GetWorld()->GetTimeSeconds() + ActionQueueWindow;
+	Request.bSetInputPressed = bSetInputPressed;
+	Request.ActivationInfo = ActivationInfo;
+	return true;
 }
 
-void UActionComponent::AddActiveTags(FGameplayTagContainer NewTags)
+void UActionComponent::ScheduleActionQueue()
 {
-	TArray<FGameplayTag> Tags;
-	NewTags.GetGameplayTagArray(Tags);
-	for (FGameplayTag CurrentTag : Tags)
+	if (bActionQueueScheduled || ActionQueue.Num() == 0 || !GetWorld())
 	{
-		OnTagAdded.Broadcast(CurrentTag);
+		return;
 	}
-	ActiveGameplayTags.AppendTags(NewTags);
+
+	// retry next tick rather than from inside the stop/tag change that triggered us
+	bActionQueueScheduled = true;
+	GetWorld()->GetTimerManager().SetTimerForNextTick(this, &UActionComponent::ProcessActionQueue);
 }
 
-bool UActionComponent::RemoveActiveTag(FGameplayTag TagToRemove)
+void UActionComponent::ProcessActionQueue()
 {
-	if (ActiveGameplayTags.HasTag(TagToRemove))
+	bActionQueueScheduled = false;
+
+	const float Now = GetWorld()->GetTimeSeconds();
+	TArray<FQueuedActionRequest> PendingRequests = MoveTemp(ActionQueue);
+	ActionQueue.Reset();
+
+	for (const FQueuedActionRequest& Request : PendingRequests)
 	{
-		ActiveGameplayTags.RemoveTag(TagToRemove);
-		OnTagRemoved.Broadcast(TagToRemove);
-		return true;
+		if (Request.ExpireTime < Now || !IsValid(Request.Action) || !Actions.Contains(Request.Action))
+		{
+			continue;
+		}
+
+		// the original start already reported the failure, so the retry neither reports nor queues itself
+		TGuardValue<UActionBase*> RetryGuard(RetryingQueuedAction, Request.Action);
+
+		bool bStarted = false;
+		switch (Request.Method)
+		{
+		case EQueuedActionStartMethod::ByTag:
+			bStarted = StartActionByTag(Request.Action->GetDefinition().ActionTag);
+			break;
+		case EQueuedActionStartMethod::ByClass:
+			bStarted = StartActionByClass(Request.Action->GetClass(), Request.bSetInputPressed);
+			break;
+		case EQueuedActionStartMethod::WithInfo:
+			bStarted = StartActionWithInfo(Request.Action->GetDefinition().ActionTag, Request.ActivationInfo);
+			break;
+		case EQueuedActionStartMethod::ByAction:
+			bStarted = TryStartGrantedAction(Request.Action, Request.bSetInputPressed);
+			break;
+		}
+
+		// still blocked: keep waiting until the request expires, unless a newer request for the action was queued meanwhile
+		const bool bStillQueueable = !bActionsInhibited
+			&& (LastStartFailureReason == EFailureReason::AlreadyRunning || LastStartFailureReason == EFailureReason::TagBlocked);
+		if (!bStarted && bStillQueueable && Actions.Contains(Request.Action)
+			&& !ActionQueue.ContainsByPredicate([&Request](const FQueuedActionRequest& Queued) { return Queued.Action == Request.Action; }))
+		{
+			ActionQueue.Add(Request);
+		}
 	}
-	return false;
 }
 
-void UActionComponent::ServerStartAction_Implementation(FGameplayTag ActionTag)
+void UActionComponent::BeginActionTransaction()
 {
-	UE_LOG(LogTemp, Warning, TEXT("Server Starting action..."))
-	StartActionByTag(ActionTag);
+	TransactionDepth++;
 }
 
-void UActionComponent::ServerStartActionWithInfo_Implementation(FGameplayTag ActionTag, FActionActivationInfo ActivationInfo)
+void UActionComponent::EndActionTransaction()
 {
-	UE_LOG(LogTemp, Warning, TEXT("Server Starting action with info..."))
-	StartActionWithInfo(ActionTag, ActivationInfo);
+	check(TransactionDepth > 0);
+	if (--TransactionDepth == 0)
+	{
+		FlushActionTransaction();
+	}
 }
 
+bool UActionComponent::IsInActionTransaction() const
+{
+	return TransactionDepth > 0;
+}
 
-void UActionComponent::RemoveActiveTags(FGameplayTagContainer TagsToRemove)
+bool UActionComponent::DeferTagNotifications()
 {
-	TArray<FGameplayTag> Tags;
-	TagsToRemove.GetGameplayTagArray(Tags);
-	for (FGameplayTag CurrentTag : Tags)
+	if (TransactionDepth == 0)
 	{
-		OnTagRemoved.Broadcast(CurrentTag);
+		return false;
 	}
-	ActiveGameplayTags.RemoveTags(TagsToRemove);
-}
 
-void UActionComponent::GetOwnedGameplayTags(FGameplayTagContainer& TagContainer) const
-{
-	TagContainer = ActiveGameplayTags;
+	// snapshot once per transaction, on the first tag change
+	if (!bTransactionTagsChanged)
+	{
+		TransactionStartTags = ActiveGameplayTags;
+		bTransactionTagsChanged = true;
+	}
+	return true;
 }
 
-bool UActionComponent::HasAllMatchingGameplayTags(const FGameplayTagContainer& GameplayTags) const
+void UActionComponent::NotifyActionStarted(UActionBase* Action)
 {
-	return ActiveGameplayTags.HasAll(GameplayTags);
+	TRACE_ACTION_STARTED(this, Action);
+	CSV_CUSTOM_STAT(ActionSystem, ActionsStarted, 1, ECsvCustomStatOp::Accumulate);
+	if (TransactionDepth > 0)
+	{
+		PendingActionEvents.Add({ EPendingActionEventType::Started, Action });
+		return;
+	}
+	OnActionStarted.Broadcast(this, Action);
 }
 
-bool UActionComponent::HasMatchingGameplayTag(FGameplayTag TagToCheck) const
+void UActionComponent::NotifyActionStopped(UActionBase* Action, bool bWasCanceled)
 {
-	return ActiveGameplayTags.HasTag(TagToCheck);
+	TRACE_ACTION_STOPPED(this, Action, bWasCanceled);
+	if (bWasCanceled)
+	{
+		CSV_CUSTOM_STAT(ActionSystem, ActionsCanceled, 1, ECsvCustomStatOp::Accumulate);
+	}
+	else
+	{
+		CSV_CUSTOM_STAT(ActionSystem, ActionsStopped, 1, ECsvCustomStatOp::Accumulate);
+	}
+	if (TransactionDepth > 0)
+	{
+		PendingActionEvents.Add({ EPendingActionEventType::Stopped, Action, bWasCanceled });
+		return;
+	}
+	OnActionStopped.Broadcast(this, Action);
+	OnActionFinished.Broadcast(bWasCanceled);
 }
 
-bool UActionComponent::HasAnyMatchingGameplayTags(const FGameplayTagContainer& GameplayTags) const
+void UActionComponent::NotifyActionFailed(UActionBase* Action, EFailureReason FailureReason)
 {
-	return ActiveGameplayTags.HasAny(GameplayTags);
+	// the failure of a queued start was reported when it was queued
+	if (Action && Action == RetryingQueuedAction)
+	{
+		return;
+	}
+
+	TRACE_ACTION_FAILED(this, Action, FailureReason);
+#if CSV_PROFILER
+	switch (FailureReason)
+	{
+	case EFailureReason::AlreadyRunning:
+		CSV_CUSTOM_STAT(ActionSystem, ActionsFailed_AlreadyRunning, 1, ECsvCustomStatOp::Accumulate);
+		break;
+	case EFailureReason::OnCooldown:
+		CSV_CUSTOM_STAT(ActionSystem, ActionsFailed_OnCooldown, 1, ECsvCustomStatOp::Accumulate);
+		break;
+	case EFailureReason::TagBlocked:
+		CSV_CUSTOM_STAT(ActionSystem, ActionsFailed_TagBlocked, 1, ECsvCustomStatOp::Accumulate);
+		break;
+	case EFailureReason::Inhibited:
+		CSV_CUSTOM_STAT(ActionSystem, ActionsFailed_Inhibited, 1, ECsvCustomStatOp::Accumulate);
+		break;
+	case EFailureReason::Cost:
+		CSV_CUSTOM_STAT(ActionSystem, ActionsFailed_Cost, 1, ECsvCustomStatOp::Accumulate);
+		break;
+	}
+#endif
+	if (TransactionDepth > 0)
+	{
+		PendingActionEvents.Add({ EPendingActionEventType::Failed, Action, false, FailureReason });
+		return;
+	}
+	OnActionFailed.Broadcast(Action, FailureReason);
 }
 
-void UActionComponent::ServerStopAction_Implementation(FGameplayTag ActionTag)
+void UActionComponent::NotifyActionAdded(UActionBase* Action)
 {
-	StopActionByTag(ActionTag);
+	if (TransactionDepth > 0)
+	{
+		// a class default removed and granted again in the same transaction cancels out
+		if (PendingRemovedActions.RemoveSingleSwap(Action, false) == 0)
+		{
+			PendingAddedActions.Add(Action);
+		}
+		return;
+	}
+	OnActionsAdded.Broadcast(this, { Action });
 }
 
-AActor* UActionComponent::GetGameplayTaskAvatar(const UGameplayTask* Task) const
+void UActionComponent::NotifyActionRemoved(UActionBase* Action)
 {
-	return GetOwner();
+	if (TransactionDepth > 0)
+	{
+		if (PendingAddedActions.RemoveSingleSwap(Action, false) == 0)
+		{
+			PendingRemovedActions.Add(Action);
+		}
+		return;
+	}
+	OnActionsRemoved.Broadcast(this, { Action });
 }
 
-void UActionComponent::ServerStartActionByClass_Implementation(TSubclassOf<UActionBase> ActionClass)
+void UActionComponent::MarkActionsDirty()
 {
-	StartActionByClass(ActionClass);
+	if (TransactionDepth > 0)
+	{
+		bPendingActionsDirty = true;
+		return;
+	}
+	MARK_PROPERTY_DIRTY_FROM_NAME(UActionComponent, Actions, this);
 }
 
-void UActionComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+void UActionComponent::UpdateStorageStats(bool bRelease)
 {
-	// Stop all
-	TArray<UActionBase*> ActionsCopy = Actions;
-	for (UActionBase* Action : ActionsCopy)
+#if STATS
+	int32 NumGranted = 0;
+	SIZE_T StorageBytes = 0;
+	if (!bRelease)
 	{
-		if (Action && Action->IsRunning())
+		NumGranted = ActionRecords.Num();
+		StorageBytes = Actions.GetAllocatedSize() + ActionDefinitions.GetAllocatedSize() + ActionSlotIndices.GetAllocatedSize()
+			+ ActionSlots.GetAllocatedSize() + FreeActionSlots.GetAllocatedSize() + ActionRecords.GetAllocatedSize()
+			+ PrioritySortedActions.GetAllocatedSize() + RunningActions.GetAllocatedSize() + TickedActions.GetAllocatedSize()
+			+ ExecutionInstances.GetAllocatedSize() + LazyActionClasses.GetAllocatedSize() + StartableActions.GetAllocatedSize();
+		for (const TPair<UActionBase*, FGrantedActionRecord>& Pair : ActionRecords)
 		{
-			Action->StopAction();
+			StorageBytes += Pair.Value.CancelTargets.GetAllocatedSize() + Pair.Value.CancelSources.GetAllocatedSize();
 		}
 	}
 
-	Super::EndPlay(EndPlayReason);
+	DEC_DWORD_STAT_BY(STAT_ActionSystem_GrantedActions, AccountedGrantedActions);
+	INC_DWORD_STAT_BY(STAT_ActionSystem_GrantedActions, NumGranted);
+	DEC_MEMORY_STAT_BY(STAT_ActionSystem_ComponentMemory, AccountedStorageBytes);
+	INC_MEMORY_STAT_BY(STAT_ActionSystem_ComponentMemory, StorageBytes);
+	AccountedGrantedActions = NumGranted;
+	AccountedStorageBytes = StorageBytes;
+#endif
 }
 
-UActionBase* UActionComponent::FindActionByClass(TSubclassOf<UActionBase> ActionClass)
+void UActionComponent::MarkCooldownsDirty()
 {
-	for (UActionBase* Action : Actions)
+	if (TransactionDepth > 0)
 	{
-		if (Action && Action->IsA(ActionClass))
-		{
-			return Action;
-		}
+		bPendingCooldownsDirty = true;
+		return;
 	}
-	return nullptr;
+	MARK_PROPERTY_DIRTY_FROM_NAME(UActionComponent, Cooldowns, this);
 }
 
-UActionBase* UActionComponent::FindActionByTag(FGameplayTag Tag)
+void UActionComponent::FlushActionTransaction()
 {
-	for (UActionBase* Action : Actions)
+	// take everything first; listeners below may open transactions of their own
+	TArray<FPendingActionEvent> Events = MoveTemp(PendingActionEvents);
+	PendingActionEvents.Reset();
+
+	if (bPendingActionsDirty)
+	{
+		bPendingActionsDirty = false;
+		MARK_PROPERTY_DIRTY_FROM_NAME(UActionComponent, Actions, this);
+		UpdateStorageStats();
+	}
+	if (bPendingCooldownsDirty)
+	{
+		bPendingCooldownsDirty = false;
+		MARK_PROPERTY_DIRTY_FROM_NAME(UActionComponent, Cooldowns, this);
+	}
+
+	if (bTransactionTagsChanged)
 	{
-		if (Action && Action->ActionTag.MatchesTagExact(Tag))
+		bTransactionTagsChanged = false;
+		const FGameplayTagContainer StartTags = MoveTemp(TransactionStartTags);
+		TransactionStartTags.Reset();
+		const FGameplayTagContainer EndTags = ActiveGameplayTags;
+
+		// only the net difference is broadcast; a tag added and removed again inside the transaction is silent
+		for (const FGameplayTag& Tag : StartTags)
 		{
-			return Action;
+			if (!EndTags.HasTagExact(Tag))
+			{
+				OnTagRemoved.Broadcast(Tag);
+			}
+		}
+		for (const FGameplayTag& Tag : EndTags)
+		{
+			if (!StartTags.HasTagExact(Tag))
+			{
+				OnTagAdded.Broadcast(Tag);
+			}
 		}
 	}
-	return nullptr;
+
+	TArray<UActionBase*> Releases = MoveTemp(PendingPoolReleases);
+	PendingPoolReleases.Reset();
+
+	TArray<UActionBase*> Removed = MoveTemp(PendingRemovedActions);
+	PendingRemovedActions.Reset();
+	TArray<UActionBase*> Added = MoveTemp(PendingAddedActions);
+	PendingAddedActions.Reset();
+
+	if (Removed.Num() > 0)
+	{
+		OnActionsRemoved.Broadcast(this, Removed);
+	}
+	if (Added.Num() > 0)
+	{
+		OnActionsAdded.Broadcast(this, Added);
+	}
+
+	for (const FPendingActionEvent& Event : Events)
+	{
+		UActionBase* Action = Event.Action.Get();
+		switch (Event.Type)
+		{
+		case EPendingActionEventType::Started:
+			OnActionStarted.Broadcast(this, Action);
+			break;
+		case EPendingActionEventType::Stopped:
+			OnActionStopped.Broadcast(this, Action);
+			OnActionFinished.Broadcast(Event.bWasCanceled);
+			break;
+		case EPendingActionEventType::Failed:
+			OnActionFailed.Broadcast(Action, Event.FailureReason);
+			break;
+		}
+	}
+
+	// pool released objects only once every listener has seen them
+	for (UActionBase* Action : Releases)
+	{
+		ReleaseActionObject(Action);
+	}
 }
 
 void UActionComponent::CallGameplayEvent(FGameplayTag EventTag)
@@ -681,14 +2487,25 @@ void UActionComponent::CallGameplayEvent(FGameplayTag EventTag)
 
 bool UActionComponent::ReplicateSubobjects(UActorChannel* Channel, FOutBunch* Bunch, FReplicationFlags* RepFlags)
 {
+	SCOPE_CYCLE_COUNTER(STAT_ReplicateActionSubobjects);
 	bool WroteSomething = Super::ReplicateSubobjects(Channel, Bunch, RepFlags);
 	for (UActionBase* Action : Actions)
 	{
-		if (Action)
+		// class defaults of non-instanced and per-execution actions are referenced by path, not replicated
+		if (Action && Action->IsInstantiated())
 		{
+			FActionReplicationTimerScope TimerScope(Action);
 			WroteSomething |= Channel->ReplicateSubobject(Action, *Bunch, *RepFlags);
 		}
 	}
+	for (UActionBase* Instance : ExecutionInstances)
+	{
+		if (Instance)
+		{
+			FActionReplicationTimerScope TimerScope(Instance);
+			WroteSomething |= Channel->ReplicateSubobject(Instance, *Bunch, *RepFlags);
+		}
+	}
 
 	return WroteSomething;
 }
@@ -697,7 +2514,24 @@ void UActionComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& Out
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
-	DOREPLIFETIME(UActionComponent, Actions);
+	FDoRepLifetimeParams ActionsParams;
+	ActionsParams.bIsPushBased = true;
+	DOREPLIFETIME_WITH_PARAMS_FAST(UActionComponent, Actions, ActionsParams);
+
+	FDoRepLifetimeParams CooldownParams;
+	CooldownParams.Condition = COND_OwnerOnly;
+	CooldownParams.bIsPushBased = true;
+	DOREPLIFETIME_WITH_PARAMS_FAST(UActionComponent, Cooldowns, CooldownParams);
 	DOREPLIFETIME_CONDITION(UActionComponent, ActiveGameplayTags, COND_SkipOwner);
+	DOREPLIFETIME(UActionComponent, ExecutionInstances);
+
+	FDoRepLifetimeParams NonInstancedParams;
+	NonInstancedParams.bIsPushBased = true;
+	DOREPLIFETIME_WITH_PARAMS_FAST(UActionComponent, NonInstancedStates, NonInstancedParams);
+
+	FDoRepLifetimeParams LazyActionParams;
+	LazyActionParams.Condition = COND_OwnerOnly;
+	LazyActionParams.bIsPushBased = true;
+	DOREPLIFETIME_WITH_PARAMS_FAST(UActionComponent, LazyActionClasses, LazyActionParams);
 }
 
@@ -0,0 +1,24 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ActionGrantSet.h"
+#include "ActionBase.h"
+#include "ActionAssetLoading.h"
+
+bool UActionGrantSet::AreAssetsLoaded() const
+{
+	TArray<FSoftObjectPath> Paths;
+	GetAssetDependencies(Paths);
+	return FActionAssetLoading::AreLoaded(Paths);
+}
+
+void UActionGrantSet::GetAssetDependencies(TArray<FSoftObjectPath>& OutPaths) const
+{
+	for (TSubclassOf<UActionBase> ActionClass : Actions)
+	{
+		if (ActionClass)
+		{
+			ActionClass->GetDefaultObject<UActionBase>()->GetAssetDependencies(OutPaths);
+		}
+	}
+}
@@ -0,0 +1,144 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ActionPoolSubsystem.h"
+#include "ActionBase.h"
+#include "Engine/World.h"
+#include "Serialization/ArchiveCountMem.h"
+
+int32 ActionPoolEnabled = 1;
+static FAutoConsoleVariableRef CVarActionPoolEnabled(TEXT("ActionSystem.Pool.Enabled"), ActionPoolEnabled, TEXT("Reuse removed action objects for later grants of the same class"), ECVF_Default );
+
+int32 ActionPoolMaxPerClass = 32;
+static FAutoConsoleVariableRef CVarActionPoolMaxPerClass(TEXT("ActionSystem.Pool.MaxPerClass"), ActionPoolMaxPerClass, TEXT("Most pooled action objects kept for each class in a world"), ECVF_Default );
+
+static void ReportActionPool(UWorld* World)
+{
+	UActionPoolSubsystem* Pool = World ? World->GetSubsystem<UActionPoolSubsystem>() : nullptr;
+	if (!Pool)
+	{
+		return;
+	}
+
+	const FActionPoolStats Stats = Pool->GetStats();
+	UE_LOG(LogTemp, Display, TEXT("Action pool: %d acquires, %d hits (%.1f%%), %d releases, %d discards, %d pooled using %.1f KB"),
+		Stats.Acquires, Stats.Hits, Pool->GetHitRate() * 100.0f, Stats.Releases, Stats.Discards,
+		Pool->GetPooledCount(), Pool->GetPooledMemoryBytes() / 1024.0f);
+}
+
+static FAutoConsoleCommandWithWorld ReportActionPoolCommand(
+	TEXT("ActionSystem.Pool.Report"),
+	TEXT("Logs the action pool hit rate and pooled memory for the current world."),
+	FConsoleCommandWithWorldDelegate::CreateStatic(&ReportActionPool));
+
+UActionBase* UActionPoolSubsystem::AcquireAction(TSubclassOf<UActionBase> ActionClass, UObject* Outer)
+{
+	if (!ActionPoolEnabled)
+	{
+		return nullptr;
+	}
+
+	Stats.Acquires++;
+
+	FActionPoolBucket* Bucket = Buckets.Find(ActionClass);
+	if (!Bucket)
+	{
+		return nullptr;
+	}
+
+	// outers that were destroyed without discarding their actions
+	Bucket->FreeActions.RemoveAllSwap([](const UActionBase* Action) { return !IsValid(Action) || !IsValid(Action->GetOuter()); });
+
+	// an object that already replicated under another actor cannot move, so only standalone games share across outers
+	int32 Index = Bucket->FreeActions.IndexOfByPredicate([Outer](const UActionBase* Action) { return Action->GetOuter() == Outer; });
+	if (Index == INDEX_NONE && GetWorld()->GetNetMode() == NM_Standalone && Bucket->FreeActions.Num() > 0)
+	{
+		Index = Bucket->FreeActions.Num() - 1;
+	}
+	if (Index == INDEX_NONE)
+	{
+		return nullptr;
+	}
+
+	UActionBase* Action = Bucket->FreeActions[Index];
+	Bucket->FreeActions.RemoveAtSwap(Index);
+	if (Action->GetOuter() != Outer)
+	{
+		Action->Rename(nullptr, Outer, REN_DontCreateRedirectors | REN_ForceNoResetLoaders | REN_DoNotDirty | REN_NonTransactional);
+	}
+
+	Stats.Hits++;
+	return Action;
+}
+
+void UActionPoolSubsystem::ReleaseAction(UActionBase* Action)
+{
+	if (!ActionPoolEnabled || !IsValid(Action) || !Action->IsInstantiated())
+	{
+		return;
+	}
+
+	Stats.Releases++;
+
+	FActionPoolBucket& Bucket = Buckets.FindOrAdd(Action->GetClass());
+	if (Bucket.FreeActions.Num() >= ActionPoolMaxPerClass)
+	{
+		Stats.Discards++;
+		return;
+	}
+
+	Action->ResetAction();
+	Bucket.FreeActions.Add(Action);
+}
+
+void UActionPoolSubsystem::DiscardActionsOwnedBy(UObject* Outer)
+{
+	for (TPair<UClass*, FActionPoolBucket>& Pair : Buckets)
+	{
+		Pair.Value.FreeActions.RemoveAllSwap([Outer](const UActionBase* Action) { return !IsValid(Action) || Action->GetOuter() == Outer; });
+	}
+}
+
+FActionPoolStats UActionPoolSubsystem::GetStats() const
+{
+	return Stats;
+}
+
+float UActionPoolSubsystem::GetHitRate() const
+{
+	return Stats.Acquires > 0 ? (float)Stats.Hits / Stats.Acquires : 0.0f;
+}
+
+int32 UActionPoolSubsystem::GetPooledCount() const
+{
+	int32 Count = 0;
+	for (const TPair<UClass*, FActionPoolBucket>& Pair : Buckets)
+	{
+		Count += Pair.Value.FreeActions.Num();
+	}
+	return Count;
+}
+
+int64 UActionPoolSubsystem::GetPooledMemoryBytes() const
+{
+	int64 Bytes = 0;
+	for (const TPair<UClass*, FActionPoolBucket>& Pair : Buckets)
+	{
+		for (UActionBase* Action : Pair.Value.FreeActions)
+		{
+			if (IsValid(Action))
+			{
+				FArchiveCountMem CountMem(Action);
+				Bytes += CountMem.GetMax();
+			}
+		}
+	}
+	return Bytes;
+}
+
+void UActionPoolSubsystem::Deinitialize()
+{
+	Buckets.Empty();
+
+	Super::Deinitialize();
+}
@@ -0,0 +1,474 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ActionSystemBenchmark.h"
+#include "ActionComponent.h"
+#include "ActionDefinition.h"
+#include "StatsComponent.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "GameplayTagsManager.h"
+#include "HAL/FileManager.h"
+#include "Interfaces/IPluginManager.h"
+#include "Misc/App.h"
+#include "Misc/EngineVersion.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Policies/CondensedJsonPrintPolicy.h"
+#include "Serialization/JsonSerializer.h"
+#include "UObject/StrongObjectPtr.h"
+
+void ConfigureActionBenchmarkClasses(const FGameplayTag& ActionTag, const FGameplayTag& StatTag)
+{
+	// Both classes only exist for the benchmarks, so their defaults are set up here rather than in content
+	static TStrongObjectPtr<UActionDefinition> BenchmarkDefinition;
+	if (!BenchmarkDefinition.IsValid())
+	{
+		BenchmarkDefinition.Reset(NewObject<UActionDefinition>(GetTransientPackage()));
+	}
+	BenchmarkDefinition->Definition.ActionTag = ActionTag;
+	GetMutableDefault<UActionSystemBenchmarkAction>()->GetActionSparseClassData()->DefinitionAsset = BenchmarkDefinition.Get();
+
+	UActionSystemBenchmarkEffect* EffectDefaults = GetMutableDefault<UActionSystemBenchmarkEffect>();
+	// a long, unlimited stacking duration, so every EffectStack application really adds a stack
+	EffectDefaults->DurationType = EDurationType::HasDuration;
+	EffectDefaults->Duration = 3600.0f;
+	EffectDefaults->MaxStacks = 0;
+	EffectDefaults->Modifiers.Reset();
+	FStatModifier& Modifier = EffectDefaults->Modifiers.AddDefaulted_GetRef();
+	Modifier.Stat = StatTag;
+	Modifier.Method = EModifyMethod::Add;
+	Modifier.Magnitude = 1.0f;
+	EffectDefaults->ResetClassModifierCaches();
+}
+
+#if !UE_BUILD_SHIPPING
+
+TSharedRef<FJsonObject> MakeActionBenchmarkReport()
+{
+	TSharedRef<FJsonObject> Root = MakeShared<FJsonObject>();
+	TSharedPtr<IPlugin> Plugin = IPluginManager::Get().FindPlugin(TEXT("UniversalActionSystem"));
+	Root->SetStringField(TEXT("pluginVersion"), Plugin.IsValid() ? Plugin->GetDescriptor().VersionName : FString());
+	Root->SetStringField(TEXT("engineVersion"), FEngineVersion::Current().ToString());
+	Root->SetStringField(TEXT("configuration"), LexToString(FApp::GetBuildConfiguration()));
+	Root->SetStringField(TEXT("platform"), FPlatformProperties::IniPlatformName());
+	Root->SetStringField(TEXT("timestamp"), FDateTime::UtcNow().ToIso8601());
+	return Root;
+}
+
+void SaveActionBenchmarkReport(const TSharedRef<FJsonObject>& Report, const TCHAR* Name)
+{
+	FString Json;
+	TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Json);
+	FJsonSerializer::Serialize(Report, Writer);
+
+	const FString FileName = FPaths::ProfilingDir() / TEXT("ActionSystem") / FString::Printf(TEXT("%s-%s.json"), Name, *FDateTime::Now().ToString());
+	if (FFileHelper::SaveStringToFile(Json, *FileName))
+	{
+		UE_LOG(LogTemp, Display, TEXT("ActionSystem %s results written to %s"), Name, *IFileManager::Get().ConvertToAbsolutePathForExternalAppForWrite(*FileName));
+	}
+	else
+	{
+		UE_LOG(LogTemp, Error, TEXT("ActionSystem %s results could not be written to %s"), Name, *FileName);
+	}
+}
+
+/*
+ * ActionSystem.Benchmark [Counts=1,100,1000,10000] [Tag=Action.Test] [Stat=Stat.Health] [State=State.Test] [Quit]
+ *
+ * Spawns N actors with a stats and an action component for each count and times the core operations on them.
+ * Results are logged and written to Saved/Profiling/ActionSystem/ as JSON so runs of different plugin versions
+ * can be compared. Runs headless, e.g.
+ *   UE4Editor ActionSystem -game -nullrhi -unattended -nosound -ExecCmds="ActionSystem.Benchmark Quit"
+ */
+
+// Small counts repeat the repeatable operations until roughly this many calls were timed
+static const int32 ActionBenchmarkTargetOps = 10000;
+
+struct FActionBenchmarkResult
+{
+	FString Name;
+	int32 Ops = 0;
+	double Seconds = 0.0;
+};
+
+template<typename FuncType>
+static double TimeActionBenchmarkLoop(int32 Count, FuncType&& Func)
+{
+	const double StartTime = FPlatformTime::Seconds();
+	for (int32 i = 0; i < Count; i++)
+	{
+		Func(i);
+	}
+	return FPlatformTime::Seconds() - StartTime;
+}
+
+static void RunActionBenchmark(UWorld* World, int32 Count, const FGameplayTag& ActionTag, const FGameplayTag& StatTag,
+	const FGameplayTag& StateTag, TArray<FActionBenchmarkResult>& OutResults)
+{
+	const int32 Repeats = FMath::Max(1, ActionBenchmarkTargetOps / Count);
+
+	TArray<AActor*> Actors;
+	TArray<UActionComponent*> ActionComps;
+	TArray<UStatsComponent*> StatsComps;
+	Actors.Reserve(Count);
+	ActionComps.Reserve(Count);
+	StatsComps.Reserve(Count);
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	SpawnParams.ObjectFlags |= RF_Transient;
+
+	for (int32 i = 0; i < Count; i++)
+	{
+		AActor* Actor = World->SpawnActor<AActor>(AActor::StaticClass(), FTransform::Identity, SpawnParams);
+
+		UStatsComponent* StatsComp = NewObject<UStatsComponent>(Actor);
+		FStat Stat;
+		Stat.Stat = StatTag;
+		Stat.CurrentValue = 100.0f;
+		Stat.ModifierMagniude = 0.0f;
+		Stat.MaxValue = 100.0f;
+		StatsComp->AddStat(Stat);
+		StatsComp->RegisterComponent();
+
+		UActionComponent* ActionComp = NewObject<UActionComponent>(Actor);
+		ActionComp->RegisterComponent();
+
+		Actors.Add(Actor);
+		StatsComps.Add(StatsComp);
+		ActionComps.Add(ActionComp);
+	}
+
+	auto AddResult = [&OutResults](const TCHAR* Name, int32 Ops, double Seconds)
+	{
+		FActionBenchmarkResult& Result = OutResults.AddDefaulted_GetRef();
+		Result.Name = Name;
+		Result.Ops = Ops;
+		Result.Seconds = Seconds;
+	};
+
+	TArray<UActionBase*> Actions;
+	Actions.SetNumZeroed(Count);
+
+	AddResult(TEXT("Grant"), Count, TimeActionBenchmarkLoop(Count, [&](int32 i)
+	{
+		const FActionHandle Handle = ActionComps[i]->AddAction(Actors[i], UActionSystemBenchmarkAction::StaticClass());
+		Actions[i] = ActionComps[i]->GetActionFromHandle(Handle);
+	}));
+
+	double Seconds = 0.0;
+	for (int32 r = 0; r < Repeats; r++)
+	{
+		Seconds += TimeActionBenchmarkLoop(Count, [&](int32 i)
+		{
+			ActionComps[i]->InvalidateStartableActions();
+			ActionComps[i]->IsActionStartable(Actions[i]);
+		});
+	}
+	AddResult(TEXT("CanStart"), Count * Repeats, Seconds);
+
+	double StopSeconds = 0.0;
+	Seconds = 0.0;
+	for (int32 r = 0; r < Repeats; r++)
+	{
+		Seconds += TimeActionBenchmarkLoop(Count, [&](int32 i) { ActionComps[i]->StartActionByTag(ActionTag); });
+		StopSeconds += TimeActionBenchmarkLoop(Count, [&](int32 i) { ActionComps[i]->StopActionByTag(ActionTag); });
+	}
+	AddResult(TEXT("StartByTag"), Count * Repeats, Seconds);
+	AddResult(TEXT("StopByTag"), Count * Repeats, StopSeconds);
+
+	Seconds = 0.0;
+	for (int32 r = 0; r < Repeats; r++)
+	{
+		TimeActionBenchmarkLoop(Count, [&](int32 i) { ActionComps[i]->StartActionByTag(ActionTag); });
+		Seconds += TimeActionBenchmarkLoop(Count, [&](int32 i) { ActionComps[i]->CancelActionByTag(ActionTag); });
+	}
+	AddResult(TEXT("CancelByTag"), Count * Repeats, Seconds);
+
+	double RemoveSeconds = 0.0;
+	Seconds = 0.0;
+	for (int32 r = 0; r < Repeats; r++)
+	{
+		Seconds += TimeActionBenchmarkLoop(Count, [&](int32 i) { ActionComps[i]->AddActiveTag(StateTag); });
+		RemoveSeconds += TimeActionBenchmarkLoop(Count, [&](int32 i) { ActionComps[i]->RemoveActiveTag(StateTag); });
+	}
+	AddResult(TEXT("AddTag"), Count * Repeats, Seconds);
+	AddResult(TEXT("RemoveTag"), Count * Repeats, RemoveSeconds);
+
+	int32 RejectedEffects = 0;
+	AddResult(TEXT("EffectApply"), Count, TimeActionBenchmarkLoop(Count, [&](int32 i)
+	{
+		RejectedEffects += StatsComps[i]->ApplyStatEffect(UActionSystemBenchmarkEffect::StaticClass(), Actors[i], nullptr) ? 0 : 1;
+	}));
+
+	AddResult(TEXT("EffectStack"), Count, TimeActionBenchmarkLoop(Count, [&](int32 i)
+	{
+		RejectedEffects += StatsComps[i]->ApplyStatEffect(UActionSystemBenchmarkEffect::StaticClass(), Actors[i], nullptr) ? 0 : 1;
+	}));
+	if (RejectedEffects > 0)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("ActionSystem.Benchmark N=%d: %d effect applications were rejected, EffectApply and EffectStack do not time real work"), Count, RejectedEffects);
+	}
+
+	Seconds = 0.0;
+	for (int32 r = 0; r < Repeats; r++)
+	{
+		Seconds += TimeActionBenchmarkLoop(Count, [&](int32 i) { StatsComps[i]->RecalculateModifiers(); });
+	}
+	AddResult(TEXT("RecalculateModifiers"), Count * Repeats, Seconds);
+
+	AddResult(TEXT("EffectExpire"), Count, TimeActionBenchmarkLoop(Count, [&](int32 i)
+	{
+		StatsComps[i]->RemoveStatEffect(UActionSystemBenchmarkEffect::StaticClass());
+	}));
+
+	for (AActor* Actor : Actors)
+	{
+		Actor->Destroy();
+	}
+	CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+}
+
+static void RunActionBenchmarkCommand(const TArray<FString>& Args, UWorld* World)
+{
+	if (!World)
+	{
+		UE_LOG(LogTemp, Error, TEXT("ActionSystem.Benchmark needs a game world"));
+		return;
+	}
+
+	const FString ArgString = FString::Join(Args, TEXT(" "));
+
+	FString TagName = TEXT("Action.Test");
+	FString StatName = TEXT("Stat.Health");
+	FString StateName = TEXT("State.Test");
+	FString CountsString = TEXT("1,100,1000,10000");
+	FParse::Value(*ArgString, TEXT("Tag="), TagName);
+	FParse::Value(*ArgString, TEXT("Stat="), StatName);
+	FParse::Value(*ArgString, TEXT("State="), StateName);
+	FParse::Value(*ArgString, TEXT("Counts="), CountsString, false);
+	const bool bQuit = Args.Contains(TEXT("Quit"));
+
+	const FGameplayTag ActionTag = FGameplayTag::RequestGameplayTag(*TagName, false);
+	const FGameplayTag StatTag = FGameplayTag::RequestGameplayTag(*StatName, false);
+	const FGameplayTag StateTag = FGameplayTag::RequestGameplayTag(*StateName, false);
+	if (!ActionTag.IsValid() || !StatTag.IsValid() || !StateTag.IsValid())
+	{
+		UE_LOG(LogTemp, Error, TEXT("ActionSystem.Benchmark: Tag, Stat and State must name registered gameplay tags"));
+		return;
+	}
+
+	TArray<FString> CountStrings;
+	CountsString.ParseIntoArray(CountStrings, TEXT(","));
+
+	ConfigureActionBenchmarkClasses(ActionTag, StatTag);
+
+	TSharedRef<FJsonObject> Root = MakeActionBenchmarkReport();
+
+	TArray<TSharedPtr<FJsonValue>> Runs;
+	for (const FString& CountString : CountStrings)
+	{
+		const int32 Count = FCString::Atoi(*CountString);
+		if (Count <= 0)
+		{
+			continue;
+		}
+
+		TArray<FActionBenchmarkResult> Results;
+		RunActionBenchmark(World, Count, ActionTag, StatTag, StateTag, Results);
+
+		TArray<TSharedPtr<FJsonValue>> Operations;
+		for (const FActionBenchmarkResult& Result : Results)
+		{
+			const double NsPerOp = Result.Ops > 0 ? Result.Seconds * 1.0e9 / Result.Ops : 0.0;
+			UE_LOG(LogTemp, Display, TEXT("ActionSystem.Benchmark N=%d %-20s %8d ops %10.3f ms %10.1f ns/op"),
+				Count, *Result.Name, Result.Ops, Result.Seconds * 1000.0, NsPerOp);
+
+			TSharedRef<FJsonObject> Operation = MakeShared<FJsonObject>();
+			Operation->SetStringField(TEXT("name"), Result.Name);
+			Operation->SetNumberField(TEXT("ops"), Result.Ops);
+			Operation->SetNumberField(TEXT("totalMs"), Result.Seconds * 1000.0);
+			Operation->SetNumberField(TEXT("nsPerOp"), NsPerOp);
+			Operations.Add(MakeShared<FJsonValueObject>(Operation));
+		}
+
+		TSharedRef<FJsonObject> Run = MakeShared<FJsonObject>();
+		Run->SetNumberField(TEXT("actors"), Count);
+		Run->SetArrayField(TEXT("operations"), Operations);
+		Runs.Add(MakeShared<FJsonValueObject>(Run));
+	}
+	Root->SetArrayField(TEXT("runs"), Runs);
+
+	SaveActionBenchmarkReport(Root, TEXT("Benchmark"));
+
+	if (bQuit)
+	{
+		FPlatformMisc::RequestExit(false);
+	}
+}
+
+static FAutoConsoleCommandWithWorldAndArgs ActionBenchmarkCommand(
+	TEXT("ActionSystem.Benchmark"),
+	TEXT("Times grant, start/stop/cancel, CanStart, tag and effect operations on 1 to 10000 actors and writes the results as JSON. Args: Counts=1,100 Tag= Stat= State= Quit"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&RunActionBenchmarkCommand));
+
+/*
+ * ActionSystem.Benchmark.ParallelMagnitudes [Stats=4] [Modifiers=8] [Quit]
+ *
+ * Times the two ways UStatsComponent::RecalculateModifiersForTargets can update growing numbers of targets: calling
+ * RecalculateModifiers on each, and snapshotting them, evaluating the snapshots with ParallelFor and applying them back.
+ * Reports the first count where the parallel version wins. Use it to tune ActionSystem.Effects.ParallelMagnitudeThreshold
+ */
+static void RunParallelMagnitudeBenchmarkCommand(const TArray<FString>& Args, UWorld* World)
+{
+	if (!World)
+	{
+		UE_LOG(LogTemp, Error, TEXT("ActionSystem.Benchmark.ParallelMagnitudes needs a game world"));
+		return;
+	}
+
+	const FString ArgString = FString::Join(Args, TEXT(" "));
+	int32 NumStats = 4;
+	int32 NumModifiers = 8;
+	FParse::Value(*ArgString, TEXT("Stats="), NumStats);
+	FParse::Value(*ArgString, TEXT("Modifiers="), NumModifiers);
+	NumStats = FMath::Max(NumStats, 1);
+	NumModifiers = FMath::Max(NumModifiers, 1);
+
+	// registered tags keep the modifier lookups realistic; the values are arbitrary
+	FGameplayTagContainer AllTags;
+	UGameplayTagsManager::Get().RequestAllGameplayTags(AllTags, false);
+	TArray<FGameplayTag> Tags;
+	AllTags.GetGameplayTagArray(Tags);
+	if (Tags.Num() == 0)
+	{
+		UE_LOG(LogTemp, Error, TEXT("ActionSystem.Benchmark.ParallelMagnitudes needs registered gameplay tags to use as stats"));
+		return;
+	}
+	Tags.SetNum(FMath::Min(Tags.Num(), NumStats));
+	NumStats = Tags.Num();
+
+	// every target carries one stacked benchmark effect with NumModifiers modifiers spread over its stats
+	UActionSystemBenchmarkEffect* EffectDefaults = GetMutableDefault<UActionSystemBenchmarkEffect>();
+	EffectDefaults->DurationType = EDurationType::HasDuration;
+	EffectDefaults->Duration = 3600.0f;
+	EffectDefaults->MaxStacks = 0;
+	EffectDefaults->Modifiers.Reset();
+	for (int32 i = 0; i < NumModifiers; i++)
+	{
+		FStatModifier& Modifier = EffectDefaults->Modifiers.AddDefaulted_GetRef();
+		Modifier.Stat = Tags[i % NumStats];
+		Modifier.Method = static_cast<EModifyMethod>(i % 4);
+		Modifier.Magnitude = 1.5f;
+	}
+	EffectDefaults->ResetClassModifierCaches();
+
+	TSharedRef<FJsonObject> Root = MakeActionBenchmarkReport();
+	Root->SetNumberField(TEXT("stats"), NumStats);
+	Root->SetNumberField(TEXT("modifiers"), NumModifiers);
+	Root->SetNumberField(TEXT("workerThreads"), FTaskGraphInterface::Get().GetNumWorkerThreads());
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	SpawnParams.ObjectFlags |= RF_Transient;
+
+	const int32 Counts[] = { 1, 8, 16, 32, 64, 128, 256, 512, 1024, 4096 };
+	int32 Crossover = 0;
+	TArray<TSharedPtr<FJsonValue>> Runs;
+	for (const int32 Count : Counts)
+	{
+		TArray<AActor*> Actors;
+		TArray<UStatsComponent*> Targets;
+		Actors.Reserve(Count);
+		Targets.Reserve(Count);
+		for (int32 i = 0; i < Count; i++)
+		{
+			AActor* Actor = World->SpawnActor<AActor>(AActor::StaticClass(), FTransform::Identity, SpawnParams);
+			UStatsComponent* StatsComp = NewObject<UStatsComponent>(Actor);
+			for (int32 StatIndex = 0; StatIndex < NumStats; StatIndex++)
+			{
+				FStat Stat;
+				Stat.Stat = Tags[StatIndex];
+				Stat.CurrentValue = 100.0f + StatIndex;
+				Stat.ModifierMagniude = 0.0f;
+				Stat.MaxValue = 1000.0f;
+				StatsComp->AddStat(Stat);
+			}
+			StatsComp->RegisterComponent();
+			for (int32 Stack = 0; Stack < 1 + i % 3; Stack++)
+			{
+				StatsComp->ApplyStatEffect(UActionSystemBenchmarkEffect::StaticClass(), Actor, nullptr);
+			}
+			Actors.Add(Actor);
+			Targets.Add(StatsComp);
+		}
+
+		const int32 Repeats = FMath::Max(1, ActionBenchmarkTargetOps * 10 / Count);
+		TArray<FStatMagnitudeSnapshot> Snapshots;
+		Snapshots.SetNum(Count);
+
+		double SerialSeconds = 0.0;
+		double ParallelSeconds = 0.0;
+		for (int32 r = 0; r < Repeats; r++)
+		{
+			double StartTime = FPlatformTime::Seconds();
+			for (UStatsComponent* Target : Targets)
+			{
+				Target->RecalculateModifiers();
+			}
+			SerialSeconds += FPlatformTime::Seconds() - StartTime;
+
+			StartTime = FPlatformTime::Seconds();
+			for (int32 i = 0; i < Count; i++)
+			{
+				Targets[i]->MakeMagnitudeSnapshot(Snapshots[i]);
+			}
+			UStatsComponent::EvaluateMagnitudeSnapshots(Snapshots, true);
+			for (int32 i = 0; i < Count; i++)
+			{
+				Targets[i]->ApplyMagnitudeSnapshot(Snapshots[i]);
+			}
+			ParallelSeconds += FPlatformTime::Seconds() - StartTime;
+		}
+
+		for (AActor* Actor : Actors)
+		{
+			Actor->Destroy();
+		}
+
+		const double SerialUs = SerialSeconds * 1.0e6 / Repeats;
+		const double ParallelUs = ParallelSeconds * 1.0e6 / Repeats;
+		if (Crossover == 0 && ParallelUs < SerialUs)
+		{
+			Crossover = Count;
+		}
+		UE_LOG(LogTemp, Display, TEXT("ActionSystem.Benchmark.ParallelMagnitudes %5d targets: serial %9.2f us, parallel %9.2f us"), Count, SerialUs, ParallelUs);
+
+		TSharedRef<FJsonObject> Run = MakeShared<FJsonObject>();
+		Run->SetNumberField(TEXT("targets"), Count);
+		Run->SetNumberField(TEXT("serialUs"), SerialUs);
+		Run->SetNumberField(TEXT("parallelUs"), ParallelUs);
+		Runs.Add(MakeShared<FJsonValueObject>(Run));
+	}
+	CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+
+	Root->SetArrayField(TEXT("runs"), Runs);
+	Root->SetNumberField(TEXT("crossoverTargets"), Crossover);
+	UE_LOG(LogTemp, Display, TEXT("ActionSystem.Benchmark.ParallelMagnitudes: parallel evaluation wins from %d targets"), Crossover);
+
+	SaveActionBenchmarkReport(Root, TEXT("ParallelMagnitudes"));
+
+	if (Args.Contains(TEXT("Quit")))
+	{
+		FPlatformMisc::RequestExit(false);
+	}
+}
+
+static FAutoConsoleCommandWithWorldAndArgs ParallelMagnitudeBenchmarkCommand(
+	TEXT("ActionSystem.Benchmark.ParallelMagnitudes"),
+	TEXT("Finds the target count from which snapshotting and evaluating modifiers in parallel beats calling RecalculateModifiers on each target. Args: Stats= Modifiers= Quit"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&RunParallelMagnitudeBenchmarkCommand));
+
+#endif
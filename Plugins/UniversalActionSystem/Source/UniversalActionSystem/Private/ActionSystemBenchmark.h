@@ -0,0 +1,88 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ActionBase.h"
+#include "StatEffect.h"
+#include "GameFramework/Actor.h"
+#include "ActionSystemBenchmark.generated.h"
+
+class FJsonObject;
+class UActionComponent;
+class UStatsComponent;
+
+/* Points the benchmark action at ActionTag and makes the benchmark effect an infinite +1 modifier on StatTag */
+void ConfigureActionBenchmarkClasses(const FGameplayTag& ActionTag, const FGameplayTag& StatTag);
+
+#if !UE_BUILD_SHIPPING
+/* Report object with the plugin, engine and build the results were taken with */
+TSharedRef<FJsonObject> MakeActionBenchmarkReport();
+
+/* Writes the report to Saved/Profiling/ActionSystem/<Name>-<time>.json */
+void SaveActionBenchmarkReport(const TSharedRef<FJsonObject>& Report, const TCHAR* Name);
+#endif
+
+/* Action granted by ActionSystem.Benchmark. Its definition is assigned when the benchmark runs so no project content is needed */
+UCLASS(NotBlueprintable, HideDropdown, Transient)
+class UActionSystemBenchmarkAction : public UActionBase
+{
+	GENERATED_BODY()
+};
+
+/* Effect applied by ActionSystem.Benchmark. Its modifiers are assigned when the benchmark runs */
+UCLASS(NotBlueprintable, HideDropdown, Transient)
+class UActionSystemBenchmarkEffect : public UStatEffect
+{
+	GENERATED_BODY()
+};
+
+/* Replicated actor spawned by ActionSystem.NetBench. While active it toggles its action and effect on a timer.
+ * Bots owned by a client are driven from that client so the traffic goes through the server RPCs */
+UCLASS(NotBlueprintable, HideDropdown, Transient)
+class AActionSystemNetBenchBot : public AActor
+{
+	GENERATED_BODY()
+
+public:
+
+	AActionSystemNetBenchBot();
+
+	virtual void BeginPlay() override;
+
+	virtual void Tick(float DeltaSeconds) override;
+
+	/* Same as AActor's, but times each component while ActionSystem.NetBench records */
+	virtual bool ReplicateSubobjects(UActorChannel* Channel, FOutBunch* Bunch, FReplicationFlags* RepFlags) override;
+
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	UPROPERTY(VisibleAnywhere, Category = "Benchmark")
+	UActionComponent* ActionComp;
+
+	UPROPERTY(VisibleAnywhere, Category = "Benchmark")
+	UStatsComponent* StatsComp;
+
+	UPROPERTY(Replicated)
+	FGameplayTag ActionTag;
+
+	UPROPERTY(Replicated)
+	FGameplayTag StatTag;
+
+	/* Seconds between two steps of the bot */
+	UPROPERTY(Replicated)
+	float StepInterval = 0.5f;
+
+	UPROPERTY(Replicated)
+	bool bActive = false;
+
+private:
+
+	/* True on the process that drives this bot: its owning client, or the server when no client owns it */
+	bool IsDriver() const;
+
+	float TimeUntilStep = 0.0f;
+
+	/* Whether the last step started the action and applied the effect */
+	bool bStarted = false;
+};
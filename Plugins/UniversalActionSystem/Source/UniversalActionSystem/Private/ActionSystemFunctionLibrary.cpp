@@ -103,3 +103,9 @@ FStat UActionSystemFunctionLibrary::GetStatFromActor(AActor* Actor, FGameplayTag
 	}
 	return FStat();
 }
+
+void UActionSystemFunctionLibrary::GetStatHistoryEntrySource(const FStatHistoryEntry& Entry, UStatEffect*& SourceEffect, AActor*& Instigator)
+{
+	SourceEffect = Entry.SourceEffect.Get();
+	Instigator = Entry.Instigator.Get();
+}
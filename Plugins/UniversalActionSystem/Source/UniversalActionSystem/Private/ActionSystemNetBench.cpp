@@ -0,0 +1,372 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ActionSystemBenchmark.h"
+#include "ActionComponent.h"
+#include "StatsComponent.h"
+#include "UniversalActionSystem.h"
+#include "Containers/Ticker.h"
+#include "Engine/ActorChannel.h"
+#include "Engine/NetConnection.h"
+#include "Engine/NetDriver.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "Net/UnrealNetwork.h"
+#include "Serialization/JsonSerializer.h"
+
+AActionSystemNetBenchBot::AActionSystemNetBenchBot()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	bReplicates = true;
+	bAlwaysRelevant = true;
+
+	ActionComp = CreateDefaultSubobject<UActionComponent>(TEXT("ActionComp"));
+	StatsComp = CreateDefaultSubobject<UStatsComponent>(TEXT("StatsComp"));
+}
+
+void AActionSystemNetBenchBot::BeginPlay()
+{
+	// clients get the tags with the initial bunch and need the same class defaults as the server
+	ConfigureActionBenchmarkClasses(ActionTag, StatTag);
+
+	if (HasAuthority())
+	{
+		FStat Stat;
+		Stat.Stat = StatTag;
+		Stat.CurrentValue = 100.0f;
+		Stat.ModifierMagniude = 0.0f;
+		Stat.MaxValue = 100.0f;
+		StatsComp->AddStat(Stat);
+	}
+
+	Super::BeginPlay();
+
+	if (HasAuthority())
+	{
+		ActionComp->AddAction(this, UActionSystemBenchmarkAction::StaticClass());
+	}
+
+	// spread the bots over the interval so they do not all step on the same frame
+	TimeUntilStep = FMath::FRand() * StepInterval;
+}
+
+void AActionSystemNetBenchBot::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	if (!bActive || !IsDriver())
+	{
+		return;
+	}
+
+	TimeUntilStep -= DeltaSeconds;
+	if (TimeUntilStep > 0.0f)
+	{
+		return;
+	}
+	TimeUntilStep += StepInterval;
+
+	if (!bStarted)
+	{
+		ActionComp->StartActionByTag(ActionTag);
+		StatsComp->ApplyStatEffect(UActionSystemBenchmarkEffect::StaticClass(), this, nullptr);
+	}
+	else
+	{
+		ActionComp->StopActionByTag(ActionTag);
+		StatsComp->RemoveStatEffect(UActionSystemBenchmarkEffect::StaticClass());
+	}
+	bStarted = !bStarted;
+}
+
+bool AActionSystemNetBenchBot::ReplicateSubobjects(UActorChannel* Channel, FOutBunch* Bunch, FReplicationFlags* RepFlags)
+{
+	bool WroteSomething = false;
+	for (UActorComponent* Component : ReplicatedComponents)
+	{
+		if (Component && Component->GetIsReplicated())
+		{
+			// includes the component's own subobjects, which UActionComponent also records per action class
+			FActionReplicationTimerScope TimerScope(Component);
+			WroteSomething |= Component->ReplicateSubobjects(Channel, Bunch, RepFlags);
+			WroteSomething |= Channel->ReplicateSubobject(Component, *Bunch, *RepFlags);
+		}
+	}
+	return WroteSomething;
+}
+
+void AActionSystemNetBenchBot::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME_CONDITION(AActionSystemNetBenchBot, ActionTag, COND_InitialOnly);
+	DOREPLIFETIME_CONDITION(AActionSystemNetBenchBot, StatTag, COND_InitialOnly);
+	DOREPLIFETIME_CONDITION(AActionSystemNetBenchBot, StepInterval, COND_InitialOnly);
+	DOREPLIFETIME(AActionSystemNetBenchBot, bActive);
+}
+
+bool AActionSystemNetBenchBot::IsDriver() const
+{
+	// a bot owned by a remote client has a connection on both ends; unowned bots have none
+	return HasAuthority() == (GetNetConnection() == nullptr);
+}
+
+#if !UE_BUILD_SHIPPING
+
+/*
+ * ActionSystem.NetBench [Bots=100] [Clients=0] [Duration=30] [Interval=0.5] [Tag=Action.Test] [Stat=Stat.Health] [ServerDriven] [Quit]
+ *
+ * Run on a dedicated or listen server. Waits for Clients remote players, spawns Bots replicated bots and measures
+ * one idle and one active phase of Duration seconds each. Bots are owned round-robin by the connected players, so
+ * their clients start and stop actions and apply effects through the server RPCs; ServerDriven keeps them on the
+ * server. Reports outgoing bytes per bot per second, RPCs per second and the replication time spent on each
+ * component and action class. Scripts/RunNetBench.sh launches a server and headless clients on loopback.
+ */
+
+struct FActionNetBenchRun
+{
+	enum class EPhase : uint8
+	{
+		WaitForClients,
+		Idle,
+		Active,
+	};
+
+	TWeakObjectPtr<UWorld> World;
+	FGameplayTag ActionTag;
+	FGameplayTag StatTag;
+	int32 NumBots = 100;
+	int32 NumClients = 0;
+	float Duration = 30.0f;
+	float StepInterval = 0.5f;
+	bool bServerDriven = false;
+	bool bQuit = false;
+
+	EPhase Phase = EPhase::WaitForClients;
+	double PhaseStartTime = 0.0;
+	uint64 PhaseStartOutBytes = 0;
+	uint64 PhaseStartInBytes = 0;
+
+	TArray<TWeakObjectPtr<AActionSystemNetBenchBot>> Bots;
+	TSharedPtr<FJsonObject> Report;
+	TArray<TSharedPtr<FJsonValue>> Phases;
+};
+
+static TUniquePtr<FActionNetBenchRun> ActionNetBenchRun;
+
+// Clients that have finished joining, i.e. have a player controller on the server
+static TArray<APlayerController*> GetNetBenchClients(UNetDriver* NetDriver)
+{
+	TArray<APlayerController*> Clients;
+	for (UNetConnection* Connection : NetDriver->ClientConnections)
+	{
+		if (Connection && Connection->PlayerController)
+		{
+			Clients.Add(Connection->PlayerController);
+		}
+	}
+	return Clients;
+}
+
+static void BeginNetBenchPhase(FActionNetBenchRun& Run, FActionNetBenchRun::EPhase Phase, UNetDriver* NetDriver)
+{
+	Run.Phase = Phase;
+	Run.PhaseStartTime = FPlatformTime::Seconds();
+	Run.PhaseStartOutBytes = NetDriver->OutTotalBytes;
+	Run.PhaseStartInBytes = NetDriver->InTotalBytes;
+
+	for (const TWeakObjectPtr<AActionSystemNetBenchBot>& Bot : Run.Bots)
+	{
+		if (Bot.IsValid())
+		{
+			Bot->bActive = Phase == FActionNetBenchRun::EPhase::Active;
+		}
+	}
+
+	FActionSystemNetCounters::Reset();
+	FActionSystemNetCounters::bRecordReplication = true;
+}
+
+static void EndNetBenchPhase(FActionNetBenchRun& Run, const TCHAR* Name, UNetDriver* NetDriver)
+{
+	const double Seconds = FMath::Max(FPlatformTime::Seconds() - Run.PhaseStartTime, 0.001);
+	const double OutBytesPerSecond = (NetDriver->OutTotalBytes - Run.PhaseStartOutBytes) / Seconds;
+	const double InBytesPerSecond = (NetDriver->InTotalBytes - Run.PhaseStartInBytes) / Seconds;
+	const double ActionRPCsPerSecond = FActionSystemNetCounters::ServerActionRPCs / Seconds;
+	const double StatRPCsPerSecond = FActionSystemNetCounters::ServerStatRPCs / Seconds;
+
+	UE_LOG(LogTemp, Display, TEXT("ActionSystem.NetBench %s: %.0f B/s out (%.1f B/bot/s), %.0f B/s in, %.1f action RPC/s, %.1f stat RPC/s"),
+		Name, OutBytesPerSecond, OutBytesPerSecond / Run.NumBots, InBytesPerSecond, ActionRPCsPerSecond, StatRPCsPerSecond);
+
+	TSharedRef<FJsonObject> Phase = MakeShared<FJsonObject>();
+	Phase->SetStringField(TEXT("name"), Name);
+	Phase->SetNumberField(TEXT("seconds"), Seconds);
+	Phase->SetNumberField(TEXT("outBytesPerSecond"), OutBytesPerSecond);
+	Phase->SetNumberField(TEXT("outBytesPerBotPerSecond"), OutBytesPerSecond / Run.NumBots);
+	Phase->SetNumberField(TEXT("inBytesPerSecond"), InBytesPerSecond);
+	Phase->SetNumberField(TEXT("serverActionRPCsPerSecond"), ActionRPCsPerSecond);
+	Phase->SetNumberField(TEXT("serverStatRPCsPerSecond"), StatRPCsPerSecond);
+
+	TArray<TSharedPtr<FJsonValue>> Replication;
+	for (const TPair<FName, TPair<uint64, uint64>>& Entry : FActionSystemNetCounters::ReplicationCycles)
+	{
+		const double TotalMs = FPlatformTime::ToMilliseconds64(Entry.Value.Key);
+		UE_LOG(LogTemp, Display, TEXT("ActionSystem.NetBench %s:   %-40s %8llu calls %10.3f ms (%.3f ms/s)"),
+			Name, *Entry.Key.ToString(), Entry.Value.Value, TotalMs, TotalMs / Seconds);
+
+		TSharedRef<FJsonObject> ClassEntry = MakeShared<FJsonObject>();
+		ClassEntry->SetStringField(TEXT("class"), Entry.Key.ToString());
+		ClassEntry->SetNumberField(TEXT("calls"), Entry.Value.Value);
+		ClassEntry->SetNumberField(TEXT("totalMs"), TotalMs);
+		ClassEntry->SetNumberField(TEXT("msPerSecond"), TotalMs / Seconds);
+		ClassEntry->SetNumberField(TEXT("usPerCall"), Entry.Value.Value > 0 ? TotalMs * 1000.0 / Entry.Value.Value : 0.0);
+		Replication.Add(MakeShared<FJsonValueObject>(ClassEntry));
+	}
+	Phase->SetArrayField(TEXT("replication"), Replication);
+
+	Run.Phases.Add(MakeShared<FJsonValueObject>(Phase));
+	FActionSystemNetCounters::bRecordReplication = false;
+}
+
+static void FinishNetBench(FActionNetBenchRun& Run)
+{
+	FActionSystemNetCounters::bRecordReplication = false;
+	for (const TWeakObjectPtr<AActionSystemNetBenchBot>& Bot : Run.Bots)
+	{
+		if (Bot.IsValid())
+		{
+			Bot->Destroy();
+		}
+	}
+
+	if (Run.Report.IsValid())
+	{
+		Run.Report->SetArrayField(TEXT("phases"), Run.Phases);
+		SaveActionBenchmarkReport(Run.Report.ToSharedRef(), TEXT("NetBench"));
+	}
+
+	if (Run.bQuit)
+	{
+		FPlatformMisc::RequestExit(false);
+	}
+}
+
+static bool TickActionNetBench(float DeltaTime)
+{
+	FActionNetBenchRun& Run = *ActionNetBenchRun;
+	UWorld* World = Run.World.Get();
+	UNetDriver* NetDriver = World ? World->GetNetDriver() : nullptr;
+	if (!NetDriver)
+	{
+		UE_LOG(LogTemp, Error, TEXT("ActionSystem.NetBench: world or net driver went away, aborting"));
+		Run.Report.Reset();
+		FinishNetBench(Run);
+		ActionNetBenchRun.Reset();
+		return false;
+	}
+
+	const double PhaseSeconds = FPlatformTime::Seconds() - Run.PhaseStartTime;
+	switch (Run.Phase)
+	{
+	case FActionNetBenchRun::EPhase::WaitForClients:
+	{
+		const TArray<APlayerController*> Clients = GetNetBenchClients(NetDriver);
+		if (Clients.Num() < Run.NumClients)
+		{
+			return true;
+		}
+
+		for (int32 i = 0; i < Run.NumBots; i++)
+		{
+			AActionSystemNetBenchBot* Bot = World->SpawnActorDeferred<AActionSystemNetBenchBot>(AActionSystemNetBenchBot::StaticClass(), FTransform::Identity,
+				(!Run.bServerDriven && Clients.Num() > 0) ? Clients[i % Clients.Num()] : nullptr, nullptr, ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
+			Bot->ActionTag = Run.ActionTag;
+			Bot->StatTag = Run.StatTag;
+			Bot->StepInterval = Run.StepInterval;
+			Bot->FinishSpawning(FTransform::Identity);
+			Run.Bots.Add(Bot);
+		}
+
+		UE_LOG(LogTemp, Display, TEXT("ActionSystem.NetBench: %d clients connected, spawned %d bots"), Clients.Num(), Run.NumBots);
+		Run.Report->SetNumberField(TEXT("clients"), Clients.Num());
+		BeginNetBenchPhase(Run, FActionNetBenchRun::EPhase::Idle, NetDriver);
+		break;
+	}
+	case FActionNetBenchRun::EPhase::Idle:
+		if (PhaseSeconds >= Run.Duration)
+		{
+			EndNetBenchPhase(Run, TEXT("Idle"), NetDriver);
+			BeginNetBenchPhase(Run, FActionNetBenchRun::EPhase::Active, NetDriver);
+		}
+		break;
+	case FActionNetBenchRun::EPhase::Active:
+		if (PhaseSeconds >= Run.Duration)
+		{
+			EndNetBenchPhase(Run, TEXT("Active"), NetDriver);
+			FinishNetBench(Run);
+			ActionNetBenchRun.Reset();
+			return false;
+		}
+		break;
+	}
+	return true;
+}
+
+static void RunActionNetBenchCommand(const TArray<FString>& Args, UWorld* World)
+{
+	if (ActionNetBenchRun.IsValid())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("ActionSystem.NetBench is already running"));
+		return;
+	}
+	if (!World || !World->GetNetDriver() || World->GetNetMode() == NM_Client)
+	{
+		UE_LOG(LogTemp, Error, TEXT("ActionSystem.NetBench must run on a dedicated or listen server"));
+		return;
+	}
+
+	const FString ArgString = FString::Join(Args, TEXT(" "));
+
+	FString TagName = TEXT("Action.Test");
+	FString StatName = TEXT("Stat.Health");
+	FParse::Value(*ArgString, TEXT("Tag="), TagName);
+	FParse::Value(*ArgString, TEXT("Stat="), StatName);
+
+	TUniquePtr<FActionNetBenchRun> Run = MakeUnique<FActionNetBenchRun>();
+	Run->World = World;
+	Run->ActionTag = FGameplayTag::RequestGameplayTag(*TagName, false);
+	Run->StatTag = FGameplayTag::RequestGameplayTag(*StatName, false);
+	FParse::Value(*ArgString, TEXT("Bots="), Run->NumBots);
+	FParse::Value(*ArgString, TEXT("Clients="), Run->NumClients);
+	FParse::Value(*ArgString, TEXT("Duration="), Run->Duration);
+	FParse::Value(*ArgString, TEXT("Interval="), Run->StepInterval);
+	Run->bServerDriven = Args.Contains(TEXT("ServerDriven"));
+	Run->bQuit = Args.Contains(TEXT("Quit"));
+	Run->NumBots = FMath::Max(Run->NumBots, 1);
+
+	if (!Run->ActionTag.IsValid() || !Run->StatTag.IsValid())
+	{
+		UE_LOG(LogTemp, Error, TEXT("ActionSystem.NetBench: Tag and Stat must name registered gameplay tags"));
+		return;
+	}
+
+	ConfigureActionBenchmarkClasses(Run->ActionTag, Run->StatTag);
+
+	Run->Report = MakeActionBenchmarkReport();
+	Run->Report->SetNumberField(TEXT("bots"), Run->NumBots);
+	Run->Report->SetNumberField(TEXT("stepInterval"), Run->StepInterval);
+	Run->Report->SetBoolField(TEXT("serverDriven"), Run->bServerDriven);
+	Run->Report->SetNumberField(TEXT("netServerMaxTickRate"), World->GetNetDriver()->NetServerMaxTickRate);
+	Run->PhaseStartTime = FPlatformTime::Seconds();
+
+	UE_LOG(LogTemp, Display, TEXT("ActionSystem.NetBench: waiting for %d clients"), Run->NumClients);
+	ActionNetBenchRun = MoveTemp(Run);
+	FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateStatic(&TickActionNetBench));
+}
+
+static FAutoConsoleCommandWithWorldAndArgs ActionNetBenchCommand(
+	TEXT("ActionSystem.NetBench"),
+	TEXT("Spawns replicated bots that start actions and apply effects and reports bandwidth, RPC rate and replication time as JSON. Args: Bots= Clients= Duration= Interval= Tag= Stat= ServerDriven Quit"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&RunActionNetBenchCommand));
+
+#endif
@@ -0,0 +1,275 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ActionSystemTrace.h"
+
+#if ACTIONSYSTEM_TRACE_ENABLED
+
+#include "ActionBase.h"
+#include "StatEffect.h"
+#include "Components/ActorComponent.h"
+#include "GameFramework/Actor.h"
+
+UE_TRACE_CHANNEL_DEFINE(ActionSystemChannel)
+
+UE_TRACE_EVENT_BEGIN(ActionSystem, TagSpec, NoSync|Important)
+	UE_TRACE_EVENT_FIELD(uint32, Id)
+	UE_TRACE_EVENT_FIELD(Trace::WideString, Name)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(ActionSystem, ClassSpec, NoSync|Important)
+	UE_TRACE_EVENT_FIELD(uint64, Id)
+	UE_TRACE_EVENT_FIELD(Trace::WideString, Name)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(ActionSystem, ComponentSpec, NoSync|Important)
+	UE_TRACE_EVENT_FIELD(uint64, Id)
+	UE_TRACE_EVENT_FIELD(Trace::WideString, OwnerName)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(ActionSystem, ActionStarted)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint64, ComponentId)
+	UE_TRACE_EVENT_FIELD(uint64, ClassId)
+	UE_TRACE_EVENT_FIELD(uint32, ActionTagId)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(ActionSystem, ActionStopped)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint64, ComponentId)
+	UE_TRACE_EVENT_FIELD(uint64, ClassId)
+	UE_TRACE_EVENT_FIELD(uint32, ActionTagId)
+	UE_TRACE_EVENT_FIELD(bool, bWasCanceled)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(ActionSystem, ActionFailed)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint64, ComponentId)
+	UE_TRACE_EVENT_FIELD(uint64, ClassId)
+	UE_TRACE_EVENT_FIELD(uint32, ActionTagId)
+	UE_TRACE_EVENT_FIELD(uint8, FailureReason)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(ActionSystem, TagChanged)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint64, ComponentId)
+	UE_TRACE_EVENT_FIELD(uint32, TagId)
+	UE_TRACE_EVENT_FIELD(bool, bAdded)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(ActionSystem, EffectApplied)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint64, ComponentId)
+	UE_TRACE_EVENT_FIELD(uint64, ClassId)
+	UE_TRACE_EVENT_FIELD(int32, Stacks)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(ActionSystem, EffectStackChanged)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint64, ComponentId)
+	UE_TRACE_EVENT_FIELD(uint64, ClassId)
+	UE_TRACE_EVENT_FIELD(int32, Stacks)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(ActionSystem, EffectRemoved)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint64, ComponentId)
+	UE_TRACE_EVENT_FIELD(uint64, ClassId)
+	UE_TRACE_EVENT_FIELD(bool, bWasInterrupted)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(ActionSystem, StatChanged)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint64, ComponentId)
+	UE_TRACE_EVENT_FIELD(uint32, StatTagId)
+	UE_TRACE_EVENT_FIELD(float, OldValue)
+	UE_TRACE_EVENT_FIELD(float, NewValue)
+UE_TRACE_EVENT_END()
+
+/* Ids are only sent once per run; every event referencing them afterwards is fixed size */
+static TSet<uint32> GTracedTags;
+static TSet<uint64> GTracedClasses;
+static TSet<uint64> GTracedComponents;
+
+static uint64 GetObjectTraceId(const UObject* Object)
+{
+	return uint64(UPTRINT(Object));
+}
+
+static uint32 TraceTag(FGameplayTag Tag)
+{
+	if (!Tag.IsValid())
+	{
+		return 0;
+	}
+
+	const uint32 Id = Tag.GetTagName().GetComparisonIndex().ToUnstableInt();
+	bool bAlreadyTraced = false;
+	GTracedTags.Add(Id, &bAlreadyTraced);
+	if (!bAlreadyTraced)
+	{
+		const FString Name = Tag.ToString();
+		UE_TRACE_LOG(ActionSystem, TagSpec, ActionSystemChannel)
+			<< TagSpec.Id(Id)
+			<< TagSpec.Name(*Name, Name.Len());
+	}
+	return Id;
+}
+
+static uint64 TraceClass(const UClass* Class)
+{
+	if (!Class)
+	{
+		return 0;
+	}
+
+	const uint64 Id = GetObjectTraceId(Class);
+	bool bAlreadyTraced = false;
+	GTracedClasses.Add(Id, &bAlreadyTraced);
+	if (!bAlreadyTraced)
+	{
+		const FString Name = Class->GetName();
+		UE_TRACE_LOG(ActionSystem, ClassSpec, ActionSystemChannel)
+			<< ClassSpec.Id(Id)
+			<< ClassSpec.Name(*Name, Name.Len());
+	}
+	return Id;
+}
+
+/* Components that began play before the trace started are described by their first event instead */
+static uint64 TraceComponent(const UActorComponent* Component)
+{
+	const uint64 Id = GetObjectTraceId(Component);
+	bool bAlreadyTraced = false;
+	GTracedComponents.Add(Id, &bAlreadyTraced);
+	if (!bAlreadyTraced)
+	{
+		const FString OwnerName = GetNameSafe(Component->GetOwner());
+		UE_TRACE_LOG(ActionSystem, ComponentSpec, ActionSystemChannel)
+			<< ComponentSpec.Id(Id)
+			<< ComponentSpec.OwnerName(*OwnerName, OwnerName.Len());
+	}
+	return Id;
+}
+
+void FActionSystemTrace::OutputComponentSpec(const UActorComponent* Component)
+{
+	TraceComponent(Component);
+}
+
+void FActionSystemTrace::ForgetComponent(const UActorComponent* Component)
+{
+	GTracedComponents.Remove(GetObjectTraceId(Component));
+}
+
+void FActionSystemTrace::OutputActionStarted(const UActorComponent* Component, const UActionBase* Action)
+{
+	if (!Action)
+	{
+		return;
+	}
+	const uint64 ClassId = TraceClass(Action->GetClass());
+	const uint32 TagId = TraceTag(Action->GetDefinition().ActionTag);
+	const uint64 ComponentId = TraceComponent(Component);
+	UE_TRACE_LOG(ActionSystem, ActionStarted, ActionSystemChannel)
+		<< ActionStarted.Cycle(FPlatformTime::Cycles64())
+		<< ActionStarted.ComponentId(ComponentId)
+		<< ActionStarted.ClassId(ClassId)
+		<< ActionStarted.ActionTagId(TagId);
+}
+
+void FActionSystemTrace::OutputActionStopped(const UActorComponent* Component, const UActionBase* Action, bool bWasCanceled)
+{
+	if (!Action)
+	{
+		return;
+	}
+	const uint64 ClassId = TraceClass(Action->GetClass());
+	const uint32 TagId = TraceTag(Action->GetDefinition().ActionTag);
+	const uint64 ComponentId = TraceComponent(Component);
+	UE_TRACE_LOG(ActionSystem, ActionStopped, ActionSystemChannel)
+		<< ActionStopped.Cycle(FPlatformTime::Cycles64())
+		<< ActionStopped.ComponentId(ComponentId)
+		<< ActionStopped.ClassId(ClassId)
+		<< ActionStopped.ActionTagId(TagId)
+		<< ActionStopped.bWasCanceled(bWasCanceled);
+}
+
+void FActionSystemTrace::OutputActionFailed(const UActorComponent* Component, const UActionBase* Action, uint8 FailureReason)
+{
+	const uint64 ClassId = Action ? TraceClass(Action->GetClass()) : 0;
+	const uint32 TagId = Action ? TraceTag(Action->GetDefinition().ActionTag) : 0;
+	const uint64 ComponentId = TraceComponent(Component);
+	UE_TRACE_LOG(ActionSystem, ActionFailed, ActionSystemChannel)
+		<< ActionFailed.Cycle(FPlatformTime::Cycles64())
+		<< ActionFailed.ComponentId(ComponentId)
+		<< ActionFailed.ClassId(ClassId)
+		<< ActionFailed.ActionTagId(TagId)
+		<< ActionFailed.FailureReason(FailureReason);
+}
+
+void FActionSystemTrace::OutputTagChanged(const UActorComponent* Component, FGameplayTag Tag, bool bAdded)
+{
+	const uint32 TagId = TraceTag(Tag);
+	const uint64 ComponentId = TraceComponent(Component);
+	UE_TRACE_LOG(ActionSystem, TagChanged, ActionSystemChannel)
+		<< TagChanged.Cycle(FPlatformTime::Cycles64())
+		<< TagChanged.ComponentId(ComponentId)
+		<< TagChanged.TagId(TagId)
+		<< TagChanged.bAdded(bAdded);
+}
+
+void FActionSystemTrace::OutputTagsChanged(const UActorComponent* Component, const FGameplayTagContainer& Tags, bool bAdded)
+{
+	for (const FGameplayTag& Tag : Tags)
+	{
+		OutputTagChanged(Component, Tag, bAdded);
+	}
+}
+
+void FActionSystemTrace::OutputEffectApplied(const UActorComponent* Component, const UStatEffect* Effect)
+{
+	const uint64 ClassId = TraceClass(Effect->GetClass());
+	const uint64 ComponentId = TraceComponent(Component);
+	UE_TRACE_LOG(ActionSystem, EffectApplied, ActionSystemChannel)
+		<< EffectApplied.Cycle(FPlatformTime::Cycles64())
+		<< EffectApplied.ComponentId(ComponentId)
+		<< EffectApplied.ClassId(ClassId)
+		<< EffectApplied.Stacks(Effect->GetCurrentStacks());
+}
+
+void FActionSystemTrace::OutputEffectStackChanged(const UActorComponent* Component, const UStatEffect* Effect)
+{
+	const uint64 ClassId = TraceClass(Effect->GetClass());
+	const uint64 ComponentId = TraceComponent(Component);
+	UE_TRACE_LOG(ActionSystem, EffectStackChanged, ActionSystemChannel)
+		<< EffectStackChanged.Cycle(FPlatformTime::Cycles64())
+		<< EffectStackChanged.ComponentId(ComponentId)
+		<< EffectStackChanged.ClassId(ClassId)
+		<< EffectStackChanged.Stacks(Effect->GetCurrentStacks());
+}
+
+void FActionSystemTrace::OutputEffectRemoved(const UActorComponent* Component, const UStatEffect* Effect)
+{
+	const uint64 ClassId = TraceClass(Effect->GetClass());
+	const uint64 ComponentId = TraceComponent(Component);
+	UE_TRACE_LOG(ActionSystem, EffectRemoved, ActionSystemChannel)
+		<< EffectRemoved.Cycle(FPlatformTime::Cycles64())
+		<< EffectRemoved.ComponentId(ComponentId)
+		<< EffectRemoved.ClassId(ClassId)
+		<< EffectRemoved.bWasInterrupted(Effect->bWasInterrupted);
+}
+
+void FActionSystemTrace::OutputStatChanged(const UActorComponent* Component, FGameplayTag Stat, float OldValue, float NewValue)
+{
+	const uint32 TagId = TraceTag(Stat);
+	const uint64 ComponentId = TraceComponent(Component);
+	UE_TRACE_LOG(ActionSystem, StatChanged, ActionSystemChannel)
+		<< StatChanged.Cycle(FPlatformTime::Cycles64())
+		<< StatChanged.ComponentId(ComponentId)
+		<< StatChanged.StatTagId(TagId)
+		<< StatChanged.OldValue(OldValue)
+		<< StatChanged.NewValue(NewValue);
+}
+
+#endif
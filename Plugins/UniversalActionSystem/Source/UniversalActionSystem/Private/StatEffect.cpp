@@ -3,12 +3,76 @@
 
 #include "StatEffect.h"
 #include "StatsComponent.h"
+#include "ActionSystemInterface.h"
+#include "ActionAssetLoading.h"
+#include "ActionSystemTrace.h"
+#include "UniversalActionSystem.h"
+
+// the core enums are cast from these by value
+static_assert(static_cast<uint8>(ActionSystemCore::EModifyOp::Add) == EModifyMethod::Add
+	&& static_cast<uint8>(ActionSystemCore::EModifyOp::Subtract) == EModifyMethod::Subtract
+	&& static_cast<uint8>(ActionSystemCore::EModifyOp::Multiply) == EModifyMethod::Multiply
+	&& static_cast<uint8>(ActionSystemCore::EModifyOp::Divide) == EModifyMethod::Divide, "EModifyOp must match EModifyMethod");
+static_assert(static_cast<uint8>(ActionSystemCore::EDurationKind::HasDuration) == EDurationType::HasDuration
+	&& static_cast<uint8>(ActionSystemCore::EDurationKind::Instant) == EDurationType::Instant
+	&& static_cast<uint8>(ActionSystemCore::EDurationKind::Infinite) == EDurationType::Infinite
+	&& static_cast<uint8>(ActionSystemCore::EDurationKind::Periodic) == EDurationType::Periodic, "EDurationKind must match EDurationType");
+static_assert(static_cast<uint8>(ActionSystemCore::EStackResponse::None) == EStackChangeRespone::None
+	&& static_cast<uint8>(ActionSystemCore::EStackResponse::ResetDuration) == EStackChangeRespone::ResetDuration, "EStackResponse must match EStackChangeRespone");
+
+void UStatEffect::PostInitProperties()
+{
+	Super::PostInitProperties();
+
+	if (!HasAnyFlags(RF_ClassDefaultObject | RF_ArchetypeObject))
+	{
+		INC_DWORD_STAT(STAT_ActionSystem_EffectObjects);
+		INC_MEMORY_STAT_BY(STAT_ActionSystem_EffectObjectMemory, GetClass()->GetStructureSize());
+	}
+}
+
+void UStatEffect::BeginDestroy()
+{
+	if (!HasAnyFlags(RF_ClassDefaultObject | RF_ArchetypeObject))
+	{
+		DEC_DWORD_STAT(STAT_ActionSystem_EffectObjects);
+		DEC_MEMORY_STAT_BY(STAT_ActionSystem_EffectObjectMemory, GetClass()->GetStructureSize());
+	}
+
+	Super::BeginDestroy();
+}
+
+void UStatEffect::PostLoad()
+{
+	Super::PostLoad();
+
+	if (HasAnyFlags(RF_ClassDefaultObject))
+	{
+		for (const FStatModifier& Modifier : Modifiers)
+		{
+			if (!Modifier.MagnitudeExpression.IsEmpty())
+			{
+				FindMagnitudeProgram(Modifier.MagnitudeExpression);
+			}
+		}
+	}
+}
+
+#if WITH_EDITOR
+void UStatEffect::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	// expressions, curves and modifiers may have changed
+	ResetClassModifierCaches();
+}
+#endif
 
 //
 // APPLY/REMOVE EFFECT FUNCTIONS ---------------------------------
 //
 
-bool UStatEffect::ApplyEffect(UStatsComponent* Component, AActor* inEffectCauser, APawn* inEffectInstigator)
+bool UStatEffect::ApplyEffect(UStatsComponent* Component, AActor* inEffectCauser, APawn* inEffectInstigator, const TArray<FStatModifier>* Modifiers)
 {
 	// do not apply if we hand an invalid target
 	if (!IsValid(Component))
@@ -20,7 +84,17 @@ bool UStatEffect::ApplyEffect(UStatsComponent* Component, AActor* inEffectCauser
 	SetEffectInstigator(inEffectInstigator);
 	
 	// Cache the applied modifiers so we're not unnecessarily calling the GetModifiers function.
-	ModifiersApplied = GetModifiers(Component);
+	// effects using their default list share the class table and copy nothing
+	SharedModifiers = GetSharedModifierTable();
+	if (SharedModifiers.IsValid())
+	{
+		ModifiersApplied.Reset();
+	}
+	else
+	{
+		ModifiersApplied = Modifiers ? *Modifiers : EvaluateModifiers(Component);
+		EvaluateMagnitudeExpressions(ModifiersApplied, Component);
+	}
 
 	// set the duration (this func handles checks)
 	ResetDuration();
@@ -51,41 +125,30 @@ void UStatEffect::RemoveEffect()
 		EffectTimerHandle.Invalidate();
 	}
 
-	CurrentStacks = 0;
+	Stack.Clear();
 	StackRemoved(0);
 	EffectRemoved();
 	OnEffectRemoved.Broadcast(this);
 }
 
+void UStatEffect::GetAssetDependencies(TArray<FSoftObjectPath>& OutPaths) const
+{
+	FActionAssetLoading::GatherPaths(AssetDependencies, ClassDependencies, OutPaths);
+}
+
 //
 // STACKING FUNCTIONS ---------------------------------
 //
 
 bool UStatEffect::AddStack()
 {
-	// we have no business stacking if we do not have a valid duration method
-	if (!DoesEffectManageDuration())
+	// max stacks, overflow and duration resets are handled by the core; the events stay here
+	const int LastStackNum = Stack.Stacks;
+	if (!Stack.AddStack(GetEffectSpec()))
 	{
 		return false;
 	}
 	
-	int LastStackNum = CurrentStacks;
-	
-	if ((CurrentStacks + 1) > MaxStacks && MaxStacks != 0)
-	{
-		if (StackOverflowResponse == EStackChangeRespone::ResetDuration)
-		{
-			RemainingDuration = Duration;
-		}
-		return false;
-	}
-
-	// if we always reset duration on stack add, or if we are adding a fresh stack, AND DurationType is HasDuration OR Periodic, AND we have a valid MaxDuration, set remaining duration to max duration 
-	if ((StackAddResponse == EStackChangeRespone::ResetDuration || CurrentStacks == 0) && DoesEffectManageDuration())
-	{
-		RemainingDuration = Duration;
-	}
-	
 	if (DurationType == EDurationType::Infinite || DurationType == EDurationType::HasDuration)
 	{
 		// call EffectApplied if we are adding a fresh stack from 0
@@ -96,26 +159,21 @@ bool UStatEffect::AddStack()
 		BeginTick();
 	}
 	
-	CurrentStacks++;
 	OnStackChange.Broadcast();
-	StackAdded(CurrentStacks);
+	StackAdded(Stack.Stacks);
 	
 	return true;
 }
 
 bool UStatEffect::RemoveStack()
 {
-	if ((CurrentStacks - 1) <= 0)
+	if (!Stack.RemoveStack(GetEffectSpec()))
 	{
 		return false;
 	}
-	if (StackRemoveResponse == EStackChangeRespone::ResetDuration)
-	{
-		RemainingDuration = Duration;
-	}
-	CurrentStacks--;
+	TRACE_STAT_EFFECT_STACK_CHANGED(TargetComponent.Get(), this);
 	OnStackChange.Broadcast();
-	StackRemoved(CurrentStacks);
+	StackRemoved(Stack.Stacks);
 	return true;
 }
 
@@ -130,7 +188,7 @@ bool UStatEffect::ApplyModifiers()
 	
 	bool bAnySuccess = false;
 	
-	for (FStatModifier CurrentModifier : ModifiersApplied)
+	for (const FStatModifier& CurrentModifier : GetAppliedModifiers())
 	{
 		if (!CurrentModifier.Stat.IsValid())
 		{
@@ -154,9 +212,9 @@ float UStatEffect::GetModifierMagnitudeForStat(FGameplayTag Stat)
 		UE_LOG(LogTemp, Warning, TEXT("GetModMag: This effect should not apply as a magnitude, returning 0"))
 		return 0.0f;
 	}
-	if (ModifiersApplied.FindByKey(Stat))
+	if (const FStatModifier* Modifier = FindAppliedModifier(Stat))
 	{
-		float FoundMagnitude = CalculateModifierMagnitude(*ModifiersApplied.FindByKey(Stat));
+		float FoundMagnitude = CalculateModifierMagnitude(*Modifier);
 		UE_LOG(LogTemp, Warning, TEXT("Found Modifier: %f on stat %s"), FoundMagnitude, *Stat.GetTagName().ToString());
 		return FoundMagnitude;
 	}
@@ -166,39 +224,10 @@ float UStatEffect::GetModifierMagnitudeForStat(FGameplayTag Stat)
 
 float UStatEffect::CalculateModifierMagnitude(FStatModifier Modifier)
 {
-	if (Modifier.Method == EModifyMethod::Add)
-	{
-		return Modifier.Magnitude * CurrentStacks;
-	}
-	if (Modifier.Method == EModifyMethod::Subtract)
-	{
-		return (Modifier.Magnitude * -1.0f) * CurrentStacks;
-	}
-	if (Modifier.Method == EModifyMethod::Multiply)
-	{
-
-		if (CurrentStacks == 0)
-		{
-			return 0.0f;
-		}
-		
-		float OldValue = TargetComponent.Get()->GetStatBaseValue(Modifier.Stat);
-		UE_LOG(LogTemp, Warning, TEXT("%s Stat Base Value: %f "), *Modifier.Stat.GetTagName().ToString(), OldValue)
-		float CalculatedValue = (OldValue * (Modifier.Magnitude / CurrentStacks)) - OldValue;
-		// UE_LOG(LogTemp, Warning, TEXT("Calculating Multiply Modifier: (%f * %f) - %f = %f"), OldValue, Modifier.Magnitude, OldValue, CalculatedValue)
-		return CalculatedValue;
-	}
-	if (Modifier.Method == EModifyMethod::Divide)
-	{
-		if (CurrentStacks <= 0)
-		{
-			return 0.0f;
-		}
-		
-		float OldValue = TargetComponent.Get()->GetStatBaseValue(Modifier.Stat);
-		return ((OldValue / (Modifier.Magnitude * CurrentStacks)) - OldValue);
-	}
-	return 0.0f;
+	// only Multiply and Divide scale the base value
+	const bool bNeedsBaseValue = Modifier.Method == EModifyMethod::Multiply || Modifier.Method == EModifyMethod::Divide;
+	const float BaseValue = bNeedsBaseValue ? TargetComponent.Get()->GetStatBaseValue(Modifier.Stat) : 0.0f;
+	return ActionSystemCore::ModifierMagnitude(static_cast<ActionSystemCore::EModifyOp>(Modifier.Method.GetValue()), Modifier.Magnitude, Stack.Stacks, BaseValue);
 }
 
 // This function affects the base value of stats
@@ -209,26 +238,10 @@ void UStatEffect::ApplyModifier(FStatModifier Modifier)
 	{
 		return;
 	}
-	if (Modifier.Method == EModifyMethod::Add)
-	{
-		TargetComponent.Get()->ModifyStatAdditive(Modifier.Stat, Modifier.Magnitude);
-		return;
-	}
-	if (Modifier.Method == EModifyMethod::Subtract)
-	{
-		TargetComponent.Get()->ModifyStatAdditive(Modifier.Stat, Modifier.Magnitude * -1.0f);
-		return;
-	}
-	if (Modifier.Method == EModifyMethod::Multiply)
-	{
-		TargetComponent.Get()->ModifyStatMultiplicative(Modifier.Stat, Modifier.Magnitude);
-		return;
-	}
-	if (Modifier.Method == EModifyMethod::Divide)
-	{
-		TargetComponent.Get()->ModifyStatMultiplicative(Modifier.Stat, 1.0f / Modifier.Magnitude);
-		return;
-	}
+	UStatsComponent* Target = TargetComponent.Get();
+	FScopedStatChangeSource ChangeSource(Target, this, EffectInstigator.IsValid() ? EffectInstigator.Get() : EffectCauser.Get());
+	const float BaseValue = Target->GetStatBaseValue(Modifier.Stat);
+	Target->ModifyStatAdditive(Modifier.Stat, ActionSystemCore::BaseValueDelta(static_cast<ActionSystemCore::EModifyOp>(Modifier.Method.GetValue()), Modifier.Magnitude, BaseValue));
 }
 
 // Duration Functions;
@@ -255,8 +268,7 @@ void UStatEffect::BeginTick()
 
 void UStatEffect::OnDurationFinished()
 {
-	RemainingDuration = RemainingDuration - 0.1f;
-	if (RemainingDuration > 0)
+	if (!Stack.ConsumeDuration(0.1f))
 	{
 		return;
 	}
@@ -267,7 +279,7 @@ void UStatEffect::OnDurationFinished()
 	RemoveStack();
 	
 	// if we do not reset the effect duration, remove all effect stacks.
-	if (CurrentStacks <= 0 || RemainingDuration <= 0.0f)
+	if (Stack.IsExpired())
 	{
 		RemoveEffect();
 	}
@@ -299,8 +311,7 @@ void UStatEffect::OnPeriodicTick()
 		return;
 	}
 	
-	RemainingDuration = RemainingDuration - Period;
-	if (RemainingDuration <= 0.0f)
+	if (Stack.ConsumeDuration(Period))
 	{
 		UE_LOG(LogTemp, Warning, TEXT("Effect Removed"))
 		if (EffectTimerHandle.IsValid())
@@ -308,6 +319,12 @@ void UStatEffect::OnPeriodicTick()
 			GetWorld()->GetTimerManager().ClearTimer(EffectTimerHandle);
 			EffectTimerHandle.Invalidate();
 		}
+		// the stats component only binds OnEffectRemoved for Infinite and HasDuration effects and reports those itself
+		if (DurationType != EDurationType::Infinite && DurationType != EDurationType::HasDuration)
+		{
+			TRACE_STAT_EFFECT_REMOVED(TargetComponent.Get(), this);
+			CSV_CUSTOM_STAT(ActionSystem, EffectsRemoved, 1, ECsvCustomStatOp::Accumulate);
+		}
 		OnEffectRemoved.Broadcast(this);
 		EffectRemoved();
 		return;
@@ -326,66 +343,69 @@ void UStatEffect::OnPeriodicTick()
 //
 
 
-float UStatEffect::GetRemainingDuration()
+float UStatEffect::GetRemainingDuration() const
 {
-	return RemainingDuration;
+	return Stack.RemainingDuration;
 }
 
-int UStatEffect::GetCurrentStacks()
+int UStatEffect::GetCurrentStacks() const
 {
-	return CurrentStacks;
+	return Stack.Stacks;
 }
 
 
 bool UStatEffect::DoesEffectManageDuration() const
 {
 	// effect has a duration if the duration is greater than 0, AND it is a periodic or HasDuration effect
-	return (GetDuration() > 0 && DurationType == EDurationType::HasDuration || DurationType == EDurationType::Periodic);
+	return GetEffectSpec().ManagesDuration();
 }
 
 bool UStatEffect::DoesEffectAllowStacking() const
 {
 	// effects allow stacking if duration is greater than 0 or the duration is infinite
-	return (GetDuration() > 0 || IsInfinite());
+	return GetEffectSpec().AllowsStacking();
 }
 
 float UStatEffect::GetDuration() const
 {
-	// if we have a valid type for having a duration, return duration time.
-	if (DurationType == EDurationType::HasDuration || DurationType == EDurationType::Periodic)
-	{
-		return Duration;
-	}
-	// otherwise, return 0 (we are an instant or infinite effect)
-	return 0.0f;
+	// 0 for instant and infinite effects
+	return GetEffectSpec().GetDuration();
 }
 
 bool UStatEffect::ResetDuration()
 {
-	if (DoesEffectManageDuration())
-	{
-		RemainingDuration = Duration;
-		return true;
-	}
-	return false;
+	return Stack.ResetDuration(GetEffectSpec());
 }
 
 bool UStatEffect::IsInfinite() const
 {
 	// effect is infinite if the duration = 0 and it has a duration, or if it is explicitly infinite
-	return (Duration == 0 && (DurationType == EDurationType::HasDuration || DurationType == EDurationType::Periodic)) || DurationType == EDurationType::Infinite;
+	return GetEffectSpec().IsInfinite();
 }
 
 bool UStatEffect::IsPeriodic() const
 {
 	// effect is periodic if duration type is explicitly periodic, and period > 0 OR if the duration type is infinite and period > 0
-	return (DurationType == EDurationType::Periodic || DurationType == EDurationType::Infinite) && Period > 0.0f;
+	return GetEffectSpec().IsPeriodic();
 }
 
 bool UStatEffect::ShouldApplyAsMagnitude() const
 {
 	// effects should apply has magnitude (rather than affecting the base value) when they are infinite or have a duration (they can be removed to restore the stat)
-	return (DurationType == EDurationType::Infinite || DurationType == EDurationType::HasDuration) && !IsPeriodic();
+	return GetEffectSpec().ShouldApplyAsMagnitude();
+}
+
+ActionSystemCore::FEffectSpec UStatEffect::GetEffectSpec() const
+{
+	ActionSystemCore::FEffectSpec Spec;
+	Spec.DurationType = static_cast<ActionSystemCore::EDurationKind>(DurationType.GetValue());
+	Spec.StackAddResponse = static_cast<ActionSystemCore::EStackResponse>(StackAddResponse.GetValue());
+	Spec.StackRemoveResponse = static_cast<ActionSystemCore::EStackResponse>(StackRemoveResponse.GetValue());
+	Spec.StackOverflowResponse = static_cast<ActionSystemCore::EStackResponse>(StackOverflowResponse.GetValue());
+	Spec.Duration = Duration;
+	Spec.Period = Period;
+	Spec.MaxStacks = MaxStacks;
+	return Spec;
 }
 
 AActor* UStatEffect::GetEffectCauser() const
@@ -438,6 +458,157 @@ TArray<FStatModifier> UStatEffect::GetModifiers_Implementation(UStatsComponent*
 	return Modifiers;
 }
 
+TArray<FStatModifier> UStatEffect::EvaluateModifiers(UStatsComponent* TargetStatsComponent)
+{
+	if (GetClass()->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(UStatEffect, GetModifiers)))
+	{
+		return GetModifiers(TargetStatsComponent);
+	}
+	return GetModifiers_Implementation(TargetStatsComponent);
+}
+
+bool UStatEffect::HasDynamicModifiers() const
+{
+	return false;
+}
+
+bool UStatEffect::HasTargetDependentModifiers() const
+{
+	return HasDynamicModifiers() || GetClass()->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(UStatEffect, GetModifiers));
+}
+
+void UStatEffect::ResetClassModifierCaches()
+{
+	CompiledExpressions.Reset();
+	ClassModifierTable.Reset();
+	bClassModifierTableBuilt = false;
+}
+
+const FStatModifier* UStatEffect::FindAppliedModifier(FGameplayTag Stat) const
+{
+	return SharedModifiers.IsValid() ? SharedModifiers->Find(Stat) : ModifiersApplied.FindByKey(Stat);
+}
+
+#if DO_CHECK
+static bool AreModifierListsEqual(const TArray<FStatModifier>& A, const TArray<FStatModifier>& B)
+{
+	if (A.Num() != B.Num())
+	{
+		return false;
+	}
+	for (int32 i = 0; i < A.Num(); i++)
+	{
+		// FStatModifier::operator== only compares the stat and method
+		if (A[i].Stat != B[i].Stat || A[i].Method != B[i].Method || A[i].Magnitude != B[i].Magnitude || A[i].MagnitudeExpression != B[i].MagnitudeExpression)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+#endif
+
+TSharedPtr<const FStatModifierTable> UStatEffect::GetSharedModifierTable() const
+{
+	const UStatEffect* Defaults = GetClass()->GetDefaultObject<UStatEffect>();
+	if (Defaults->bClassModifierTableBuilt)
+	{
+		return Defaults->ClassModifierTable;
+	}
+	Defaults->bClassModifierTableBuilt = true;
+
+	if (Defaults->HasTargetDependentModifiers())
+	{
+		return nullptr;
+	}
+	for (const FStatModifier& Modifier : Defaults->Modifiers)
+	{
+		if (!Modifier.MagnitudeExpression.IsEmpty())
+		{
+			return nullptr;
+		}
+	}
+
+#if DO_CHECK
+	// a C++ GetModifiers_Implementation override is only called when HasDynamicModifiers says so; checked once per class
+	ensureMsgf(AreModifierListsEqual(const_cast<UStatEffect*>(Defaults)->GetModifiers_Implementation(nullptr), Defaults->Modifiers),
+		TEXT("%s overrides GetModifiers_Implementation without overriding HasDynamicModifiers; its modifiers are ignored"), *GetClass()->GetName());
+#endif
+
+	TSharedRef<FStatModifierTable> Table = MakeShared<FStatModifierTable>();
+	Table->Modifiers = Defaults->Modifiers;
+	Table->Modifiers.StableSort([](const FStatModifier& A, const FStatModifier& B)
+	{
+		return A.Stat.GetTagName().FastLess(B.Stat.GetTagName());
+	});
+	for (int32 i = 0; i < Table->Modifiers.Num(); i++)
+	{
+		if (!Table->FirstModifierByStat.Contains(Table->Modifiers[i].Stat))
+		{
+			Table->FirstModifierByStat.Add(Table->Modifiers[i].Stat, i);
+		}
+	}
+	Defaults->ClassModifierTable = Table;
+	return Table;
+}
+
+static UStatsComponent* FindSourceStatsComponent(AActor* Actor)
+{
+	if (!Actor)
+	{
+		return nullptr;
+	}
+	if (const IActionSystemInterface* ASI = Cast<IActionSystemInterface>(Actor))
+	{
+		return ASI->GetStatSystemComponent();
+	}
+	return Actor->FindComponentByClass<UStatsComponent>();
+}
+
+void UStatEffect::EvaluateMagnitudeExpressions(TArray<FStatModifier>& InOutModifiers, UStatsComponent* Target) const
+{
+	FStatExpressionContext Context;
+	bool bContextReady = false;
+	for (FStatModifier& Modifier : InOutModifiers)
+	{
+		if (Modifier.MagnitudeExpression.IsEmpty())
+		{
+			continue;
+		}
+		const FStatExpressionProgram* Program = FindMagnitudeProgram(Modifier.MagnitudeExpression);
+		if (!Program)
+		{
+			continue;
+		}
+
+		if (!bContextReady)
+		{
+			Context.Target = Target;
+			Context.Source = FindSourceStatsComponent(EffectInstigator.IsValid() ? EffectInstigator.Get() : EffectCauser.Get());
+			bContextReady = true;
+		}
+		Modifier.Magnitude = Program->Evaluate(Context);
+	}
+}
+
+const FStatExpressionProgram* UStatEffect::FindMagnitudeProgram(const FString& Expression) const
+{
+	const UStatEffect* Defaults = GetClass()->GetDefaultObject<UStatEffect>();
+	if (const FStatExpressionProgram* Found = Defaults->CompiledExpressions.Find(Expression))
+	{
+		return Found->IsValid() ? Found : nullptr;
+	}
+
+	FStatExpressionProgram& Program = Defaults->CompiledExpressions.Add(Expression);
+	FString Error;
+	if (!FStatExpressionProgram::Compile(Expression, Defaults->MagnitudeCurves, Program, Error))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s: magnitude expression \"%s\" does not compile: %s"), *GetNameSafe(GetClass()), *Expression, *Error)
+		return nullptr;
+	}
+	return &Program;
+}
+
 UWorld* UStatEffect::GetWorld() const
 {
 	if (!IsInstantiated())
@@ -0,0 +1,332 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "StatExpression.h"
+#include "StatsComponent.h"
+#include "Curves/CurveFloat.h"
+
+namespace
+{
+	/* Recursive descent over the expression text, emitting the program in evaluation (postfix) order */
+	struct FStatExpressionParser
+	{
+		const FString& Text;
+		const TMap<FName, UCurveFloat*>& CurveTable;
+		FStatExpressionProgram& Program;
+		FString Error;
+		int32 Pos = 0;
+
+		FStatExpressionParser(const FString& InText, const TMap<FName, UCurveFloat*>& InCurveTable, FStatExpressionProgram& InProgram)
+			: Text(InText)
+			, CurveTable(InCurveTable)
+			, Program(InProgram)
+		{
+		}
+
+		void SkipSpaces()
+		{
+			while (Pos < Text.Len() && FChar::IsWhitespace(Text[Pos]))
+			{
+				Pos++;
+			}
+		}
+
+		bool Accept(TCHAR Char)
+		{
+			SkipSpaces();
+			if (Pos < Text.Len() && Text[Pos] == Char)
+			{
+				Pos++;
+				return true;
+			}
+			return false;
+		}
+
+		bool Expect(TCHAR Char)
+		{
+			if (Accept(Char))
+			{
+				return true;
+			}
+			Fail(FString::Printf(TEXT("expected '%c'"), Char));
+			return false;
+		}
+
+		void Fail(const FString& Message)
+		{
+			if (Error.IsEmpty())
+			{
+				Error = FString::Printf(TEXT("%s at column %d"), *Message, Pos + 1);
+			}
+		}
+
+		// identifiers include dots so they can hold gameplay tag names
+		FString ReadIdentifier()
+		{
+			SkipSpaces();
+			const int32 Start = Pos;
+			while (Pos < Text.Len() && (FChar::IsAlnum(Text[Pos]) || Text[Pos] == TEXT('_') || Text[Pos] == TEXT('.')))
+			{
+				Pos++;
+			}
+			return Text.Mid(Start, Pos - Start);
+		}
+
+		void Emit(EStatExpressionOp Op, int32 Operand = INDEX_NONE)
+		{
+			Program.Code.Add({ Op, Operand });
+		}
+
+		bool ParseExpression()
+		{
+			if (!ParseTerm())
+			{
+				return false;
+			}
+			while (true)
+			{
+				if (Accept(TEXT('+')))
+				{
+					if (!ParseTerm())
+					{
+						return false;
+					}
+					Emit(EStatExpressionOp::Add);
+				}
+				else if (Accept(TEXT('-')))
+				{
+					if (!ParseTerm())
+					{
+						return false;
+					}
+					Emit(EStatExpressionOp::Subtract);
+				}
+				else
+				{
+					return true;
+				}
+			}
+		}
+
+		bool ParseTerm()
+		{
+			if (!ParseUnary())
+			{
+				return false;
+			}
+			while (true)
+			{
+				if (Accept(TEXT('*')))
+				{
+					if (!ParseUnary())
+					{
+						return false;
+					}
+					Emit(EStatExpressionOp::Multiply);
+				}
+				else if (Accept(TEXT('/')))
+				{
+					if (!ParseUnary())
+					{
+						return false;
+					}
+					Emit(EStatExpressionOp::Divide);
+				}
+				else
+				{
+					return true;
+				}
+			}
+		}
+
+		bool ParseUnary()
+		{
+			if (Accept(TEXT('-')))
+			{
+				if (!ParseUnary())
+				{
+					return false;
+				}
+				Emit(EStatExpressionOp::Negate);
+				return true;
+			}
+			return ParsePrimary();
+		}
+
+		bool ParseStatReference(EStatExpressionOp Op)
+		{
+			if (!Expect(TEXT('[')))
+			{
+				return false;
+			}
+			const FString TagName = ReadIdentifier();
+			const FGameplayTag Tag = FGameplayTag::RequestGameplayTag(*TagName, false);
+			if (!Tag.IsValid())
+			{
+				Fail(FString::Printf(TEXT("unknown stat '%s'"), *TagName));
+				return false;
+			}
+			if (!Expect(TEXT(']')))
+			{
+				return false;
+			}
+			Emit(Op, Program.Stats.AddUnique(Tag));
+			return true;
+		}
+
+		bool ParsePrimary()
+		{
+			SkipSpaces();
+			if (Pos >= Text.Len())
+			{
+				Fail(TEXT("unexpected end"));
+				return false;
+			}
+
+			if (Accept(TEXT('(')))
+			{
+				return ParseExpression() && Expect(TEXT(')'));
+			}
+
+			if (FChar::IsDigit(Text[Pos]) || Text[Pos] == TEXT('.'))
+			{
+				const int32 Start = Pos;
+				bool bHasDigits = false;
+				bool bHasPoint = false;
+				while (Pos < Text.Len() && (FChar::IsDigit(Text[Pos]) || Text[Pos] == TEXT('.')))
+				{
+					if (Text[Pos] == TEXT('.'))
+					{
+						if (bHasPoint)
+						{
+							Fail(TEXT("malformed number"));
+							return false;
+						}
+						bHasPoint = true;
+					}
+					else
+					{
+						bHasDigits = true;
+					}
+					Pos++;
+				}
+				if (!bHasDigits)
+				{
+					Fail(TEXT("malformed number"));
+					return false;
+				}
+				Emit(EStatExpressionOp::Constant, Program.Constants.Add(FCString::Atof(*Text.Mid(Start, Pos - Start))));
+				return true;
+			}
+
+			const FString Name = ReadIdentifier();
+			if (Name.Equals(TEXT("Target"), ESearchCase::IgnoreCase))
+			{
+				return ParseStatReference(EStatExpressionOp::TargetStat);
+			}
+			if (Name.Equals(TEXT("Source"), ESearchCase::IgnoreCase))
+			{
+				return ParseStatReference(EStatExpressionOp::SourceStat);
+			}
+			if (Name.Equals(TEXT("min"), ESearchCase::IgnoreCase) || Name.Equals(TEXT("max"), ESearchCase::IgnoreCase))
+			{
+				const EStatExpressionOp Op = Name.Equals(TEXT("min"), ESearchCase::IgnoreCase) ? EStatExpressionOp::Min : EStatExpressionOp::Max;
+				if (!Expect(TEXT('(')) || !ParseExpression() || !Expect(TEXT(',')) || !ParseExpression() || !Expect(TEXT(')')))
+				{
+					return false;
+				}
+				Emit(Op);
+				return true;
+			}
+			if (Name.Equals(TEXT("curve"), ESearchCase::IgnoreCase))
+			{
+				if (!Expect(TEXT('(')))
+				{
+					return false;
+				}
+				const FString CurveName = ReadIdentifier();
+				UCurveFloat* const* Curve = CurveTable.Find(*CurveName);
+				if (!Curve || !*Curve)
+				{
+					Fail(FString::Printf(TEXT("unknown curve '%s'"), *CurveName));
+					return false;
+				}
+				if (!Expect(TEXT(',')) || !ParseExpression() || !Expect(TEXT(')')))
+				{
+					return false;
+				}
+				Emit(EStatExpressionOp::Curve, Program.Curves.AddUnique(*Curve));
+				return true;
+			}
+
+			Fail(Name.IsEmpty() ? FString(TEXT("unexpected character")) : FString::Printf(TEXT("unknown name '%s'"), *Name));
+			return false;
+		}
+	};
+}
+
+bool FStatExpressionProgram::Compile(const FString& Expression, const TMap<FName, UCurveFloat*>& CurveTable, FStatExpressionProgram& OutProgram, FString& OutError)
+{
+	OutProgram = FStatExpressionProgram();
+	FStatExpressionParser Parser(Expression, CurveTable, OutProgram);
+	if (Parser.ParseExpression())
+	{
+		Parser.SkipSpaces();
+		if (Parser.Pos < Expression.Len())
+		{
+			Parser.Fail(TEXT("unexpected character"));
+		}
+	}
+
+	if (!Parser.Error.IsEmpty())
+	{
+		OutError = Parser.Error;
+		OutProgram = FStatExpressionProgram();
+		return false;
+	}
+	return true;
+}
+
+float FStatExpressionProgram::Evaluate(const FStatExpressionContext& Context) const
+{
+	TArray<float, TInlineAllocator<16>> Stack;
+	for (const FStatExpressionInstruction& Instruction : Code)
+	{
+		switch (Instruction.Op)
+		{
+		case EStatExpressionOp::Constant:
+			Stack.Push(Constants[Instruction.Operand]);
+			break;
+		case EStatExpressionOp::TargetStat:
+			Stack.Push(Context.Target ? Context.Target->GetStatCurrentValue(Stats[Instruction.Operand]) : 0.0f);
+			break;
+		case EStatExpressionOp::SourceStat:
+			Stack.Push(Context.Source ? Context.Source->GetStatCurrentValue(Stats[Instruction.Operand]) : 0.0f);
+			break;
+		case EStatExpressionOp::Negate:
+			Stack.Top() = -Stack.Top();
+			break;
+		case EStatExpressionOp::Curve:
+			Stack.Top() = Curves[Instruction.Operand]->GetFloatValue(Stack.Top());
+			break;
+		default:
+		{
+			// binary operators
+			const float Right = Stack.Pop(false);
+			float& Left = Stack.Top();
+			switch (Instruction.Op)
+			{
+			case EStatExpressionOp::Add:		Left += Right; break;
+			case EStatExpressionOp::Subtract:	Left -= Right; break;
+			case EStatExpressionOp::Multiply:	Left *= Right; break;
+			case EStatExpressionOp::Divide:		Left = Right != 0.0f ? Left / Right : 0.0f; break;
+			case EStatExpressionOp::Min:		Left = FMath::Min(Left, Right); break;
+			case EStatExpressionOp::Max:		Left = FMath::Max(Left, Right); break;
+			default: break;
+			}
+			break;
+		}
+		}
+	}
+	return Stack.Num() > 0 ? Stack.Top() : 0.0f;
+}
@@ -3,8 +3,86 @@
 
 #include "StatsComponent.h"
 #include "StatEffect.h"
+#include "ActionAssetLoading.h"
+#include "ActionSystemTrace.h"
+#include "UniversalActionSystem.h"
+#include "Async/ParallelFor.h"
+#include "Curves/CurveFloat.h"
+#include "Engine/CurveTable.h"
+#include "Engine/NetConnection.h"
+#include "GameFramework/PlayerController.h"
 #include "Net/UnrealNetwork.h"
 
+DECLARE_CYCLE_STAT(TEXT("ApplyStatEffect"), STAT_ApplyStatEffect, STATGROUP_ActionSystem);
+DECLARE_CYCLE_STAT(TEXT("ApplyStatEffectToTargets"), STAT_ApplyStatEffectToTargets, STATGROUP_ActionSystem);
+DECLARE_CYCLE_STAT(TEXT("RecalculateModifiers"), STAT_RecalculateModifiers, STATGROUP_ActionSystem);
+DECLARE_CYCLE_STAT(TEXT("RecalculateModifiersForTargets"), STAT_RecalculateModifiersForTargets, STATGROUP_ActionSystem);
+DECLARE_CYCLE_STAT(TEXT("FlushDerivedStats"), STAT_FlushDerivedStats, STATGROUP_ActionSystem);
+DECLARE_CYCLE_STAT(TEXT("BuildDerivedStatGraph"), STAT_BuildDerivedStatGraph, STATGROUP_ActionSystem);
+
+static int32 StatParallelMagnitudeThreshold = 128;
+static FAutoConsoleVariableRef CVarStatParallelMagnitudeThreshold(TEXT("ActionSystem.Effects.ParallelMagnitudeThreshold"), StatParallelMagnitudeThreshold, TEXT("Targets from which batched modifier totals are evaluated with ParallelFor; 0 disables. See ActionSystem.Benchmark.ParallelMagnitudes"), ECVF_Default );
+
+static float StatClientBatchRange = 3000.0f;
+static FAutoConsoleVariableRef CVarStatClientBatchRange(TEXT("ActionSystem.Effects.ClientBatchRange"), StatClientBatchRange, TEXT("Distance from the instigator within which a client's effect batch may reach actors it does not own; 0 limits client batches to the sender's own actors"), ECVF_Default );
+
+namespace
+{
+	using FStatInitKey = TTuple<const UDataTable*, FName, const UCurveTable*, int32>;
+
+	// resolved archetype stats, kept alive by the components using them
+	TMap<FStatInitKey, TWeakPtr<const TArray<FStat>>> SharedStatInitCache;
+
+	float EvaluateStatInitValue(const UCurveTable* Curves, FName RowName, FGameplayTag Stat, const TCHAR* Suffix, int32 Level, float Fallback)
+	{
+		if (Curves)
+		{
+			const FName CurveName(*FString::Printf(TEXT("%s.%s%s"), *RowName.ToString(), *Stat.ToString(), Suffix));
+			if (const FRealCurve* Curve = Curves->FindCurve(CurveName, TEXT("UStatsComponent"), false))
+			{
+				return Curve->Eval(Level);
+			}
+		}
+		return Fallback;
+	}
+
+	TSharedPtr<const TArray<FStat>> ResolveStatInitRow(const FDataTableRowHandle& Row, const UCurveTable* Curves, int32 Level)
+	{
+		const FStatInitKey Key(Row.DataTable, Row.RowName, Curves, Level);
+		if (TSharedPtr<const TArray<FStat>> Cached = SharedStatInitCache.FindRef(Key).Pin())
+		{
+			return Cached;
+		}
+
+		const FStatInitRow* InitRow = Row.GetRow<FStatInitRow>(TEXT("UStatsComponent"));
+		if (!InitRow)
+		{
+			return nullptr;
+		}
+
+		TSharedRef<TArray<FStat>> Resolved = MakeShared<TArray<FStat>>();
+		Resolved->Reserve(InitRow->Stats.Num());
+		for (const FStatInitEntry& Entry : InitRow->Stats)
+		{
+			FStat& NewStat = Resolved->AddZeroed_GetRef();
+			NewStat.Stat = Entry.Stat;
+			NewStat.CurrentValue = EvaluateStatInitValue(Curves, Row.RowName, Entry.Stat, TEXT(""), Level, Entry.BaseValue + Entry.BaseValuePerLevel * (Level - 1));
+			NewStat.MaxValue = EvaluateStatInitValue(Curves, Row.RowName, Entry.Stat, TEXT(".Max"), Level, Entry.MaxValue + Entry.MaxValuePerLevel * (Level - 1));
+		}
+
+		// drop archetypes nobody uses anymore before adding this one
+		for (auto It = SharedStatInitCache.CreateIterator(); It; ++It)
+		{
+			if (!It.Value().IsValid())
+			{
+				It.RemoveCurrent();
+			}
+		}
+		SharedStatInitCache.Add(Key, Resolved);
+		return Resolved;
+	}
+}
+
 // Sets default values for this component's properties
 UStatsComponent::UStatsComponent()
 {
@@ -22,7 +100,7 @@ void UStatsComponent::ModifyStatAdditive(FGameplayTag Stat, float Value)
 	{
 		return;
 	}
-	if (Stats.Contains(Stat))
+	if (FindStat(Stat))
 	{
 		SetStatValue(Stat, GetStatBaseValue(Stat) + Value);
 	}
@@ -34,11 +112,9 @@ void UStatsComponent::ModifyStatMultiplicative(FGameplayTag Stat, float Value)
 	{
 		return;
 	}
-	if (Stats.Contains(Stat))
+	if (FindStat(Stat))
 	{
-		float CurrentValue = GetStatBaseValue(Stat);
-		float ModifyAmount = (CurrentValue * Value) - CurrentValue;
-		ModifyStatAdditive(Stat, ModifyAmount);
+		ModifyStatAdditive(Stat, ActionSystemCore::BaseValueDelta(ActionSystemCore::EModifyOp::Multiply, Value, GetStatBaseValue(Stat)));
 	}
 }
 
@@ -48,9 +124,9 @@ float UStatsComponent::GetStatBaseValue(FGameplayTag Stat)
 	{
 		return 0.0f;
 	}
-	if (Stats.Contains(Stat))
+	if (const FStat* FoundStat = FindStat(Stat))
 	{
-		return Stats.FindByKey(Stat)->CurrentValue;
+		return FoundStat->CurrentValue;
 	}
 	return 0.0f;
 }
@@ -61,10 +137,9 @@ float UStatsComponent::GetStatCurrentValue(FGameplayTag Stat)
 	{
 		return 0.0f;
 	}
-	if (Stats.Contains(Stat))
+	if (const FStat* FoundStat = FindStat(Stat))
 	{
-		FStat FoundStat = *Stats.FindByKey(Stat);
-		return FMath::Clamp(FoundStat.CurrentValue + FoundStat.ModifierMagniude, FoundStat.CurrentValue + FoundStat.ModifierMagniude, FoundStat.MaxValue);
+		return FMath::Clamp(FoundStat->CurrentValue + FoundStat->ModifierMagniude, FoundStat->CurrentValue + FoundStat->ModifierMagniude, FoundStat->MaxValue);
 	}
 	return 0.0f;
 }
@@ -75,15 +150,108 @@ FStat UStatsComponent::GetStat(FGameplayTag Stat)
 	{
 		return FStat();
 	}
-	if (Stats.Contains(Stat))
+	if (const FStat* FoundStat = FindStat(Stat))
 	{
-		return *Stats.FindByKey(Stat);
+		return *FoundStat;
 	}
 	return FStat();
 }
 
+const FStat* UStatsComponent::FindStat(FGameplayTag Stat) const
+{
+	return GetStats().FindByKey(Stat);
+}
+
+FStat* UStatsComponent::FindMutableStat(FGameplayTag Stat)
+{
+	if (!FindStat(Stat))
+	{
+		return nullptr;
+	}
+	MakeStatsUnique();
+	return Stats.FindByKey(Stat);
+}
+
+void UStatsComponent::MakeStatsUnique()
+{
+	if (SharedStats.IsValid())
+	{
+		if (Stats.Num() == 0)
+		{
+			Stats = *SharedStats;
+		}
+		SharedStats.Reset();
+	}
+}
+
+void UStatsComponent::AddStat(const FStat& Stat)
+{
+	MakeStatsUnique();
+	if (FStat* Existing = Stats.FindByKey(Stat.Stat))
+	{
+		*Existing = Stat;
+		return;
+	}
+	Stats.Add(Stat);
+}
+
+TArray<FStat> UStatsComponent::K2_GetStats() const
+{
+	return GetStats();
+}
+
+void UStatsComponent::SetStatLevel(int32 NewLevel)
+{
+	if (!GetOwner()->HasAuthority())
+	{
+		SetStatLevel_Server(NewLevel);
+		return;
+	}
+	// Stats is the only copy of the values without an archetype to re-initialise from
+	if (StatInitRow.IsNull())
+	{
+		return;
+	}
+
+	// the previous values, to report what the new level changed
+	const TSharedPtr<const TArray<FStat>> OldSharedStats = SharedStats;
+	const TArray<FStat> OldUniqueStats = MoveTemp(Stats);
+	const TArray<FStat>& OldStats = OldUniqueStats.Num() == 0 && OldSharedStats.IsValid() ? *OldSharedStats : OldUniqueStats;
+
+	StatLevel = FMath::Max(NewLevel, 1);
+	Stats.Reset();
+	ResolveInitialStats();
+
+	FScopedStatTransaction Transaction(this);
+	for (const FStat& CurrentStat : GetStats())
+	{
+		const FStat* OldStat = OldStats.FindByKey(CurrentStat.Stat);
+		if (OldStat && OldStat->CurrentValue != CurrentStat.CurrentValue)
+		{
+			NotifyStatValueChanged(CurrentStat.Stat, OldStat->CurrentValue, CurrentStat.CurrentValue);
+		}
+		MarkStatChanged(CurrentStat.Stat);
+	}
+	// the new max values clamp every derived stat, including those whose inputs kept their values
+	DirtyDerivedStats.Init(true, DerivedStats.Num());
+	RecalculateModifiers();
+}
+
+void UStatsComponent::OnRep_StatLevel()
+{
+	ResolveInitialStats();
+	RecalculateModifiers();
+}
+
+void UStatsComponent::ResolveInitialStats()
+{
+	SharedStats = StatInitRow.IsNull() ? nullptr : ResolveStatInitRow(StatInitRow, StatInitCurves, StatLevel);
+}
+
 bool UStatsComponent::ApplyStatEffect(TSubclassOf<UStatEffect> EffectToApply, AActor* EffectCauser, APawn* EffectInstigator)
 {
+	SCOPE_CYCLE_COUNTER(STAT_ApplyStatEffect);
+	LLM_SCOPE_BYTAG(ActionSystem_Effects);
 	// Fail if effect is not valid
 	if (!IsValid(EffectToApply))
 	{
@@ -91,6 +259,114 @@ bool UStatsComponent::ApplyStatEffect(TSubclassOf<UStatEffect> EffectToApply, AA
 		return false;
 	}
 
+	UStatEffect* Effect = nullptr;
+	bool bStacked = false;
+	{
+		TGuardValue<bool> DeferRecalculation(bDeferModifierRecalculation, true);
+		if (!ApplyStatEffectInternal(EffectToApply, EffectCauser, EffectInstigator, nullptr, Effect, bStacked))
+		{
+			bModifierRecalculationPending = false;
+			return false;
+		}
+	}
+
+	if (Effect->ShouldApplyAsMagnitude() || bModifierRecalculationPending)
+	{
+		RecalculateModifiers();
+	}
+	NotifyStatEffectApplied(Effect, bStacked);
+	return true;
+}
+
+int32 UStatsComponent::ApplyStatEffectToTargets(const TArray<UStatsComponent*>& Targets, TSubclassOf<UStatEffect> EffectToApply, AActor* EffectCauser, APawn* EffectInstigator)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ApplyStatEffectToTargets);
+	LLM_SCOPE_BYTAG(ActionSystem_Effects);
+	if (!IsValid(EffectToApply))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Effect class was invalid"))
+		return 0;
+	}
+
+	// everything that does not depend on the target is done once for the whole batch
+	UStatEffect* EffectDefaults = EffectToApply.GetDefaultObject();
+	// classes sharing their modifier table need no per-batch copy, and overridden GetModifiers run per target
+	const bool bCopyModifiers = !EffectDefaults->GetSharedModifierTable().IsValid() && !EffectDefaults->HasTargetDependentModifiers();
+	const TArray<FStatModifier> Modifiers = bCopyModifiers ? EffectDefaults->Modifiers : TArray<FStatModifier>();
+
+	struct FAppliedStatEffect
+	{
+		UStatsComponent* Target;
+		UStatEffect* Effect;
+		bool bStacked;
+	};
+	TArray<FAppliedStatEffect, TInlineAllocator<32>> Applied;
+	Applied.Reserve(Targets.Num());
+	TArray<UStatsComponent*> ServerTargets;
+	UStatsComponent* ServerSender = nullptr;
+
+	{
+		FActionSyncLoadScope SyncLoadScope(EffectDefaults);
+		for (UStatsComponent* Target : Targets)
+		{
+			if (!IsValid(Target))
+			{
+				continue;
+			}
+
+			if (!Target->GetOwner()->HasAuthority())
+			{
+				ServerTargets.Add(Target);
+				// only a target this client owns has a connection to call the server through
+				if (!ServerSender && Target->GetOwner()->GetNetConnection())
+				{
+					ServerSender = Target;
+				}
+			}
+
+			UStatEffect* Effect = nullptr;
+			bool bStacked = false;
+			TGuardValue<bool> DeferRecalculation(Target->bDeferModifierRecalculation, true);
+			if (Target->ApplyStatEffectInternal(EffectToApply, EffectCauser, EffectInstigator, bCopyModifiers ? &Modifiers : nullptr, Effect, bStacked, false))
+			{
+				Applied.Add({ Target, Effect, bStacked });
+			}
+		}
+	}
+
+	if (ServerSender)
+	{
+		ServerSender->ApplyStatEffectToTargets_Server(ServerTargets, EffectToApply, EffectCauser, EffectInstigator);
+	}
+
+	// the modifier totals of every target are evaluated together, then listeners hear about the whole hit
+	TArray<UStatsComponent*, TInlineAllocator<32>> RecalculateTargets;
+	for (const FAppliedStatEffect& Entry : Applied)
+	{
+		if (Entry.Effect->ShouldApplyAsMagnitude() || Entry.Target->bModifierRecalculationPending)
+		{
+			RecalculateTargets.AddUnique(Entry.Target);
+		}
+	}
+	for (UStatsComponent* Target : Targets)
+	{
+		if (IsValid(Target))
+		{
+			Target->bModifierRecalculationPending = false;
+		}
+	}
+	RecalculateModifiersForTargets(RecalculateTargets);
+
+	for (const FAppliedStatEffect& Entry : Applied)
+	{
+		Entry.Target->NotifyStatEffectApplied(Entry.Effect, Entry.bStacked);
+	}
+	return Applied.Num();
+}
+
+bool UStatsComponent::ApplyStatEffectInternal(TSubclassOf<UStatEffect> EffectToApply, AActor* EffectCauser, APawn* EffectInstigator,
+	const TArray<FStatModifier>* Modifiers, UStatEffect*& OutEffect, bool& bOutStacked, bool bSendToServer)
+{
 	// fail if we are immune
 	if (TagImmunities.HasAnyExact(EffectToApply.GetDefaultObject()->EffectTags))
 	{
@@ -105,42 +381,72 @@ bool UStatsComponent::ApplyStatEffect(TSubclassOf<UStatEffect> EffectToApply, AA
 	if (IsValid(EffectToStack))
 	{
 		UE_LOG(LogTemp, Warning, TEXT("Stacking effect..."))
-		if (!GetOwner()->HasAuthority())
+		if (bSendToServer && !GetOwner()->HasAuthority())
 		{
 			ApplyStatEffect_Server(EffectToApply, EffectCauser, EffectInstigator);
 		}
 		
 		// Fail if this would apply more than max stacks
-		bool bSuccess = false;
-		if (EffectToStack->AddStack())
+		if (!EffectToStack->AddStack())
 		{
-			OnEffectStackChange.Broadcast(EffectToStack, EffectToStack->CurrentStacks);
-			RecalculateModifiers();
-			bSuccess = true;
+			return false;
 		}
-		return bSuccess;
+		OutEffect = EffectToStack;
+		bOutStacked = true;
+		return true;
 	}
 	
 	// if the is no existing effect of that class, create a new one.
 	UStatEffect* NewEffect = NewObject<UStatEffect>(this, EffectToApply);
-	
-	if (NewEffect->ApplyEffect(this, EffectCauser, EffectInstigator))
+
+	// its assets are streamed in with the granting action; the scope reports anything applying it still loads
+	FActionSyncLoadScope SyncLoadScope(NewEffect);
+	if (!NewEffect->ApplyEffect(this, EffectCauser, EffectInstigator, Modifiers))
 	{
-		if (!GetOwner()->HasAuthority())
-		{
-			ApplyStatEffect_Server(EffectToApply, EffectCauser, EffectInstigator);
-		}
-		if (NewEffect->DurationType == EDurationType::Infinite || NewEffect->DurationType == EDurationType::HasDuration)
-		{
-			NewEffect->OnEffectRemoved.AddDynamic(this, &UStatsComponent::EffectRemoved);
-			NewEffect->OnStackChange.AddDynamic(this, &UStatsComponent::RecalculateModifiers);
-			ActiveEffects.Add(NewEffect);
-			RecalculateModifiers();
-		}
-		OnStatEffectApplied.Broadcast(NewEffect);
-		OnEffectStackChange.Broadcast(NewEffect, 1);
+		return false;
 	}
-	return false;
+
+	if (bSendToServer && !GetOwner()->HasAuthority())
+	{
+		ApplyStatEffect_Server(EffectToApply, EffectCauser, EffectInstigator);
+	}
+	if (NewEffect->DurationType == EDurationType::Infinite || NewEffect->DurationType == EDurationType::HasDuration)
+	{
+		NewEffect->OnEffectRemoved.AddDynamic(this, &UStatsComponent::EffectRemoved);
+		NewEffect->OnStackChange.AddDynamic(this, &UStatsComponent::RecalculateModifiers);
+		ActiveEffects.Add(NewEffect);
+		INC_DWORD_STAT(STAT_ActionSystem_ActiveEffects);
+	}
+	OutEffect = NewEffect;
+	bOutStacked = false;
+	return true;
+}
+
+void UStatsComponent::NotifyStatEffectApplied(UStatEffect* Effect, bool bStacked)
+{
+	if (bStacked)
+	{
+		TRACE_STAT_EFFECT_STACK_CHANGED(this, Effect);
+		CSV_CUSTOM_STAT(ActionSystem, EffectStacksAdded, 1, ECsvCustomStatOp::Accumulate);
+		OnEffectStackChange.Broadcast(Effect, Effect->GetCurrentStacks());
+		return;
+	}
+
+	TRACE_STAT_EFFECT_APPLIED(this, Effect);
+	CSV_CUSTOM_STAT(ActionSystem, EffectsApplied, 1, ECsvCustomStatOp::Accumulate);
+	OnStatEffectApplied.Broadcast(Effect);
+	OnEffectStackChange.Broadcast(Effect, 1);
+}
+
+bool UStatsComponent::AreStatEffectAssetsLoaded(TSubclassOf<UStatEffect> EffectClass)
+{
+	if (!EffectClass)
+	{
+		return false;
+	}
+	TArray<FSoftObjectPath> AssetPaths;
+	EffectClass.GetDefaultObject()->GetAssetDependencies(AssetPaths);
+	return FActionAssetLoading::AreLoaded(AssetPaths);
 }
 
 bool UStatsComponent::RemoveStatEffect(TSubclassOf<UStatEffect> EffectToRemove)
@@ -170,20 +476,149 @@ bool UStatsComponent::RemoveStatEffect(TSubclassOf<UStatEffect> EffectToRemove)
 
 void UStatsComponent::RecalculateModifiers()
 {
-	for (FStat CurrentStat : Stats)
+	if (bDeferModifierRecalculation)
 	{
-		UE_LOG(LogTemp, Warning, TEXT("RecalculateModifiers: Searching for stat %s"), *CurrentStat.Stat.GetTagName().ToString())
-		CurrentStat.ModifierMagniude = 0.0f;
-		for (UStatEffect* CurrentEffect : ActiveEffects)
+		bModifierRecalculationPending = true;
+		return;
+	}
+	SCOPE_CYCLE_COUNTER(STAT_RecalculateModifiers);
+	// on the game thread the live effects are read directly; only batches need a snapshot
+	FScopedStatTransaction Transaction(this);
+	bool bAnyChanged = false;
+	for (int32 i = 0; i < GetStats().Num(); i++)
+	{
+		const FStat& CurrentStat = GetStats()[i];
+		float Magnitude = 0.0f;
+		for (const UStatEffect* Effect : ActiveEffects)
 		{
-			if (!CurrentEffect->ShouldApplyAsMagnitude())
+			if (!IsValid(Effect) || !Effect->ShouldApplyAsMagnitude())
 			{
-				// effect should not come into play here if it should not apply as a magnitude
 				continue;
 			}
-			CurrentStat.ModifierMagniude = CurrentStat.ModifierMagniude + CurrentEffect->GetModifierMagnitudeForStat(CurrentStat.Stat);
+			// only the first modifier of an effect counts for each stat
+			if (const FStatModifier* Modifier = Effect->FindAppliedModifier(CurrentStat.Stat))
+			{
+				Magnitude += ActionSystemCore::ModifierMagnitude(static_cast<ActionSystemCore::EModifyOp>(Modifier->Method.GetValue()),
+					Modifier->Magnitude, Effect->GetCurrentStacks(), CurrentStat.CurrentValue);
+			}
 		}
-		Stats.FindByKey(CurrentStat.Stat)->ModifierMagniude = CurrentStat.ModifierMagniude;
+		bAnyChanged |= WriteModifierMagnitude(i, Magnitude);
+	}
+
+	if (bAnyChanged)
+	{
+		OnStatValuesUpdated.Broadcast(this);
+	}
+}
+
+void UStatsComponent::RecalculateModifiersForTargets(TArrayView<UStatsComponent* const> Targets)
+{
+	SCOPE_CYCLE_COUNTER(STAT_RecalculateModifiersForTargets);
+	if (Targets.Num() < StatParallelMagnitudeThreshold || StatParallelMagnitudeThreshold <= 0)
+	{
+		// too few targets for ParallelFor to pay for the snapshots
+		for (UStatsComponent* Target : Targets)
+		{
+			Target->RecalculateModifiers();
+		}
+		return;
+	}
+
+	TArray<FStatMagnitudeSnapshot> Snapshots;
+	Snapshots.SetNum(Targets.Num());
+	for (int32 i = 0; i < Targets.Num(); i++)
+	{
+		Targets[i]->MakeMagnitudeSnapshot(Snapshots[i]);
+	}
+
+	EvaluateMagnitudeSnapshots(Snapshots, true);
+
+	for (int32 i = 0; i < Targets.Num(); i++)
+	{
+		Targets[i]->ApplyMagnitudeSnapshot(Snapshots[i]);
+	}
+}
+
+void UStatsComponent::EvaluateMagnitudeSnapshots(TArrayView<FStatMagnitudeSnapshot> Snapshots, bool bParallel)
+{
+	ParallelFor(Snapshots.Num(), [&Snapshots](int32 Index)
+	{
+		Snapshots[Index].Evaluate();
+	}, !bParallel);
+}
+
+void UStatsComponent::MakeMagnitudeSnapshot(FStatMagnitudeSnapshot& OutSnapshot) const
+{
+	const TArray<FStat>& CurrentStats = GetStats();
+	OutSnapshot.StatTags.Reset(CurrentStats.Num());
+	OutSnapshot.BaseValues.Reset(CurrentStats.Num());
+	for (const FStat& CurrentStat : CurrentStats)
+	{
+		OutSnapshot.StatTags.Add(CurrentStat.Stat);
+		OutSnapshot.BaseValues.Add(CurrentStat.CurrentValue);
+	}
+
+	OutSnapshot.Effects.Reset(ActiveEffects.Num());
+	for (const UStatEffect* CurrentEffect : ActiveEffects)
+	{
+		// effect should not come into play here if it should not apply as a magnitude
+		if (!IsValid(CurrentEffect) || !CurrentEffect->ShouldApplyAsMagnitude())
+		{
+			continue;
+		}
+		FStatMagnitudeSnapshot::FEffectEntry& Entry = OutSnapshot.Effects.AddDefaulted_GetRef();
+		Entry.Modifiers = CurrentEffect->GetAppliedModifiers();
+		Entry.Stacks = CurrentEffect->GetCurrentStacks();
+	}
+}
+
+void UStatsComponent::ApplyMagnitudeSnapshot(const FStatMagnitudeSnapshot& Snapshot)
+{
+	// derived stats reading several of these are recomputed once
+	FScopedStatTransaction Transaction(this);
+
+	// stats are only added outside of gameplay, so the snapshot still lines up with GetStats
+	bool bAnyChanged = false;
+	const int32 NumStats = FMath::Min(GetStats().Num(), Snapshot.Magnitudes.Num());
+	for (int32 i = 0; i < NumStats; i++)
+	{
+		bAnyChanged |= WriteModifierMagnitude(i, Snapshot.Magnitudes[i]);
+	}
+
+	if (bAnyChanged)
+	{
+		OnStatValuesUpdated.Broadcast(this);
+	}
+}
+
+bool UStatsComponent::WriteModifierMagnitude(int32 StatIndex, float Magnitude)
+{
+	if (GetStats()[StatIndex].ModifierMagniude == Magnitude)
+	{
+		return false;
+	}
+	MakeStatsUnique();
+	Stats[StatIndex].ModifierMagniude = Magnitude;
+	MarkStatChanged(Stats[StatIndex].Stat);
+	return true;
+}
+
+void FStatMagnitudeSnapshot::Evaluate()
+{
+	Magnitudes.SetNumUninitialized(StatTags.Num());
+	for (int32 StatIndex = 0; StatIndex < StatTags.Num(); StatIndex++)
+	{
+		float Magnitude = 0.0f;
+		for (const FEffectEntry& Effect : Effects)
+		{
+			// only the first modifier of an effect counts for each stat
+			if (const FStatModifier* Modifier = Effect.Modifiers.FindByKey(StatTags[StatIndex]))
+			{
+				Magnitude += ActionSystemCore::ModifierMagnitude(static_cast<ActionSystemCore::EModifyOp>(Modifier->Method.GetValue()),
+					Modifier->Magnitude, Effect.Stacks, BaseValues[StatIndex]);
+			}
+		}
+		Magnitudes[StatIndex] = Magnitude;
 	}
 }
 
@@ -205,12 +640,22 @@ void UStatsComponent::OnRep_ActiveEffects()
 	RecalculateModifiers();
 }
 
+void UStatsComponent::OnRep_Stats()
+{
+	OnStatValuesUpdated.Broadcast(this);
+}
+
 void UStatsComponent::EffectRemoved(UStatEffect* Effect)
 {
 	if (IsValid(Effect))
 	{
 		UE_LOG(LogTemp, Warning, TEXT("Removed Effect %s"), *Effect->GetName())
+		DEC_DWORD_STAT(STAT_ActionSystem_ActiveEffects);
+		// removed effects stay in ActiveEffects; unbinding marks them as no longer counted
+		Effect->OnEffectRemoved.RemoveDynamic(this, &UStatsComponent::EffectRemoved);
 		TagImmunities.RemoveTags(Effect->GrantedTagImmunities);
+		TRACE_STAT_EFFECT_REMOVED(this, Effect);
+		CSV_CUSTOM_STAT(ActionSystem, EffectsRemoved, 1, ECsvCustomStatOp::Accumulate);
 		OnStatEffectRemoved.Broadcast(Effect);
 	}
 	RecalculateModifiers();
@@ -220,11 +665,9 @@ void UStatsComponent::SetStatValue(FGameplayTag Stat, float NewValue)
 {
 	if (GetOwner()->GetLocalRole() == ROLE_Authority)
 	{
-		if (Stats.Contains(Stat))
+		if (WriteStatValue(Stat, NewValue))
 		{
-			float OldValue = Stats.FindByKey(Stat)->CurrentValue;
-			Stats.FindByKey(Stat)->CurrentValue = FMath::Clamp(NewValue, NewValue, Stats.FindByKey(Stat)->MaxValue);
-			OnStatChanged.Broadcast(Stat, NewValue, OldValue);
+			MarkStatChanged(Stat);
 		}
 	}
 	else
@@ -233,22 +676,438 @@ void UStatsComponent::SetStatValue(FGameplayTag Stat, float NewValue)
 	}
 }
 
+bool UStatsComponent::WriteStatValue(FGameplayTag Stat, float NewValue)
+{
+	const FStat* FoundStat = FindStat(Stat);
+	if (!FoundStat)
+	{
+		return false;
+	}
+
+	const float OldValue = FoundStat->CurrentValue;
+	const float ClampedValue = ActionSystemCore::ClampStatValue(NewValue, FoundStat->MaxValue);
+	// writing the value it already has keeps the shared archetype values and tells nobody
+	if (ClampedValue == OldValue)
+	{
+		return false;
+	}
+	FindMutableStat(Stat)->CurrentValue = ClampedValue;
+	NotifyStatValueChanged(Stat, OldValue, ClampedValue);
+	return true;
+}
+
+void UStatsComponent::NotifyStatValueChanged(FGameplayTag Stat, float OldValue, float NewValue)
+{
+	RecordStatHistory(Stat, OldValue, NewValue);
+	TRACE_STAT_CHANGED(this, Stat, OldValue, NewValue);
+	OnStatChanged.Broadcast(Stat, NewValue, OldValue);
+}
+
+//
+// HISTORY ---------------------------------
+//
+
+void FStatHistoryBuffer::Init(int32 Capacity)
+{
+	Entries.SetNum(Capacity);
+	Reset();
+}
+
+void FStatHistoryBuffer::Add(const FStatHistoryEntry& Entry)
+{
+	if (Entries.Num() == 0)
+	{
+		return;
+	}
+	Entries[Head] = Entry;
+	Head = (Head + 1) % Entries.Num();
+	Count = FMath::Min(Count + 1, Entries.Num());
+}
+
+void FStatHistoryBuffer::Reset()
+{
+	Head = 0;
+	Count = 0;
+}
+
+const FStatHistoryEntry& FStatHistoryBuffer::GetFromNewest(int32 Index) const
+{
+	check(Index >= 0 && Index < Count);
+	return Entries[(Head - 1 - Index + Entries.Num()) % Entries.Num()];
+}
+
+void UStatsComponent::InitializeStatHistory()
+{
+	StatHistory.Reset();
+	if (StatHistoryCapacity <= 0)
+	{
+		return;
+	}
+	for (const FGameplayTag& Stat : StatHistoryStats)
+	{
+		StatHistory.Add(Stat).Init(StatHistoryCapacity);
+	}
+}
+
+void UStatsComponent::RecordStatHistory(FGameplayTag Stat, float OldValue, float NewValue)
+{
+	FStatHistoryBuffer* Buffer = StatHistory.Find(Stat);
+	if (!Buffer)
+	{
+		return;
+	}
+
+	FStatHistoryEntry Entry;
+	Entry.Time = GetWorld() ? GetWorld()->GetTimeSeconds() : 0.0f;
+	Entry.OldValue = OldValue;
+	Entry.NewValue = NewValue;
+	Entry.SourceEffect = StatChangeEffect;
+	Entry.Instigator = StatChangeInstigator;
+	Buffer->Add(Entry);
+}
+
+const FStatHistoryBuffer* UStatsComponent::FindStatHistory(FGameplayTag Stat) const
+{
+	return StatHistory.Find(Stat);
+}
+
+void UStatsComponent::GetStatHistory(FGameplayTag Stat, TArray<FStatHistoryEntry>& OutEntries) const
+{
+	OutEntries.Reset();
+	if (const FStatHistoryBuffer* Buffer = FindStatHistory(Stat))
+	{
+		OutEntries.Reserve(Buffer->Num());
+		for (int32 i = Buffer->Num() - 1; i >= 0; i--)
+		{
+			OutEntries.Add(Buffer->GetFromNewest(i));
+		}
+	}
+}
+
+float UStatsComponent::GetStatChangeInWindow(FGameplayTag Stat, float Seconds) const
+{
+	const FStatHistoryBuffer* Buffer = FindStatHistory(Stat);
+	if (!Buffer || !GetWorld())
+	{
+		return 0.0f;
+	}
+
+	const float WindowStart = GetWorld()->GetTimeSeconds() - Seconds;
+	float Change = 0.0f;
+	for (int32 i = 0; i < Buffer->Num(); i++)
+	{
+		const FStatHistoryEntry& Entry = Buffer->GetFromNewest(i);
+		if (Entry.Time < WindowStart)
+		{
+			break;
+		}
+		Change += Entry.NewValue - Entry.OldValue;
+	}
+	return Change;
+}
+
+float UStatsComponent::GetStatLossPerSecond(FGameplayTag Stat, float Seconds) const
+{
+	const FStatHistoryBuffer* Buffer = FindStatHistory(Stat);
+	if (!Buffer || !GetWorld() || Seconds <= 0.0f)
+	{
+		return 0.0f;
+	}
+
+	const float WindowStart = GetWorld()->GetTimeSeconds() - Seconds;
+	float Loss = 0.0f;
+	for (int32 i = 0; i < Buffer->Num(); i++)
+	{
+		const FStatHistoryEntry& Entry = Buffer->GetFromNewest(i);
+		if (Entry.Time < WindowStart)
+		{
+			break;
+		}
+		Loss += FMath::Max(Entry.OldValue - Entry.NewValue, 0.0f);
+	}
+	return Loss / Seconds;
+}
+
+void UStatsComponent::ClearStatHistory()
+{
+	for (TPair<FGameplayTag, FStatHistoryBuffer>& Pair : StatHistory)
+	{
+		Pair.Value.Reset();
+	}
+}
+
+//
+// DERIVED STATS ---------------------------------
+//
+
+void UStatsComponent::SetDerivedStats(const TArray<FDerivedStat>& NewDerivedStats)
+{
+	DerivedStats = NewDerivedStats;
+	BuildDerivedStatGraph();
+	FlushDerivedStats();
+}
+
+void UStatsComponent::BeginStatTransaction()
+{
+	StatTransactionDepth++;
+}
+
+void UStatsComponent::EndStatTransaction()
+{
+	check(StatTransactionDepth > 0);
+	if (--StatTransactionDepth == 0)
+	{
+		FlushDerivedStats();
+	}
+}
+
+bool UStatsComponent::IsInStatTransaction() const
+{
+	return StatTransactionDepth > 0;
+}
+
+void UStatsComponent::MarkStatChanged(FGameplayTag Stat)
+{
+	bool bAnyDirty = false;
+	for (TMultiMap<FGameplayTag, int32>::TConstKeyIterator It(DerivedStatDependents, Stat); It; ++It)
+	{
+		DirtyDerivedStats[It.Value()] = true;
+		bAnyDirty = true;
+	}
+
+	if (bAnyDirty && StatTransactionDepth == 0 && !bFlushingDerivedStats)
+	{
+		FlushDerivedStats();
+	}
+}
+
+void UStatsComponent::BuildDerivedStatGraph()
+{
+	SCOPE_CYCLE_COUNTER(STAT_BuildDerivedStatGraph);
+	DerivedStatOrder.Reset(DerivedStats.Num());
+	DerivedStatDependents.Reset();
+	DirtyDerivedStats.Init(true, DerivedStats.Num());
+
+	TMap<FGameplayTag, int32> DerivedIndexByStat;
+	for (int32 i = 0; i < DerivedStats.Num(); i++)
+	{
+		if (DerivedIndexByStat.Contains(DerivedStats[i].Stat))
+		{
+			UE_LOG(LogTemp, Warning, TEXT("%s: stat %s is derived more than once, only the first formula is used"), *GetPathName(), *DerivedStats[i].Stat.ToString())
+			continue;
+		}
+		DerivedIndexByStat.Add(DerivedStats[i].Stat, i);
+	}
+
+	// Kahn's algorithm over the edges between derived stats; plain stats are never waited on
+	TArray<int32> PendingInputs;
+	PendingInputs.SetNumZeroed(DerivedStats.Num());
+	TMultiMap<int32, int32> DownstreamOf;
+	for (const TPair<FGameplayTag, int32>& Entry : DerivedIndexByStat)
+	{
+		for (const FDerivedStatTerm& Term : DerivedStats[Entry.Value].Terms)
+		{
+			DerivedStatDependents.AddUnique(Term.Input, Entry.Value);
+			if (const int32* InputIndex = DerivedIndexByStat.Find(Term.Input))
+			{
+				DownstreamOf.AddUnique(*InputIndex, Entry.Value);
+				PendingInputs[Entry.Value]++;
+			}
+		}
+	}
+
+	TArray<int32> Ready;
+	for (const TPair<FGameplayTag, int32>& Entry : DerivedIndexByStat)
+	{
+		if (PendingInputs[Entry.Value] == 0)
+		{
+			Ready.Add(Entry.Value);
+		}
+	}
+	while (Ready.Num() > 0)
+	{
+		const int32 Index = Ready.Pop(false);
+		DerivedStatOrder.Add(Index);
+		for (TMultiMap<int32, int32>::TConstKeyIterator It(DownstreamOf, Index); It; ++It)
+		{
+			if (--PendingInputs[It.Value()] == 0)
+			{
+				Ready.Add(It.Value());
+			}
+		}
+	}
+
+	if (DerivedStatOrder.Num() < DerivedIndexByStat.Num())
+	{
+		// whatever Kahn's algorithm left is either on a cycle or reads one
+		for (const TPair<FGameplayTag, int32>& Entry : DerivedIndexByStat)
+		{
+			if (DerivedStatOrder.Contains(Entry.Value))
+			{
+				continue;
+			}
+			if (IsDerivedStatOnCycle(Entry.Value, DownstreamOf))
+			{
+				UE_LOG(LogTemp, Error, TEXT("%s: derived stat %s is part of a dependency cycle and will not be computed"), *GetPathName(), *Entry.Key.ToString())
+			}
+			else
+			{
+				UE_LOG(LogTemp, Error, TEXT("%s: derived stat %s reads a stat in a dependency cycle and will not be computed"), *GetPathName(), *Entry.Key.ToString())
+			}
+		}
+	}
+}
+
+bool UStatsComponent::IsDerivedStatOnCycle(int32 Index, const TMultiMap<int32, int32>& DownstreamOf) const
+{
+	// depth first search for a path leading back to Index
+	TArray<int32> Pending;
+	TBitArray<> Visited(false, DerivedStats.Num());
+	Pending.Add(Index);
+	while (Pending.Num() > 0)
+	{
+		const int32 Current = Pending.Pop(false);
+		for (TMultiMap<int32, int32>::TConstKeyIterator It(DownstreamOf, Current); It; ++It)
+		{
+			if (It.Value() == Index)
+			{
+				return true;
+			}
+			if (!Visited[It.Value()])
+			{
+				Visited[It.Value()] = true;
+				Pending.Add(It.Value());
+			}
+		}
+	}
+	return false;
+}
+
+void UStatsComponent::FlushDerivedStats()
+{
+	// clients receive the results through Stats
+	if (bFlushingDerivedStats || DerivedStatOrder.Num() == 0 || !GetOwner() || !GetOwner()->HasAuthority())
+	{
+		return;
+	}
+	SCOPE_CYCLE_COUNTER(STAT_FlushDerivedStats);
+	TGuardValue<bool> FlushGuard(bFlushingDerivedStats, true);
+
+	// in dependency order every input is final before a stat reads it, so each dirty stat is computed once.
+	// Stats changed by OnStatChanged listeners during the flush stay dirty until the next one
+	for (const int32 Index : DerivedStatOrder)
+	{
+		if (!DirtyDerivedStats[Index])
+		{
+			continue;
+		}
+		DirtyDerivedStats[Index] = false;
+
+		const FDerivedStat& Derived = DerivedStats[Index];
+		float Value = Derived.Constant;
+		for (const FDerivedStatTerm& Term : Derived.Terms)
+		{
+			const float Input = GetStatCurrentValue(Term.Input);
+			Value += Term.Coefficient * (Term.Curve ? Term.Curve->GetFloatValue(Input) : Input);
+		}
+
+		if (WriteStatValue(Derived.Stat, Value))
+		{
+			MarkStatChanged(Derived.Stat);
+		}
+	}
+}
+
 void UStatsComponent::SetStatValue_Server_Implementation(FGameplayTag Stat, float NewValue)
 {
+	CSV_CUSTOM_STAT(ActionSystem, ServerStatRPCs, 1, ECsvCustomStatOp::Accumulate);
+	FActionSystemNetCounters::ServerStatRPCs++;
 	SetStatValue(Stat, NewValue);
 }
 
+void UStatsComponent::SetStatLevel_Server_Implementation(int32 NewLevel)
+{
+	CSV_CUSTOM_STAT(ActionSystem, ServerStatRPCs, 1, ECsvCustomStatOp::Accumulate);
+	FActionSystemNetCounters::ServerStatRPCs++;
+	SetStatLevel(NewLevel);
+}
+
 
 void UStatsComponent::RemoveStatEffect_Server_Implementation(TSubclassOf<UStatEffect> EffectToRemove)
 {
+	CSV_CUSTOM_STAT(ActionSystem, ServerStatRPCs, 1, ECsvCustomStatOp::Accumulate);
+	FActionSystemNetCounters::ServerStatRPCs++;
 	RemoveStatEffect(EffectToRemove);
 }
 
 void UStatsComponent::ApplyStatEffect_Server_Implementation(TSubclassOf<UStatEffect> EffectToApply, AActor* inEffectCauser, APawn* inEffectInstigator)
 {
+	CSV_CUSTOM_STAT(ActionSystem, ServerStatRPCs, 1, ECsvCustomStatOp::Accumulate);
+	FActionSystemNetCounters::ServerStatRPCs++;
 	ApplyStatEffect(EffectToApply, inEffectCauser, inEffectInstigator);
 }
 
+void UStatsComponent::ApplyStatEffectToTargets_Server_Implementation(const TArray<UStatsComponent*>& Targets, TSubclassOf<UStatEffect> EffectToApply, AActor* inEffectCauser, APawn* inEffectInstigator)
+{
+	CSV_CUSTOM_STAT(ActionSystem, ServerStatRPCs, 1, ECsvCustomStatOp::Accumulate);
+	FActionSystemNetCounters::ServerStatRPCs++;
+
+	// the client only names the targets; the causer and instigator must be its own
+	UNetConnection* Connection = GetOwner()->GetNetConnection();
+	if (!Connection || (inEffectInstigator && inEffectInstigator->GetNetConnection() != Connection)
+		|| (inEffectCauser && inEffectCauser->GetNetConnection() != Connection))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s: dropped a client effect batch whose causer or instigator is not owned by the sender"), *GetPathName())
+		return;
+	}
+
+	TArray<UStatsComponent*> AllowedTargets;
+	AllowedTargets.Reserve(Targets.Num());
+	for (UStatsComponent* Target : Targets)
+	{
+		if (IsClientBatchTargetAllowed(Target, Connection, inEffectInstigator))
+		{
+			AllowedTargets.AddUnique(Target);
+		}
+		else
+		{
+			UE_LOG(LogTemp, Warning, TEXT("%s: client effect batch target %s rejected"), *GetPathName(), *GetPathNameSafe(Target))
+		}
+	}
+	ApplyStatEffectToTargets(AllowedTargets, EffectToApply, inEffectCauser, inEffectInstigator);
+}
+
+bool UStatsComponent::IsClientBatchTargetAllowed(const UStatsComponent* Target, UNetConnection* Connection, const APawn* EffectInstigator) const
+{
+	if (!IsValid(Target) || !Target->GetOwner() || Target->GetWorld() != GetWorld())
+	{
+		return false;
+	}
+	const AActor* TargetActor = Target->GetOwner();
+	// the sender could already reach its own actors through ApplyStatEffect_Server
+	if (TargetActor->GetNetConnection() == Connection)
+	{
+		return true;
+	}
+
+	// anything else has to be near the sender's instigator and relevant to the sender
+	if (!EffectInstigator || StatClientBatchRange <= 0.0f)
+	{
+		return false;
+	}
+	const FVector SourceLocation = EffectInstigator->GetActorLocation();
+	if (FVector::DistSquared(TargetActor->GetActorLocation(), SourceLocation) > FMath::Square(StatClientBatchRange))
+	{
+		return false;
+	}
+	const AActor* ViewTarget = Connection->ViewTarget;
+	if (!ViewTarget)
+	{
+		ViewTarget = EffectInstigator;
+	}
+	return TargetActor->IsNetRelevantFor(Connection->PlayerController, ViewTarget, SourceLocation);
+}
+
 
 TArray<UStatEffect*> UStatsComponent::GetActiveEffects()
 {
@@ -259,11 +1118,46 @@ TArray<UStatEffect*> UStatsComponent::GetActiveEffects()
 void UStatsComponent::BeginPlay()
 {
 	Super::BeginPlay();
+	TRACE_ACTION_COMPONENT_SPEC(this);
+
+	if (!StatInitRow.IsNull())
+	{
+		// clients keep the Stats the server already replicated
+		if (GetOwner()->HasAuthority())
+		{
+			if (Stats.Num() > 0)
+			{
+				UE_LOG(LogTemp, Warning, TEXT("%s: Stats are replaced by StatInitRow %s"), *GetPathName(), *StatInitRow.RowName.ToString())
+			}
+			Stats.Reset();
+		}
+		ResolveInitialStats();
+	}
+
+	InitializeStatHistory();
+	BuildDerivedStatGraph();
+	FlushDerivedStats();
 
 	// ...
 	
 }
 
+void UStatsComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	// effects still running when we go away never report their removal
+	for (UStatEffect* Effect : ActiveEffects)
+	{
+		if (IsValid(Effect) && Effect->OnEffectRemoved.IsAlreadyBound(this, &UStatsComponent::EffectRemoved))
+		{
+			Effect->OnEffectRemoved.RemoveDynamic(this, &UStatsComponent::EffectRemoved);
+			DEC_DWORD_STAT(STAT_ActionSystem_ActiveEffects);
+		}
+	}
+	TRACE_ACTION_COMPONENT_ENDED(this);
+
+	Super::EndPlay(EndPlayReason);
+}
+
 
 // Called every frame
 void UStatsComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
@@ -278,6 +1172,7 @@ void UStatsComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutL
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 	
 	DOREPLIFETIME_CONDITION(UStatsComponent, Stats, COND_OwnerOnly);
+	DOREPLIFETIME(UStatsComponent, StatLevel);
 	DOREPLIFETIME_CONDITION(UStatsComponent, TagImmunities, COND_OwnerOnly);
 	DOREPLIFETIME_CONDITION(UStatsComponent, ActiveEffects, COND_InitialOnly);
 }
@@ -0,0 +1,146 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "StatExpression.h"
+#include "StatsComponent.h"
+#include "Curves/CurveFloat.h"
+#include "Misc/AutomationTest.h"
+#include "UObject/Package.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+	// the stat the expressions read; the same one ActionSystem.Benchmark uses by default
+	const TCHAR* TestStatName = TEXT("Stat.Health");
+
+	bool CompileExpression(const FString& Expression, FStatExpressionProgram& OutProgram, FString& OutError, const TMap<FName, UCurveFloat*>& Curves = TMap<FName, UCurveFloat*>())
+	{
+		return FStatExpressionProgram::Compile(Expression, Curves, OutProgram, OutError);
+	}
+
+	float EvaluateExpression(FAutomationTestBase& Test, const FString& Expression, const FStatExpressionContext& Context = FStatExpressionContext(), const TMap<FName, UCurveFloat*>& Curves = TMap<FName, UCurveFloat*>())
+	{
+		FStatExpressionProgram Program;
+		FString Error;
+		if (!CompileExpression(Expression, Program, Error, Curves))
+		{
+			Test.AddError(FString::Printf(TEXT("'%s' did not compile: %s"), *Expression, *Error));
+			return 0.0f;
+		}
+		return Program.Evaluate(Context);
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FStatExpressionParserTest, "ActionSystem.StatExpression.Parser",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FStatExpressionParserTest::RunTest(const FString& Parameters)
+{
+	const TCHAR* Valid[] = {
+		TEXT("1"),
+		TEXT("1.5"),
+		TEXT(".5"),
+		TEXT("2."),
+		TEXT(" 2 * ( 3 + 4 ) "),
+		TEXT("-1 - -2"),
+		TEXT("min(1, max(2, 3))"),
+	};
+	for (const TCHAR* Expression : Valid)
+	{
+		FStatExpressionProgram Program;
+		FString Error;
+		TestTrue(FString::Printf(TEXT("'%s' compiles"), Expression), CompileExpression(Expression, Program, Error) && Program.IsValid());
+	}
+
+	const TCHAR* Invalid[] = {
+		TEXT(""),
+		TEXT("1.2.3"),
+		TEXT("."),
+		TEXT("1 +"),
+		TEXT("(1"),
+		TEXT("1)"),
+		TEXT("1 2"),
+		TEXT("min(1)"),
+		TEXT("Stacks"),
+		TEXT("Unknown"),
+		TEXT("Target[Stat.DoesNotExist]"),
+		TEXT("curve(Missing, 1)"),
+	};
+	for (const TCHAR* Expression : Invalid)
+	{
+		FStatExpressionProgram Program;
+		FString Error;
+		const bool bCompiled = CompileExpression(Expression, Program, Error);
+		TestFalse(FString::Printf(TEXT("'%s' is rejected"), Expression), bCompiled);
+		TestFalse(FString::Printf(TEXT("'%s' leaves no program"), Expression), Program.IsValid());
+		TestFalse(FString::Printf(TEXT("'%s' reports an error"), Expression), Error.IsEmpty());
+	}
+
+	FStatExpressionProgram Program;
+	FString Error;
+	CompileExpression(TEXT("1 + 2.3.4"), Program, Error);
+	TestEqual(TEXT("The error names the column"), Error, FString(TEXT("malformed number at column 8")));
+
+	// constants and stats are pooled, so repeats share an operand
+	const FString StatExpression = FString::Printf(TEXT("Target[%s] + Target[%s]"), TestStatName, TestStatName);
+	if (CompileExpression(StatExpression, Program, Error))
+	{
+		TestEqual(TEXT("Repeated stats are stored once"), Program.Stats.Num(), 1);
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FStatExpressionEvaluateTest, "ActionSystem.StatExpression.Evaluate",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FStatExpressionEvaluateTest::RunTest(const FString& Parameters)
+{
+	TestEqual(TEXT("Precedence"), EvaluateExpression(*this, TEXT("2 + 3 * 4")), 14.0f);
+	TestEqual(TEXT("Parentheses"), EvaluateExpression(*this, TEXT("(2 + 3) * 4")), 20.0f);
+	TestEqual(TEXT("Subtraction is left associative"), EvaluateExpression(*this, TEXT("1 - 2 - 3")), -4.0f);
+	TestEqual(TEXT("Division is left associative"), EvaluateExpression(*this, TEXT("8 / 2 / 2")), 2.0f);
+	TestEqual(TEXT("Unary minus"), EvaluateExpression(*this, TEXT("-2 * -3")), 6.0f);
+	TestEqual(TEXT("Division by zero"), EvaluateExpression(*this, TEXT("10 / 0")), 0.0f);
+	TestEqual(TEXT("Leading point"), EvaluateExpression(*this, TEXT(".5 * 4")), 2.0f);
+	TestEqual(TEXT("min"), EvaluateExpression(*this, TEXT("min(3, 4)")), 3.0f);
+	TestEqual(TEXT("max"), EvaluateExpression(*this, TEXT("max(3, -4)")), 3.0f);
+
+	UCurveFloat* Curve = NewObject<UCurveFloat>(GetTransientPackage());
+	Curve->FloatCurve.AddKey(0.0f, 0.0f);
+	Curve->FloatCurve.AddKey(10.0f, 100.0f);
+	TMap<FName, UCurveFloat*> Curves;
+	Curves.Add(TEXT("Scale"), Curve);
+	TestEqual(TEXT("curve"), EvaluateExpression(*this, TEXT("curve(Scale, 2 + 3)"), FStatExpressionContext(), Curves), 50.0f);
+
+	const FGameplayTag StatTag = FGameplayTag::RequestGameplayTag(TestStatName, false);
+	if (!StatTag.IsValid())
+	{
+		AddWarning(FString::Printf(TEXT("%s is not a registered gameplay tag, stat operands were not tested"), TestStatName));
+		return true;
+	}
+
+	const FString TargetExpression = FString::Printf(TEXT("Target[%s] * 2"), TestStatName);
+	const FString SourceExpression = FString::Printf(TEXT("Target[%s] - Source[%s]"), TestStatName, TestStatName);
+	TestEqual(TEXT("Missing components read as 0"), EvaluateExpression(*this, TargetExpression), 0.0f);
+
+	UStatsComponent* Target = NewObject<UStatsComponent>(GetTransientPackage());
+	UStatsComponent* Source = NewObject<UStatsComponent>(GetTransientPackage());
+	FStat Stat;
+	Stat.Stat = StatTag;
+	Stat.ModifierMagniude = 0.0f;
+	Stat.MaxValue = 100.0f;
+	Stat.CurrentValue = 40.0f;
+	Target->AddStat(Stat);
+	Stat.CurrentValue = 15.0f;
+	Source->AddStat(Stat);
+
+	FStatExpressionContext Context;
+	Context.Target = Target;
+	Context.Source = Source;
+	TestEqual(TEXT("Target stat"), EvaluateExpression(*this, TargetExpression, Context), 80.0f);
+	TestEqual(TEXT("Source stat"), EvaluateExpression(*this, SourceExpression, Context), 25.0f);
+	return true;
+}
+
+#endif
@@ -4,6 +4,42 @@
 
 #define LOCTEXT_NAMESPACE "FUniversalActionSystemModule"
 
+DEFINE_STAT(STAT_ActionSystem_GrantedActions);
+DEFINE_STAT(STAT_ActionSystem_RunningActions);
+DEFINE_STAT(STAT_ActionSystem_ActionObjects);
+DEFINE_STAT(STAT_ActionSystem_ActiveTasks);
+DEFINE_STAT(STAT_ActionSystem_ActiveEffects);
+DEFINE_STAT(STAT_ActionSystem_EffectObjects);
+DEFINE_STAT(STAT_ActionSystem_ActionObjectMemory);
+DEFINE_STAT(STAT_ActionSystem_ComponentMemory);
+DEFINE_STAT(STAT_ActionSystem_EffectObjectMemory);
+
+CSV_DEFINE_CATEGORY_MODULE(UNIVERSALACTIONSYSTEM_API, ActionSystem, true);
+
+LLM_DEFINE_TAG(ActionSystem);
+LLM_DEFINE_TAG(ActionSystem_Actions, TEXT("Actions"), TEXT("ActionSystem"));
+LLM_DEFINE_TAG(ActionSystem_Effects, TEXT("Effects"), TEXT("ActionSystem"));
+LLM_DEFINE_TAG(ActionSystem_Tasks, TEXT("Tasks"), TEXT("ActionSystem"));
+
+uint64 FActionSystemNetCounters::ServerActionRPCs = 0;
+uint64 FActionSystemNetCounters::ServerStatRPCs = 0;
+bool FActionSystemNetCounters::bRecordReplication = false;
+TMap<FName, TPair<uint64, uint64>> FActionSystemNetCounters::ReplicationCycles;
+
+void FActionSystemNetCounters::RecordReplication(const UObject* Object, uint32 Cycles)
+{
+	TPair<uint64, uint64>& Entry = ReplicationCycles.FindOrAdd(Object->GetClass()->GetFName());
+	Entry.Key += Cycles;
+	Entry.Value++;
+}
+
+void FActionSystemNetCounters::Reset()
+{
+	ServerActionRPCs = 0;
+	ServerStatRPCs = 0;
+	ReplicationCycles.Reset();
+}
+
 void FUniversalActionSystemModule::StartupModule()
 {
 	// This code will execute after your module is loaded into memory; the exact timing is specified in the .uplugin file per-module
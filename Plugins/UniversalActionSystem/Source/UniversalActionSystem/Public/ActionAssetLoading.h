@@ -0,0 +1,51 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/SoftObjectPath.h"
+#include "UObject/SoftObjectPtr.h"
+
+class FStreamableManager;
+struct FStreamableHandle;
+
+/* Streams the soft dependencies declared by actions and stat effects ahead of their first use */
+struct UNIVERSALACTIONSYSTEM_API FActionAssetLoading
+{
+	/* The asset manager's streamable manager when there is one, otherwise one owned by this module */
+	static FStreamableManager& GetStreamableManager();
+
+	/* Requests every path as a single async load. The assets stay loaded while the returned handle is alive.
+	 * Returns null when Paths is empty */
+	static TSharedPtr<FStreamableHandle> RequestAsyncLoad(TArray<FSoftObjectPath> Paths, const FString& DebugName);
+
+	/* True when every path is already in memory */
+	static bool AreLoaded(const TArray<FSoftObjectPath>& Paths);
+
+	/* Appends the set entries of Assets and Classes, the dependency lists actions and stat effects declare */
+	static void GatherPaths(const TArray<TSoftObjectPtr<UObject>>& Assets, const TArray<TSoftClassPtr<UObject>>& Classes, TArray<FSoftObjectPath>& OutPaths);
+
+	/* Appends the asset dependencies of every loaded stat effect class among Paths. Actions list the effects they
+	 * apply as class dependencies, so what those effects use streams in with the action instead of on apply */
+	static void GatherEffectPaths(const TArray<FSoftObjectPath>& Paths, TArray<FSoftObjectPath>& OutPaths);
+};
+
+/* While in scope, packages loaded synchronously are logged against Context (the action or effect activating).
+ * Controlled by ActionSystem.LogActivationSyncLoads; compiled out of shipping builds */
+struct UNIVERSALACTIONSYSTEM_API FActionSyncLoadScope
+{
+	explicit FActionSyncLoadScope(const UObject* Context);
+	~FActionSyncLoadScope();
+
+	/* Sync loads seen inside any scope since startup */
+	static int32 GetSyncLoadCount();
+
+	FActionSyncLoadScope(const FActionSyncLoadScope&) = delete;
+	FActionSyncLoadScope& operator=(const FActionSyncLoadScope&) = delete;
+
+private:
+
+#if !UE_BUILD_SHIPPING
+	const UObject* PreviousContext = nullptr;
+#endif
+};
@@ -9,6 +9,7 @@
 #include "GameplayTagContainer.h"
 #include "GameplayTaskOwnerInterface.h"
 #include "ActionTypes.h"
+#include "ActionAssetLoading.h"
 // #include "Kismet/KismetSystemLibrary.h"
 #include "ActionBase.generated.h"
 
@@ -18,6 +19,7 @@ class UWorld;
 class UActionComponent;
 class UGameplayTask;
 class UGameplayTasksComponent;
+class UActionDefinition;
 
 USTRUCT()
 struct FActionRepData
@@ -27,10 +29,45 @@ struct FActionRepData
 public:
 
 	UPROPERTY()
-	bool bIsRunning;
+	bool bIsRunning = false;
 
 	UPROPERTY()
-	AActor* Instigator;
+	AActor* Instigator = nullptr;
+};
+
+/* Per-actor runtime state of an action. Lives on the object for instanced actions and on the
+ * owning component for non-instanced ones */
+USTRUCT()
+struct FActionExecutionState
+{
+	GENERATED_BODY()
+
+public:
+
+	UPROPERTY()
+	FActionRepData RepData;
+
+	UPROPERTY()
+	float TimeStarted = -1.0f;
+
+	UPROPERTY()
+	float CooldownCommitTime = -1.0f;
+
+	UPROPERTY()
+	bool bInputPressed = false;
+
+	EFailureReason LastFailureReason = EFailureReason::AlreadyRunning;
+};
+
+/* The per-actor state an action reads and writes: its own members when instanced, the record of the component it
+ * is running for when non-instanced. Only valid until the action calls back into the component */
+struct FActionStateRef
+{
+	FActionRepData& RepData;
+	float& TimeStarted;
+	float& CooldownCommitTime;
+	bool& bInputPressed;
+	EFailureReason& LastFailureReason;
 };
 
 UENUM()
@@ -42,10 +79,128 @@ enum ECooldownMethod
 	AutoFromFinish		UMETA(DisplayName="Auto From Finish")
 };
 
+UENUM()
+enum EActionInstancingPolicy
+{
+	/* One object per granting actor, created when granted */
+	InstancedPerActor		UMETA(DisplayName="Instanced Per Actor"),
+	/* A new object for every activation, released when it stops. Granting costs no object; clients run the server's instance */
+	InstancedPerExecution	UMETA(DisplayName="Instanced Per Execution"),
+	/* Runs on the class default object with per-actor state kept on the component. Must not store state or run tasks */
+	NonInstanced			UMETA(DisplayName="Non Instanced")
+};
+
+/* Designer data of an action class. Authored on the class's sparse data, or read from a UActionDefinition
+ * asset, and shared by every instance so runtime lookups never touch per-actor objects */
+USTRUCT(BlueprintType)
+struct FActionDefinition
+{
+	GENERATED_BODY()
+
+public:
+
+	/* Tag Identifier for this action */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Tags", meta=(Categories="Action"))
+	FGameplayTag ActionTag;
+
+	/* Tags added to owning actor when activated, removed when action stops */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Tags", meta=(Categories="State"))
+	FGameplayTagContainer GrantsTags;
+
+	/* Action can only start if OwningActor has none of these Tags applied */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Tags", meta=(Categories="State"))
+	FGameplayTagContainer BlockedTags;
+
+	/* Cancels Running actions with this tag */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Tags")
+	FGameplayTagContainer CancelTags;
+
+	/* Action nickname to start/stop without a reference to the object */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Action")
+	FName ActionName;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Cooldown")
+	float Cooldown = 0.0f;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Cooldown")
+	TEnumAsByte<ECooldownMethod> CooldownPolicy = ECooldownMethod::NoCooldown;
+
+	/* Opt-in shared cooldown: actions with the same cooldown tag share one cooldown on the owning component.
+	 * When unset the action keeps its own cooldown */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Cooldown")
+	FGameplayTag CooldownTag;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Cost", meta=(TitleProperty="Stat"))
+	TArray<FActionStatCost> Costs;
+
+	/* How granting and starting this action creates objects */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Action")
+	TEnumAsByte<EActionInstancingPolicy> InstancingPolicy = EActionInstancingPolicy::InstancedPerActor;
+
+	/* Higher first in UActionComponent::GetActionsByPriority. Can be overridden per actor with SetActionPriority */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Action")
+	int32 Priority = 0;
+
+	/* Start immediately when added to an action component */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Action")
+	bool bAutoStart = false;
+
+	/* Starts that fail because this is already running or tag blocked are queued on the owning component and retried
+	 * once, on the first stop or tag removal within ActionQueueWindow. The failure is reported only for the original start */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Action")
+	bool bUsesQueue = false;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Action")
+	bool bShouldActionTick = false;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Action")
+	bool bAllowTickWhenNotRunning = false;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "UI")
+	TSoftObjectPtr<UTexture2D> Icon;
+
+	/* Montages, effects and other assets used when the action runs. Streamed in when the action is granted */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Assets")
+	TArray<TSoftObjectPtr<UObject>> AssetDependencies;
+
+	/* Classes used when the action runs, e.g. the stat effects it applies. Streamed in when the action is granted */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Assets")
+	TArray<TSoftClassPtr<UObject>> ClassDependencies;
+
+	FGameplayTag GetCooldownTag() const
+	{
+		return CooldownTag;
+	}
+
+	void GetAssetDependencies(TArray<FSoftObjectPath>& OutPaths) const
+	{
+		FActionAssetLoading::GatherPaths(AssetDependencies, ClassDependencies, OutPaths);
+		if (!Icon.IsNull())
+		{
+			OutPaths.Add(Icon.ToSoftObjectPath());
+		}
+	}
+};
+
+/* Per-class data of an action. Stored once on its class rather than on every action object */
+USTRUCT()
+struct FActionSparseClassData
+{
+	GENERATED_BODY()
+
+	/* Designer data of the class, unless DefinitionAsset is set */
+	UPROPERTY(EditDefaultsOnly, Category = "Action", meta=(ShowOnlyInnerProperties, GetByRef))
+	FActionDefinition ClassDefinition;
+
+	/* When set, replaces ClassDefinition. Either way it is read through UActionBase::GetDefinition() */
+	UPROPERTY(EditDefaultsOnly, Category = "Action")
+	UActionDefinition* DefinitionAsset = nullptr;
+};
+
 /**
  * 
  */
-UCLASS(Blueprintable)
+UCLASS(Blueprintable, SparseClassDataTypes = ActionSparseClassData)
 class UNIVERSALACTIONSYSTEM_API UActionBase : public UObject, public IGameplayTaskOwnerInterface
 {
 	GENERATED_BODY()
@@ -54,9 +209,8 @@ class UNIVERSALACTIONSYSTEM_API UActionBase : public UObject, public IGameplayTa
 
 protected:
 
-	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "UI")
-	TSoftObjectPtr<UTexture2D> Icon;
-
+	/* Owning component of an instance. Class defaults have none; GetOwningComponent returns the component a
+	 * non-instanced action is running for */
 	UPROPERTY(Replicated)
 	UActionComponent* ActionComp;
 
@@ -69,21 +223,55 @@ protected:
 	UFUNCTION(BlueprintCallable, Category = "Action")
 	ACharacter* GetOwnerAsCharacter() const;
 
-	/* Tag Identifier for this action */
-	UPROPERTY(EditDefaultsOnly, Category = "Tags", meta=(Categories="Action"))
-	FGameplayTag ActionTag;
+#if WITH_EDITORONLY_DATA
+	/* Designer properties from before they moved to FActionSparseClassData; loaded from old assets and moved over */
+	UPROPERTY()
+	UActionDefinition* DefinitionAsset_DEPRECATED = nullptr;
+	UPROPERTY()
+	FGameplayTag ActionTag_DEPRECATED;
+	UPROPERTY()
+	FGameplayTagContainer GrantsTags_DEPRECATED;
+	UPROPERTY()
+	FGameplayTagContainer BlockedTags_DEPRECATED;
+	UPROPERTY()
+	FGameplayTagContainer CancelTags_DEPRECATED;
+	UPROPERTY()
+	FName ActionName_DEPRECATED;
+	UPROPERTY()
+	float Cooldown_DEPRECATED = 0.0f;
+	UPROPERTY()
+	TEnumAsByte<ECooldownMethod> CooldownPolicy_DEPRECATED = ECooldownMethod::NoCooldown;
+	UPROPERTY()
+	FGameplayTag CooldownTag_DEPRECATED;
+	UPROPERTY()
+	TArray<FActionStatCost> Costs_DEPRECATED;
+	UPROPERTY()
+	TEnumAsByte<EActionInstancingPolicy> InstancingPolicy_DEPRECATED = EActionInstancingPolicy::InstancedPerActor;
+	UPROPERTY()
+	int32 Priority_DEPRECATED = 0;
+	UPROPERTY()
+	bool bAutoStart_DEPRECATED = false;
+	UPROPERTY()
+	bool bUsesQueue_DEPRECATED = false;
+	UPROPERTY()
+	bool bShouldActionTick_DEPRECATED = false;
+	UPROPERTY()
+	bool bAllowTickWhenNotRunning_DEPRECATED = false;
+	UPROPERTY()
+	TSoftObjectPtr<UTexture2D> Icon_DEPRECATED;
+	UPROPERTY()
+	TArray<TSoftObjectPtr<UObject>> AssetDependencies_DEPRECATED;
+	UPROPERTY()
+	TArray<TSoftClassPtr<UObject>> ClassDependencies_DEPRECATED;
+#endif
 
-	/* Tags added to owning actor when activated, removed when action stops */
-	UPROPERTY(EditDefaultsOnly, Category = "Tags", meta=(Categories="State"))
-	FGameplayTagContainer GrantsTags;
+#if WITH_EDITOR
+	virtual void MoveDataToSparseClassDataStruct() const override;
+#endif
 
-	/* Action can only start if OwningActor has none of these Tags applied */
-	UPROPERTY(EditDefaultsOnly, Category = "Tags", meta=(Categories="State"))
-	FGameplayTagContainer BlockedTags;
-	
-	/* Cancels Running actions with this tag */
-    UPROPERTY(EditDefaultsOnly, Category = "Tags")
-    FGameplayTagContainer CancelTags;
+	/* Keep the stat ActionSystem object counters */
+	virtual void PostInitProperties() override;
+	virtual void BeginDestroy() override;
 
 	UPROPERTY(ReplicatedUsing="OnRep_RepData")
 	FActionRepData RepData;
@@ -91,12 +279,6 @@ protected:
 	UPROPERTY(Replicated)
 	float TimeStarted = -1.0f;
 
-	UPROPERTY(Category="Cooldown", EditAnywhere)
-	float Cooldown = 0.0f;
-
-	UPROPERTY(Category="Cooldown", EditAnywhere)
-	TEnumAsByte<ECooldownMethod> CooldownPolicy = ECooldownMethod::NoCooldown;
-
 	UFUNCTION(BlueprintCallable, Category="Cooldown")
 	void CommitCooldown();
 
@@ -108,6 +290,17 @@ protected:
 
 	UFUNCTION(Category="Cooldown")
 	float GetTimeSinceCooldownCommit();
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category="Cost")
+	bool CanAffordCosts() const;
+
+	void CommitCosts();
+
+	/* The native CanStart checks, without going through the Blueprint event */
+	bool CheckCanStart(EFailureReason& OutFailureReason);
+
+	/* State of this action for the actor it is running for. Never the class default's own members */
+	FActionStateRef GetState();
 	
 	UFUNCTION()
 	void OnRep_RepData();
@@ -127,12 +320,6 @@ public:
 	virtual UWorld* GetWorld() const override;
 
 	// Tick Stuff
-	
-	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Action")
-	bool bShouldActionTick = false;
-
-	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Action")
-	bool bAllowTickWhenNotRunning = false;
 
 	UPROPERTY(BlueprintAssignable)
 	FOnActionStopped ActionStopped;
@@ -145,21 +332,34 @@ public:
 
 	/** True if this has been instanced, always true for blueprints */
 	bool IsInstantiated() const;
+
+	/* Designer data shared by every instance of this class */
+	const FActionDefinition& GetDefinition() const;
+
+	UFUNCTION(BlueprintPure, Category = "Action", meta=(DisplayName="Get Definition"))
+	FActionDefinition K2_GetDefinition() const;
+
+	/* Soft references to stream in when this action is granted. Override to add assets computed in code */
+	virtual void GetAssetDependencies(TArray<FSoftObjectPath>& OutPaths) const;
+
+	/* True if granting this action shares the class default object instead of creating an instance */
+	bool IsGrantedAsClassDefault() const;
 	
 	void Initialize(UActionComponent* NewActionComp);
 
+	/* Clears the runtime state of this object before the action pool reuses it. Override to clear native state a
+	 * subclass adds, such as timers or external bindings; Blueprint variables are reset in OnActionReset */
+	virtual void ResetAction();
+
+	/* Called when the action pool resets this object for reuse */
+	UFUNCTION(BlueprintImplementableEvent, Category = "Action")
+	void OnActionReset();
+
 	/** List of currently active tasks, do not modify directly */
 	UPROPERTY()
 	TArray<UGameplayTask*>	ActiveTasks;
 
-	/* Start immediately when added to an action component */
-	UPROPERTY(EditDefaultsOnly, Category = "Action")
-	bool bAutoStart;
-
-	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Action")
-	bool bUsesQueue = false;
-
-	/* Start immediately when added to an action component */
+	/* Set while the input that started this action is held */
 	UPROPERTY(BlueprintReadOnly, Category = "Action")
 	bool bInputPressed;
 
@@ -217,19 +417,24 @@ public:
 	UFUNCTION(BlueprintImplementableEvent, BlueprintCallable, Category = "Action")
 	void OnInputPressed();
 
-	/* Action nickname to start/stop without a reference to the object */
-	UPROPERTY(EditDefaultsOnly, Category = "Action")
-	FName ActionName;
-
 
 	// Cooldown Functions
 
 	UFUNCTION(BlueprintCallable, Category = "Action|Cooldown")
 	float GetCooldownTimeRemaining();
 
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Action|Cooldown")
+	FGameplayTag GetCooldownTag() const;
+
 	bool IsSupportedForNetworking() const override
 	{
 		return true;
 	}
+
+	/* Class defaults of non-instanced actions are referenced by path in the granted actions list */
+	bool IsNameStableForNetworking() const override
+	{
+		return !IsInstantiated() || Super::IsNameStableForNetworking();
+	}
 };
 
@@ -6,17 +6,137 @@
 #include "GameplayTasksComponent.h"
 #include "GameplayTagContainer.h"
 #include "ActionTypes.h"
+#include "ActionBase.h"
 #include "GameplayTagAssetInterface.h"
+#include "UObject/ObjectKey.h"
 #include "ActionComponent.generated.h"
 
 class UActionBase;
 class UActionComponent;
+class UStatsComponent;
+class UActionGrantSet;
+struct FStreamableHandle;
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnActionStateChanged, UActionComponent*, OwningComp, UActionBase*, Action);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnActiveTagsChanged, FGameplayTag, ChangedTag);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnActionStartFailed, UActionBase*, Action, EFailureReason, FailureReason);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnActionFinished, bool, bWasCanceled);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnGameplayEvent, FGameplayTag, EventTag);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnActionsGrantChanged, UActionComponent*, OwningComp, const TArray<UActionBase*>&, Actions);
+
+UENUM()
+enum class EQueuedActionStartMethod : uint8
+{
+	ByTag,
+	ByClass,
+	WithInfo,
+	// the queued action itself, for starts by handle
+	ByAction
+};
+
+/* A start request buffered for an action with bUsesQueue */
+USTRUCT()
+struct FQueuedActionRequest
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	UActionBase* Action = nullptr;
+
+	UPROPERTY()
+	EQueuedActionStartMethod Method = EQueuedActionStartMethod::ByTag;
+
+	UPROPERTY()
+	float ExpireTime = 0.0f;
+
+	UPROPERTY()
+	bool bSetInputPressed = false;
+
+	UPROPERTY()
+	FActionActivationInfo ActivationInfo;
+};
+
+/* Bookkeeping the component keeps for each granted action */
+USTRUCT()
+struct FGrantedActionRecord
+{
+	GENERATED_BODY()
+
+	/* Granted actions whose ActionTag is in this action's CancelTags */
+	UPROPERTY()
+	TArray<UActionBase*> CancelTargets;
+
+	/* Granted actions that have this action in their CancelTargets */
+	UPROPERTY()
+	TArray<UActionBase*> CancelSources;
+
+	/* Running instance of an InstancedPerExecution action */
+	UPROPERTY()
+	UActionBase* ExecutionInstance = nullptr;
+
+	/* This actor's state for a NonInstanced action */
+	UPROPERTY()
+	FActionExecutionState SharedState;
+
+	/* CanStart may be overridden, by Blueprint or a native subclass, so starts go through the Blueprint event */
+	bool bHasCustomCanStart = true;
+
+	/* Slot in the component's slot map */
+	int32 SlotIndex = INDEX_NONE;
+
+	/* Keeps the action's asset dependencies loaded while it is granted. May be shared by a batch of grants */
+	TSharedPtr<FStreamableHandle> AssetHandle;
+
+	/* Assets of the stat effect classes among those dependencies, requested once the classes are loaded */
+	TSharedPtr<FStreamableHandle> EffectAssetHandle;
+};
+
+/* One entry of the slot map behind FActionHandle */
+USTRUCT()
+struct FActionSlot
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	UActionBase* Action = nullptr;
+
+	/* Bumped when the slot is freed so handles to the previous action stop resolving */
+	int32 Generation = 0;
+
+	/* Position of Action in the component's Actions array */
+	int32 DenseIndex = INDEX_NONE;
+
+	int32 Priority = 0;
+};
+
+/* Running state of a granted NonInstanced action, which has no object of its own to replicate it */
+USTRUCT()
+struct FNonInstancedActionState
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	UActionBase* Action = nullptr;
+
+	UPROPERTY()
+	FActionRepData RepData;
+};
+
+enum class EPendingActionEventType : uint8
+{
+	Started,
+	Stopped,
+	Failed
+};
+
+/* An action event held back until the outermost action transaction closes */
+struct FPendingActionEvent
+{
+	EPendingActionEventType Type;
+	TWeakObjectPtr<UActionBase> Action;
+	bool bWasCanceled = false;
+	EFailureReason FailureReason = EFailureReason::AlreadyRunning;
+};
 
 UCLASS( ClassGroup=(ActionSystem), meta=(BlueprintSpawnableComponent) )
 class UNIVERSALACTIONSYSTEM_API UActionComponent : public UGameplayTasksComponent, public IGameplayTagAssetInterface
@@ -28,13 +148,26 @@ public:
 	// Sets default values for this component's properties
 	UActionComponent(const FObjectInitializer& ObjectInitializer);
 
-	UPROPERTY(Replicated, EditAnywhere, BlueprintReadWrite, Category = "Tags")
+	UPROPERTY(ReplicatedUsing="OnRep_ActiveGameplayTags", EditAnywhere, BlueprintReadWrite, Category = "Tags")
 	FGameplayTagContainer ActiveGameplayTags;
 
 	/* Granted abilities at game start */
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Actions")
 	TArray<TSubclassOf<UActionBase>> DefaultActions;
 
+	/* Register DefaultActions as class entries and grant each one the first time it is looked up or started.
+	 * Actions with bAutoStart or bAllowTickWhenNotRunning are still granted at BeginPlay. Avoid for actions that
+	 * set themselves up in OnActionAdded, and note that GetActionsArray only lists actions granted so far */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Actions")
+	bool bLazyDefaultActions = false;
+
+	/* How long, in seconds, a queued start request for an action with bUsesQueue stays valid */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Actions")
+	float ActionQueueWindow = 0.3f;
+
+	UFUNCTION(BlueprintCallable, Category = "Actions")
+	void ClearActionQueue();
+
 	// TICK STUFF
 
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Actions")
@@ -47,19 +180,85 @@ public:
 	bool StartActionWithInfo(FGameplayTag ActionTag, FActionActivationInfo ActivationInfo);
 
 	/** Useful for ai prioritising actions. Dangerous in multiplayer! **/
-	UFUNCTION(BlueprintCallable, Category = "Actions")
+	UFUNCTION(BlueprintCallable, Category = "Actions", meta=(DeprecatedFunction, DeprecationMessage="Actions array order is not stable. Use SetActionPriority and GetActionsByPriority"))
 	bool SwapActionIndices(int IndexFrom = 0, int IndexTo = 0);
 	
-	/** Useful for ai prioritising actions. Dangerous in multiplayer! **/
+	/** Useful for ai prioritising actions. Dangerous in multiplayer! Non-instanced and per-execution actions appear as their class defaults **/
     UFUNCTION(BlueprintCallable, Category = "Actions", BlueprintPure)
     TArray<UActionBase*> GetActionsArray() const;
+
+	/* Running state of a granted action. Unlike UActionBase::IsRunning this also works for non-instanced and per-execution actions */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Actions")
+	bool IsActionRunning(const UActionBase* Action) const;
 	
 	UFUNCTION(BlueprintCallable, Category = "Actions")
-	void AddAction(AActor* Instigator, TSubclassOf<UActionBase> ActionClass);
+	FActionHandle AddAction(AActor* Instigator, TSubclassOf<UActionBase> ActionClass);
+
+	/* Grants every class in one transaction: storage is reserved once, Actions is marked dirty once
+	 * and OnActionsAdded fires once. Handles are in the same order as ActionClasses */
+	UFUNCTION(BlueprintCallable, Category = "Actions")
+	TArray<FActionHandle> AddActions(AActor* Instigator, const TArray<TSubclassOf<UActionBase>>& ActionClasses);
+
+	/* Removes the first granted action of each class in one transaction; OnActionsRemoved fires once */
+	UFUNCTION(BlueprintCallable, Category = "Actions")
+	void RemoveActions(const TArray<TSubclassOf<UActionBase>>& ActionClasses);
+
+	UFUNCTION(BlueprintCallable, Category = "Actions")
+	TArray<FActionHandle> GrantActionSet(AActor* Instigator, UActionGrantSet* GrantSet);
+
+	UFUNCTION(BlueprintCallable, Category = "Actions")
+	void RemoveActionSet(UActionGrantSet* GrantSet);
+
+	/* Streams in the asset dependencies of every action in the set as one bundle, e.g. while a loadout is picked.
+	 * They stay loaded for this component until ReleaseActionSetAssets, or until it ends play */
+	UFUNCTION(BlueprintCallable, Category = "Actions")
+	void PreloadActionSetAssets(UActionGrantSet* GrantSet);
 
 	UFUNCTION(BlueprintCallable, Category = "Actions")
+	void ReleaseActionSetAssets(UActionGrantSet* GrantSet);
+
+	/* True once the asset dependencies requested when Action was granted have finished streaming in */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Actions")
+	bool AreActionAssetsLoaded(UActionBase* Action) const;
+
+	UFUNCTION(BlueprintCallable, Category = "Actions", meta=(DeprecatedFunction, DeprecationMessage="Actions array order is not stable. Use AddAction and SetActionPriority"))
 	void AddActionAtIndex(TSubclassOf<UActionBase> ActionClass, int Index);
 
+	// Handles
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Actions|Handle")
+	bool IsActionHandleValid(FActionHandle Handle) const;
+
+	/* The granted action, or nullptr if it has been removed */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Actions|Handle")
+	UActionBase* GetActionFromHandle(FActionHandle Handle) const;
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Actions|Handle")
+	FActionHandle GetActionHandle(UActionBase* Action) const;
+
+	UFUNCTION(BlueprintCallable, Category = "Actions|Handle")
+	void RemoveActionByHandle(FActionHandle Handle);
+
+	UFUNCTION(BlueprintCallable, Category = "Actions|Handle")
+	bool StartActionByHandle(FActionHandle Handle, bool SetInputPressed = true);
+
+	UFUNCTION(BlueprintCallable, Category = "Actions|Handle")
+	bool StopActionByHandle(FActionHandle Handle, bool SetInputReleased = false);
+
+	UFUNCTION(BlueprintCallable, Category = "Actions|Handle")
+	bool CancelActionByHandle(FActionHandle Handle);
+
+	/* Overrides the action's Priority for this component. Not replicated */
+	UFUNCTION(BlueprintCallable, Category = "Actions|Handle")
+	void SetActionPriority(FActionHandle Handle, int32 NewPriority);
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Actions|Handle")
+	int32 GetActionPriority(FActionHandle Handle) const;
+
+	/* Granted actions, highest priority first; ties keep the order they were granted in */
+	UFUNCTION(BlueprintCallable, Category = "Actions")
+	TArray<UActionBase*> GetActionsByPriority();
+
 	UFUNCTION(BlueprintCallable, Category = "Actions")
 	void RemoveAllActions();
 
@@ -72,9 +271,23 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Actions")
 	UActionBase* GetActionByName(FName ActionName);
 
-	/* Returns first occurrence of action matching the class provided */
+	/* Returns first occurrence of action matching the class provided, granting a matching lazy default action on the server */
 	UFUNCTION(BlueprintCallable, Category = "Actions")
-	UActionBase* GetActionByClass(TSubclassOf<UActionBase> ActionClass) const;
+	UActionBase* GetActionByClass(TSubclassOf<UActionBase> ActionClass);
+
+	// Find* only look at actions already granted and never grant lazy default actions
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Actions")
+	UActionBase* FindActionByClass(TSubclassOf<UActionBase> ActionClass) const;
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Actions")
+	UActionBase* FindActionByTag(FGameplayTag Tag) const;
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Actions")
+	UActionBase* FindActionByName(FName ActionName) const;
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Actions")
+	TArray<UActionBase*> FindActionsWithTags(FGameplayTagContainer Tags) const;
 
 	UFUNCTION(BlueprintCallable, Category = "Actions")
 	bool StartActionByClass(TSubclassOf<UActionBase> ActionClass, bool SetInputPressed = true);
@@ -109,6 +322,23 @@ public:
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Action")
 	bool GetActionsInhibited();
 
+	/* Checks every granted action in one pass. Bit i is set when GetActionsArray()[i] could start right now.
+	 * Cached until tags, cooldowns, stats, running actions or granted actions change */
+	const TBitArray<>& EvaluateStartableActions();
+
+	/* Blueprint view of EvaluateStartableActions, in GetActionsArray order */
+	UFUNCTION(BlueprintCallable, Category = "Actions")
+	TArray<bool> GetStartableActions();
+
+	UFUNCTION(BlueprintCallable, Category = "Actions")
+	bool IsActionStartable(UActionBase* Action);
+
+	/* Forces the next EvaluateStartableActions to re-check. Call when a Blueprint CanStart depends on other state */
+	UFUNCTION(BlueprintCallable, Category = "Actions")
+	void InvalidateStartableActions();
+
+	UStatsComponent* GetOwnerStatsComponent() const;
+
 
 	
 
@@ -140,6 +370,34 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Actions")
 	void RemoveActiveTags(FGameplayTagContainer TagsToRemove);
 
+
+	// Cooldown Stuff
+
+	/* Starts (or restarts) the cooldown shared by every action using CooldownTag */
+	UFUNCTION(BlueprintCallable, Category = "Actions|Cooldown")
+	void CommitCooldown(FGameplayTag CooldownTag, float Duration);
+
+	UFUNCTION(BlueprintCallable, Category = "Actions|Cooldown")
+	void ClearCooldown(FGameplayTag CooldownTag);
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Actions|Cooldown")
+	bool IsCooldownActive(FGameplayTag CooldownTag) const;
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Actions|Cooldown")
+	float GetCooldownTimeRemainingByTag(FGameplayTag CooldownTag) const;
+
+	/* Remaining fraction (1 = just committed, 0 = ready) of every active cooldown, keyed by cooldown tag. Cooldowns of
+	 * actions without a cooldown tag are keyed by action class in OutActionClassFractions. Meant for hotbars */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Actions|Cooldown")
+	TMap<FGameplayTag, float> GetAllCooldownFractions(TMap<TSubclassOf<UActionBase>, float>& OutActionClassFractions) const;
+
+	/* Remaining fraction for each of the given cooldown tags, in the same order */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Actions|Cooldown")
+	TArray<float> GetCooldownFractions(const TArray<FGameplayTag>& CooldownTags) const;
+
+	/* Server synchronised clock used for cooldown end times */
+	float GetCooldownClockTime() const;
+
 	
 
 	// Implement Custom Tags interface
@@ -156,6 +414,18 @@ public:
 	UFUNCTION(Category="Action System | GameplayTags", BlueprintCallable)
 	virtual bool HasAnyMatchingGameplayTags(const FGameplayTagContainer& TagContainer) const override;
 
+	// Transactions
+
+	/* While a transaction is open, tag, action started/stopped/failed and replication notifications are held back
+	 * and flushed once when the outermost transaction ends. Prefer FScopedActionTransaction */
+	void BeginActionTransaction();
+	void EndActionTransaction();
+	bool IsInActionTransaction() const;
+
+	void NotifyActionStarted(UActionBase* Action);
+	void NotifyActionStopped(UActionBase* Action, bool bWasCanceled);
+	void NotifyActionFailed(UActionBase* Action, EFailureReason FailureReason);
+
 	/** Returns avatar actor to be used for a specific task, normally GetAvatarActor */
 	virtual AActor* GetGameplayTaskAvatar(const UGameplayTask* Task) const override;
 	
@@ -178,21 +448,236 @@ protected:
 	UFUNCTION(Server, Reliable)
 	void ServerCancelAction(FGameplayTag ActionTag);
 
-	UPROPERTY(BlueprintReadOnly, Replicated)
+	UFUNCTION(Server, Reliable)
+	void ServerStopActionByClass(TSubclassOf<UActionBase> ActionClass);
+
+	UFUNCTION(Server, Reliable)
+	void ServerCancelActionByClass(TSubclassOf<UActionBase> ActionClass);
+
+	/* Handle starts and stops name the granted action itself; slot indices differ between client and server */
+	UFUNCTION(Server, Reliable)
+	void ServerStartGrantedAction(UActionBase* Action, bool SetInputPressed);
+
+	UFUNCTION(Server, Reliable)
+	void ServerStopGrantedAction(UActionBase* Action, bool bCancel);
+
+	/* Starts this granted action and no other, forwarding the start to the server on clients */
+	bool TryStartGrantedAction(UActionBase* Action, bool SetInputPressed);
+
+	/* Stops or cancels this granted action if it is running, forwarding the stop to the server on clients */
+	bool TryStopGrantedAction(UActionBase* Action, bool SetInputReleased, bool bCancel);
+
+	UPROPERTY(BlueprintReadOnly, ReplicatedUsing="OnRep_Actions")
 	TArray<UActionBase*> Actions;
 
+	UFUNCTION()
+	void OnRep_Actions();
+
+	/* Definitions of Actions, index for index, so lookups by tag or name scan shared class data instead of each object */
+	TArray<const FActionDefinition*> ActionDefinitions;
+
+	/* Slot of each entry in Actions, index for index. Removal swaps the last entry into the gap in all three arrays */
+	TArray<int32> ActionSlotIndices;
+
+	UPROPERTY()
+	TArray<FActionSlot> ActionSlots;
+
+	TArray<int32> FreeActionSlots;
+
+	int32 AllocateActionSlot(UActionBase* Action, int32 DenseIndex);
+	void FreeActionSlot(int32 SlotIndex);
+	const FActionSlot* FindActionSlot(FActionHandle Handle) const;
+
+	/* Points the slots of Actions[FirstIndex..] back at their dense index after an insert or swap */
+	void UpdateDenseIndices(int32 FirstIndex, int32 LastIndex = MAX_int32);
+
+	TArray<UActionBase*> PrioritySortedActions;
+	bool bPriorityOrderDirty = true;
+
+	UPROPERTY()
+	TMap<UActionBase*, FGrantedActionRecord> ActionRecords;
+
+	/* Running state of granted NonInstanced actions, so the owner and simulated proxies start and stop them too */
+	UPROPERTY(ReplicatedUsing="OnRep_NonInstancedStates")
+	TArray<FNonInstancedActionState> NonInstancedStates;
+
+	UFUNCTION()
+	void OnRep_NonInstancedStates();
+
+	/* Starts or stops NonInstanced actions whose local state differs from the replicated one, clients only */
+	void ApplyNonInstancedStates();
+
+	/* Live InstancedPerExecution objects, replicated as subobjects until they stop */
+	UPROPERTY(ReplicatedUsing="OnRep_ExecutionInstances")
+	TArray<UActionBase*> ExecutionInstances;
+
+	UFUNCTION()
+	void OnRep_ExecutionInstances(const TArray<UActionBase*>& PreviousInstances);
+
+	/* Default actions registered with bLazyDefaultActions that have not been granted yet. Replicated to the owner
+	 * so its starts can be forwarded to the server, which grants them */
+	UPROPERTY(Replicated)
+	TArray<TSubclassOf<UActionBase>> LazyActionClasses;
+
+	/* Index into LazyActionClasses of the first entry matching, or INDEX_NONE */
+	int32 FindLazyActionByClass(TSubclassOf<UActionBase> ActionClass) const;
+	int32 FindLazyActionByTag(FGameplayTag Tag) const;
+	int32 FindLazyActionByName(FName ActionName) const;
+
+	/* Grants a lazy default action and drops its entry. Server only; returns null on clients */
+	UActionBase* GrantLazyAction(int32 LazyIndex);
+
+	/* Creates the instance for ActionClass, or grants its class default, depending on its instancing policy */
+	FActionHandle GrantAction(TSubclassOf<UActionBase> ActionClass, int32 Index, AActor* Instigator, bool bRequestAssets = true);
+
+	/* Streams in the asset dependencies of GrantedActions as one request shared by their records, followed by the
+	 * assets of the stat effect classes among them */
+	void RequestActionAssets(TArrayView<UActionBase* const> GrantedActions);
+
+	/* Handles from PreloadActionSetAssets, by grant set */
+	TMap<FObjectKey, TSharedPtr<FStreamableHandle>> PreloadedActionSets;
+
+	/* Takes an action object from the world's action pool, or creates one */
+	UActionBase* CreateActionObject(TSubclassOf<UActionBase> ActionClass);
+
+	/* Hands an action object back to the world's action pool once the current transaction has closed */
+	void ReleaseActionObject(UActionBase* Action);
+
+	UPROPERTY()
+	TArray<UActionBase*> PendingPoolReleases;
+
+	/* Maps a per-execution instance back to the class default that was granted; returns anything else unchanged */
+	UActionBase* GetGrantedAction(UActionBase* Action) const;
+
+	/* Calls Func on the object that executes a granted action for this component: the instance, the running
+	 * per-execution instance, or the class default with this component's state loaded. False if there is none */
+	bool ExecuteOnAction(UActionBase* Action, TFunctionRef<void(UActionBase*)> Func);
+
+	bool CanStartGrantedAction(UActionBase* Action, AActor* Instigator);
+	void StartGrantedAction(UActionBase* Action, bool bSetInputPressed, const FActionActivationInfo* ActivationInfo = nullptr);
+	void StopGrantedAction(UActionBase* Action, bool bCancel);
+
+	/* Actions currently running, in the order they started */
+	UPROPERTY()
+	TArray<UActionBase*> RunningActions;
+
+	void SetActionRunning(UActionBase* Action, bool bRunning);
+
+	/* Connects a newly granted action to the actions it cancels and the actions that cancel it */
+	void LinkCancelGraph(UActionBase* NewAction);
+	void UnlinkCancelGraph(UActionBase* OldAction);
+
+	/* Brings records, slots, definitions and the cancel graph in line with a replicated Actions array */
+	void SyncReplicatedActions();
+
+	/* Cancels the running actions in Action's CancelTargets */
+	bool CancelActionTargets(UActionBase* Action);
+
+	void CancelRunningActions(TArrayView<UActionBase* const> ActionsToCancel);
+
 	UPROPERTY(BlueprintReadOnly, Replicated)
 	TArray<UActionBase*> TickedActions;
 
+	UPROPERTY(ReplicatedUsing="OnRep_Cooldowns")
+	TArray<FActionCooldown> Cooldowns;
+
+	UFUNCTION()
+	void OnRep_Cooldowns();
+
+	UFUNCTION()
+	void OnRep_ActiveGameplayTags();
+
+	UPROPERTY()
+	UStatsComponent* OwnerStatsComponent;
+
+	UFUNCTION()
+	void OnOwnerStatChanged(FGameplayTag Stat, float NewValue, float OldValue);
+
+	/* Modifier totals and replicated stats change without OnStatChanged; costs read both */
+	void OnOwnerStatValuesUpdated(UStatsComponent* StatsComponent);
+
+	TBitArray<> StartableActions;
+	bool bStartableActionsDirty = true;
+
+	/* World time at which a cooldown seen by the last evaluation runs out */
+	float StartableActionsExpireTime = 0.0f;
+
+	int32 TransactionDepth = 0;
+	bool bTransactionTagsChanged = false;
+	bool bPendingActionsDirty = false;
+	bool bPendingCooldownsDirty = false;
+
+	/* Active tags when the first tag changed in the current transaction, used to broadcast only the net difference */
+	FGameplayTagContainer TransactionStartTags;
+
+	TArray<FPendingActionEvent> PendingActionEvents;
+
+	/* Net actions granted and removed in the current transaction, broadcast as one batch each */
+	TArray<UActionBase*> PendingAddedActions;
+	TArray<UActionBase*> PendingRemovedActions;
+
+	void NotifyActionAdded(UActionBase* Action);
+	void NotifyActionRemoved(UActionBase* Action);
+
+	/* Returns true if tag broadcasts should wait for the end of the current transaction */
+	bool DeferTagNotifications();
+
+	void MarkActionsDirty();
+	void MarkCooldownsDirty();
+
+#if STATS
+	/* What this component last added to the stat ActionSystem counters */
+	int32 AccountedGrantedActions = 0;
+	SIZE_T AccountedStorageBytes = 0;
+#endif
+
+	/* Brings this component's share of the granted action and storage counters up to date; bRelease removes it */
+	void UpdateStorageStats(bool bRelease = false);
+	void FlushActionTransaction();
+
+	const FActionCooldown* FindActiveCooldown(FGameplayTag CooldownTag, const UClass* ActionClass = nullptr) const;
+
+	/* Starts the action's cooldown: the one shared under its CooldownTag, or its own, keyed by class, without one */
+	void CommitActionCooldown(const UActionBase* Action, float Duration);
+	const FActionCooldown* FindActiveActionCooldown(const UActionBase* Action) const;
+
+	void CommitCooldownEntry(FGameplayTag CooldownTag, const UClass* ActionClass, float Duration);
+
+	UPROPERTY()
+	TArray<FQueuedActionRequest> ActionQueue;
+
+	bool bActionQueueScheduled = false;
+
+	/* Action currently being retried from the queue, so a failed retry does not report itself again; ProcessActionQueue keeps it queued */
+	UActionBase* RetryingQueuedAction = nullptr;
+
+	/* Why the last CanStartGrantedAction call failed */
+	EFailureReason LastStartFailureReason = EFailureReason::AlreadyRunning;
+
+	bool TryQueueAction(UActionBase* Action, EQueuedActionStartMethod Method, bool bSetInputPressed = false, const FActionActivationInfo& ActivationInfo = FActionActivationInfo());
+
+	/* Called when an action stops or tags are removed; retries queued requests on the next tick */
+	void ScheduleActionQueue();
+
+	void ProcessActionQueue();
+
 	virtual void BeginPlay() override;
 
 	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
-	UActionBase* FindActionByClass(TSubclassOf<UActionBase> ActionClass);
-	UActionBase* FindActionByTag(FGameplayTag Tag);
+	friend class UActionBase;
+	friend struct FNonInstancedActionScope;
 
 public:	
 
+	/* Fires once per transaction with every action granted in it, server only */
+	UPROPERTY(BlueprintAssignable)
+	FOnActionsGrantChanged OnActionsAdded;
+
+	/* Fires once per transaction with every action removed in it, server only */
+	UPROPERTY(BlueprintAssignable)
+	FOnActionsGrantChanged OnActionsRemoved;
+
 	UPROPERTY(BlueprintAssignable)
 	FOnActionStateChanged OnActionStarted;
 
@@ -223,3 +708,57 @@ public:
 
 		
 };
+
+/* Opens an action transaction on the component for the lifetime of the scope */
+struct UNIVERSALACTIONSYSTEM_API FScopedActionTransaction
+{
+	explicit FScopedActionTransaction(UActionComponent* InComponent)
+		: Component(InComponent)
+	{
+		if (Component)
+		{
+			Component->BeginActionTransaction();
+		}
+	}
+
+	~FScopedActionTransaction()
+	{
+		if (Component)
+		{
+			Component->EndActionTransaction();
+		}
+	}
+
+	FScopedActionTransaction(const FScopedActionTransaction&) = delete;
+	FScopedActionTransaction& operator=(const FScopedActionTransaction&) = delete;
+
+private:
+	UActionComponent* Component;
+};
+
+/* Runs a non-instanced action for one component. The class default is never written to; while the scope is open
+ * the action finds its owning component and its state in that component's record through FindComponent and FindState.
+ * Scopes nest, the innermost one for an action wins. Does nothing for instances */
+struct UNIVERSALACTIONSYSTEM_API FNonInstancedActionScope
+{
+	FNonInstancedActionScope(UActionBase* InAction, UActionComponent* InComponent);
+	~FNonInstancedActionScope();
+
+	FNonInstancedActionScope(const FNonInstancedActionScope&) = delete;
+	FNonInstancedActionScope& operator=(const FNonInstancedActionScope&) = delete;
+
+	/* Component the action is running for, or null outside of a scope */
+	static UActionComponent* FindComponent(const UActionBase* InAction);
+
+	/* That component's state for the action, or null outside of a scope */
+	static FActionExecutionState* FindState(const UActionBase* InAction);
+
+private:
+	static const FNonInstancedActionScope* FindScope(const UActionBase* InAction);
+
+	/* Open scopes, innermost last. Game thread only */
+	static TArray<const FNonInstancedActionScope*> ActiveScopes;
+
+	UActionBase* Action = nullptr;
+	UActionComponent* Component = nullptr;
+};
@@ -0,0 +1,23 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "ActionBase.h"
+#include "ActionDefinition.generated.h"
+
+/**
+ * Designer data for an action, authored outside the action's Blueprint class.
+ * Assign it to the action's DefinitionAsset; every actor granted that class shares it.
+ */
+UCLASS(BlueprintType)
+class UNIVERSALACTIONSYSTEM_API UActionDefinition : public UPrimaryDataAsset
+{
+	GENERATED_BODY()
+
+public:
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Action", meta=(ShowOnlyInnerProperties))
+	FActionDefinition Definition;
+};
@@ -0,0 +1,30 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "ActionGrantSet.generated.h"
+
+class UActionBase;
+
+/**
+ * A list of actions granted and revoked together, e.g. an equipment loadout.
+ * Pass it to UActionComponent::GrantActionSet / RemoveActionSet.
+ */
+UCLASS(BlueprintType)
+class UNIVERSALACTIONSYSTEM_API UActionGrantSet : public UPrimaryDataAsset
+{
+	GENERATED_BODY()
+
+public:
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Actions")
+	TArray<TSubclassOf<UActionBase>> Actions;
+
+	/* True when every asset dependency of the set is in memory. Preload them with UActionComponent::PreloadActionSetAssets */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Actions")
+	bool AreAssetsLoaded() const;
+
+	void GetAssetDependencies(TArray<FSoftObjectPath>& OutPaths) const;
+};
@@ -0,0 +1,83 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ActionPoolSubsystem.generated.h"
+
+class UActionBase;
+
+USTRUCT(BlueprintType)
+struct FActionPoolStats
+{
+	GENERATED_BODY()
+
+	/* Objects requested from the pool */
+	UPROPERTY(BlueprintReadOnly, Category = "Actions|Pool")
+	int32 Acquires = 0;
+
+	/* Requests served by a pooled object instead of NewObject */
+	UPROPERTY(BlueprintReadOnly, Category = "Actions|Pool")
+	int32 Hits = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Actions|Pool")
+	int32 Releases = 0;
+
+	/* Released objects left to the garbage collector because their class was already at capacity */
+	UPROPERTY(BlueprintReadOnly, Category = "Actions|Pool")
+	int32 Discards = 0;
+};
+
+USTRUCT()
+struct FActionPoolBucket
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<UActionBase*> FreeActions;
+};
+
+/**
+ * Per-world pool of action objects keyed by class. Removed and finished per-execution actions are reset and kept
+ * here, so the next grant of the same class reuses them instead of creating a new object.
+ */
+UCLASS()
+class UNIVERSALACTIONSYSTEM_API UActionPoolSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	/* Returns a reset action of ActionClass outered to Outer, or nullptr if none is pooled.
+	 * Objects from other outers are only reused in standalone games, where nothing has replicated them */
+	UActionBase* AcquireAction(TSubclassOf<UActionBase> ActionClass, UObject* Outer);
+
+	/* Resets Action and keeps it for reuse */
+	void ReleaseAction(UActionBase* Action);
+
+	/* Drops pooled actions outered to Outer so they do not keep it alive */
+	void DiscardActionsOwnedBy(UObject* Outer);
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Actions|Pool")
+	FActionPoolStats GetStats() const;
+
+	/* Fraction of acquires served from the pool */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Actions|Pool")
+	float GetHitRate() const;
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Actions|Pool")
+	int32 GetPooledCount() const;
+
+	/* Serialized size of every pooled object. Walks the whole pool, so not for per-frame use */
+	int64 GetPooledMemoryBytes() const;
+
+	virtual void Deinitialize() override;
+
+protected:
+
+	UPROPERTY()
+	TMap<UClass*, FActionPoolBucket> Buckets;
+
+	FActionPoolStats Stats;
+};
@@ -0,0 +1,212 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include <cstdint>
+
+/*
+ * Engine independent rules behind UStatEffect and UStatsComponent: modifier math and the stack and duration state of an
+ * applied effect. Only the standard library is included so these can be compiled and exercised outside the engine; the
+ * UObject types wrap them and keep the events, timers and replication. Tag checks are out of scope: they are gameplay
+ * tag container queries and stay with the containers.
+ */
+namespace ActionSystemCore
+{
+	/* Cast from EModifyMethod by value; StatEffect.cpp asserts the order */
+	enum class EModifyOp : uint8_t
+	{
+		Add,
+		Subtract,
+		Multiply,
+		Divide,
+	};
+
+	/* Cast from EDurationType by value; StatEffect.cpp asserts the order */
+	enum class EDurationKind : uint8_t
+	{
+		HasDuration,
+		Instant,
+		Infinite,
+		Periodic,
+	};
+
+	/* Cast from EStackChangeRespone by value; StatEffect.cpp asserts the order */
+	enum class EStackResponse : uint8_t
+	{
+		None,
+		ResetDuration,
+	};
+
+	/* Duration and stacking settings of an effect class */
+	struct FEffectSpec
+	{
+		EDurationKind DurationType = EDurationKind::HasDuration;
+		EStackResponse StackAddResponse = EStackResponse::None;
+		EStackResponse StackRemoveResponse = EStackResponse::None;
+		EStackResponse StackOverflowResponse = EStackResponse::None;
+		float Duration = 1.0f;
+		float Period = 1.0f;
+		// 0 means infinite
+		int32_t MaxStacks = 0;
+
+		/* Duration for HasDuration and Periodic effects, 0 for instant and infinite ones */
+		float GetDuration() const
+		{
+			return (DurationType == EDurationKind::HasDuration || DurationType == EDurationKind::Periodic) ? Duration : 0.0f;
+		}
+
+		/* Whether the effect counts its remaining duration down and expires */
+		bool ManagesDuration() const
+		{
+			return (GetDuration() > 0 && DurationType == EDurationKind::HasDuration) || DurationType == EDurationKind::Periodic;
+		}
+
+		bool AllowsStacking() const
+		{
+			return GetDuration() > 0 || IsInfinite();
+		}
+
+		/* Explicitly infinite, or a duration type with a zero duration */
+		bool IsInfinite() const
+		{
+			return (Duration == 0 && (DurationType == EDurationKind::HasDuration || DurationType == EDurationKind::Periodic)) || DurationType == EDurationKind::Infinite;
+		}
+
+		bool IsPeriodic() const
+		{
+			return (DurationType == EDurationKind::Periodic || DurationType == EDurationKind::Infinite) && Period > 0.0f;
+		}
+
+		/* Removable effects add to the stat's modifier total instead of changing its base value */
+		bool ShouldApplyAsMagnitude() const
+		{
+			return (DurationType == EDurationKind::Infinite || DurationType == EDurationKind::HasDuration) && !IsPeriodic();
+		}
+	};
+
+	/* What one modifier of an effect with Stacks stacks adds to a stat's modifier total. BaseValue is the stat's
+	 * base value, which Multiply and Divide scale */
+	inline float ModifierMagnitude(EModifyOp Op, float Magnitude, int32_t Stacks, float BaseValue)
+	{
+		switch (Op)
+		{
+		case EModifyOp::Add:
+			return Magnitude * Stacks;
+		case EModifyOp::Subtract:
+			return (Magnitude * -1.0f) * Stacks;
+		case EModifyOp::Multiply:
+			if (Stacks == 0)
+			{
+				return 0.0f;
+			}
+			return (BaseValue * (Magnitude / Stacks)) - BaseValue;
+		case EModifyOp::Divide:
+			if (Stacks <= 0)
+			{
+				return 0.0f;
+			}
+			return (BaseValue / (Magnitude * Stacks)) - BaseValue;
+		}
+		return 0.0f;
+	}
+
+	/* Change a one-off modifier (instant and periodic effects) makes to a stat's base value */
+	inline float BaseValueDelta(EModifyOp Op, float Magnitude, float BaseValue)
+	{
+		switch (Op)
+		{
+		case EModifyOp::Add:
+			return Magnitude;
+		case EModifyOp::Subtract:
+			return Magnitude * -1.0f;
+		case EModifyOp::Multiply:
+			return (BaseValue * Magnitude) - BaseValue;
+		case EModifyOp::Divide:
+			return (BaseValue * (1.0f / Magnitude)) - BaseValue;
+		}
+		return 0.0f;
+	}
+
+	/* Base values are capped at the stat's max value; there is no lower bound */
+	inline float ClampStatValue(float NewValue, float MaxValue)
+	{
+		return NewValue < MaxValue ? NewValue : MaxValue;
+	}
+
+	/* Stack count and remaining duration of one applied effect */
+	struct FEffectStack
+	{
+		int32_t Stacks = 1;
+		float RemainingDuration = 0.0f;
+
+		/* Restarts the duration of effects that manage one. Returns false for the others */
+		bool ResetDuration(const FEffectSpec& Spec)
+		{
+			if (Spec.ManagesDuration())
+			{
+				RemainingDuration = Spec.Duration;
+				return true;
+			}
+			return false;
+		}
+
+		/* Returns false when the effect does not manage a duration or is already at MaxStacks */
+		bool AddStack(const FEffectSpec& Spec)
+		{
+			if (!Spec.ManagesDuration())
+			{
+				return false;
+			}
+
+			if (Stacks + 1 > Spec.MaxStacks && Spec.MaxStacks != 0)
+			{
+				if (Spec.StackOverflowResponse == EStackResponse::ResetDuration)
+				{
+					RemainingDuration = Spec.Duration;
+				}
+				return false;
+			}
+
+			// a fresh stack always starts with the full duration
+			if (Spec.StackAddResponse == EStackResponse::ResetDuration || Stacks == 0)
+			{
+				RemainingDuration = Spec.Duration;
+			}
+
+			Stacks++;
+			return true;
+		}
+
+		/* Never removes the last stack; expiring the effect does that */
+		bool RemoveStack(const FEffectSpec& Spec)
+		{
+			if (Stacks - 1 <= 0)
+			{
+				return false;
+			}
+			if (Spec.StackRemoveResponse == EStackResponse::ResetDuration)
+			{
+				RemainingDuration = Spec.Duration;
+			}
+			Stacks--;
+			return true;
+		}
+
+		/* Counts Seconds off the remaining duration. Returns true once it ran out */
+		bool ConsumeDuration(float Seconds)
+		{
+			RemainingDuration -= Seconds;
+			return RemainingDuration <= 0.0f;
+		}
+
+		bool IsExpired() const
+		{
+			return Stacks <= 0 || RemainingDuration <= 0.0f;
+		}
+
+		void Clear()
+		{
+			Stacks = 0;
+		}
+	};
+}
@@ -31,5 +31,9 @@ public:
 	
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Actions")
 	static FStat GetStatFromActor(AActor* Actor, FGameplayTag Stat);
+
+	/* Effect and instigator of a recorded stat change; either is null when unknown or destroyed since */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Actions")
+	static void GetStatHistoryEntrySource(const FStatHistoryEntry& Entry, UStatEffect*& SourceEffect, AActor*& Instigator);
 	
 };
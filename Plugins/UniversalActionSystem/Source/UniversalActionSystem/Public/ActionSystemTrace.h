@@ -0,0 +1,77 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Trace/Trace.h"
+#include "GameplayTagContainer.h"
+
+#if !defined(ACTIONSYSTEM_TRACE_ENABLED)
+#if UE_TRACE_ENABLED && !UE_BUILD_SHIPPING
+#define ACTIONSYSTEM_TRACE_ENABLED 1
+#else
+#define ACTIONSYSTEM_TRACE_ENABLED 0
+#endif
+#endif
+
+class UActionBase;
+class UStatEffect;
+
+#if ACTIONSYSTEM_TRACE_ENABLED
+
+/* Enable with -trace=cpu,ActionSystem (or "Trace.Enable ActionSystem"). Tags, classes and components are sent
+ * once as spec events, on first use while tracing, and referenced by id afterwards, so per-event cost is a few integers */
+UE_TRACE_CHANNEL_EXTERN(ActionSystemChannel, UNIVERSALACTIONSYSTEM_API)
+
+struct UNIVERSALACTIONSYSTEM_API FActionSystemTrace
+{
+	static void OutputComponentSpec(const UActorComponent* Component);
+	/* Lets a later component at the same address send its own spec. Runs whether or not the channel is enabled */
+	static void ForgetComponent(const UActorComponent* Component);
+	static void OutputActionStarted(const UActorComponent* Component, const UActionBase* Action);
+	static void OutputActionStopped(const UActorComponent* Component, const UActionBase* Action, bool bWasCanceled);
+	static void OutputActionFailed(const UActorComponent* Component, const UActionBase* Action, uint8 FailureReason);
+	static void OutputTagChanged(const UActorComponent* Component, FGameplayTag Tag, bool bAdded);
+	static void OutputTagsChanged(const UActorComponent* Component, const FGameplayTagContainer& Tags, bool bAdded);
+	static void OutputEffectApplied(const UActorComponent* Component, const UStatEffect* Effect);
+	static void OutputEffectStackChanged(const UActorComponent* Component, const UStatEffect* Effect);
+	static void OutputEffectRemoved(const UActorComponent* Component, const UStatEffect* Effect);
+	static void OutputStatChanged(const UActorComponent* Component, FGameplayTag Stat, float OldValue, float NewValue);
+};
+
+#define ACTIONSYSTEM_TRACE(Call) \
+	do \
+	{ \
+		if (UE_TRACE_CHANNELEXPR_IS_ENABLED(ActionSystemChannel)) \
+		{ \
+			FActionSystemTrace::Call; \
+		} \
+	} while (0)
+
+#define TRACE_ACTION_COMPONENT_SPEC(Component) ACTIONSYSTEM_TRACE(OutputComponentSpec(Component))
+#define TRACE_ACTION_COMPONENT_ENDED(Component) FActionSystemTrace::ForgetComponent(Component)
+#define TRACE_ACTION_STARTED(Component, Action) ACTIONSYSTEM_TRACE(OutputActionStarted(Component, Action))
+#define TRACE_ACTION_STOPPED(Component, Action, bWasCanceled) ACTIONSYSTEM_TRACE(OutputActionStopped(Component, Action, bWasCanceled))
+#define TRACE_ACTION_FAILED(Component, Action, FailureReason) ACTIONSYSTEM_TRACE(OutputActionFailed(Component, Action, (uint8)(FailureReason)))
+#define TRACE_ACTION_TAG_CHANGED(Component, Tag, bAdded) ACTIONSYSTEM_TRACE(OutputTagChanged(Component, Tag, bAdded))
+#define TRACE_ACTION_TAGS_CHANGED(Component, Tags, bAdded) ACTIONSYSTEM_TRACE(OutputTagsChanged(Component, Tags, bAdded))
+#define TRACE_STAT_EFFECT_APPLIED(Component, Effect) ACTIONSYSTEM_TRACE(OutputEffectApplied(Component, Effect))
+#define TRACE_STAT_EFFECT_STACK_CHANGED(Component, Effect) ACTIONSYSTEM_TRACE(OutputEffectStackChanged(Component, Effect))
+#define TRACE_STAT_EFFECT_REMOVED(Component, Effect) ACTIONSYSTEM_TRACE(OutputEffectRemoved(Component, Effect))
+#define TRACE_STAT_CHANGED(Component, Stat, OldValue, NewValue) ACTIONSYSTEM_TRACE(OutputStatChanged(Component, Stat, OldValue, NewValue))
+
+#else
+
+#define TRACE_ACTION_COMPONENT_SPEC(Component)
+#define TRACE_ACTION_COMPONENT_ENDED(Component)
+#define TRACE_ACTION_STARTED(Component, Action)
+#define TRACE_ACTION_STOPPED(Component, Action, bWasCanceled)
+#define TRACE_ACTION_FAILED(Component, Action, FailureReason)
+#define TRACE_ACTION_TAG_CHANGED(Component, Tag, bAdded)
+#define TRACE_ACTION_TAGS_CHANGED(Component, Tags, bAdded)
+#define TRACE_STAT_EFFECT_APPLIED(Component, Effect)
+#define TRACE_STAT_EFFECT_STACK_CHANGED(Component, Effect)
+#define TRACE_STAT_EFFECT_REMOVED(Component, Effect)
+#define TRACE_STAT_CHANGED(Component, Stat, OldValue, NewValue)
+
+#endif
@@ -1,6 +1,8 @@
 ﻿#pragma once
 
 #include "CoreMinimal.h"
+#include "GameplayTagContainer.h"
+#include "Templates/SubclassOf.h"
 #include "ActionTypes.generated.h"
 
 USTRUCT(BlueprintType)
@@ -32,4 +34,81 @@ enum EFailureReason
 	TagBlocked			UMETA(DisplayName="Tag Blocked"),
 	Inhibited			UMETA(DisplayName="Actions Inhibited"),
 	Cost				UMETA(DisplayName="Cost")
-};
\ No newline at end of file
+};
+
+/* A cooldown shared by every action using the same cooldown tag. EndTime is in server world time */
+USTRUCT(BlueprintType)
+struct FActionCooldown
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly)
+	FGameplayTag CooldownTag;
+
+	/* Set instead of CooldownTag for actions without one, so their cooldown is not shared with other actions */
+	UPROPERTY(BlueprintReadOnly)
+	TSubclassOf<class UActionBase> ActionClass;
+
+	UPROPERTY(BlueprintReadOnly)
+	float EndTime = 0.0f;
+
+	UPROPERTY(BlueprintReadOnly)
+	float Duration = 0.0f;
+
+	FORCEINLINE	bool operator==(const FGameplayTag Other) const
+	{
+		return this->CooldownTag == Other && !ActionClass;
+	}
+
+	FORCEINLINE bool Matches(const FGameplayTag Tag, const UClass* Class) const
+	{
+		return CooldownTag == Tag && ActionClass == Class;
+	}
+};
+
+/* Amount of a stat an action needs to start, subtracted from the stat's base value when it does */
+USTRUCT(BlueprintType)
+struct FActionStatCost
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta=(Categories="Stat"))
+	FGameplayTag Stat;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float Amount = 0.0f;
+};
+
+/* Refers to an action granted to an action component. Safe to keep after the action is removed; it just stops resolving.
+ * Only meaningful on the machine that issued it */
+USTRUCT(BlueprintType)
+struct FActionHandle
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	int32 Index = INDEX_NONE;
+
+	UPROPERTY()
+	int32 Generation = 0;
+
+	bool IsValid() const
+	{
+		return Index != INDEX_NONE;
+	}
+
+	FORCEINLINE bool operator==(const FActionHandle& Other) const
+	{
+		return Index == Other.Index && Generation == Other.Generation;
+	}
+
+	FORCEINLINE bool operator!=(const FActionHandle& Other) const
+	{
+		return !(*this == Other);
+	}
+
+	friend uint32 GetTypeHash(const FActionHandle& Handle)
+	{
+		return HashCombine(::GetTypeHash(Handle.Index), ::GetTypeHash(Handle.Generation));
+	}
+};
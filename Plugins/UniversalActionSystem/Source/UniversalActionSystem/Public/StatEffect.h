@@ -4,10 +4,13 @@
 
 #include "CoreMinimal.h"
 #include "GameplayTagContainer.h"
+#include "ActionSystemCore.h"
+#include "StatExpression.h"
 #include "UObject/NoExportTypes.h"
 #include "StatEffect.generated.h"
 
 class UStatsComponent;
+class UCurveFloat;
 // class UStatEffect;
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnEffectRemoved, UStatEffect*, Effect);
@@ -55,6 +58,11 @@ public:
 	UPROPERTY(BlueprintReadWrite, EditAnywhere)
 	float Magnitude;
 
+	/* When set, Magnitude is computed from this formula as the effect is applied, e.g. "Source[Stat.Level] * 2".
+	 * See StatExpression.h for the syntax */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	FString MagnitudeExpression;
+
 	FORCEINLINE	bool	operator==(const FStatModifier &Other) const
 	{
 		return this->Stat == Other.Stat && this->Method == Other.Method;
@@ -76,6 +84,22 @@ public:
 	}
 };
 
+/* Modifiers of an effect class that uses its default list, shared by every application of the class.
+ * Sorted by stat; modifiers on the same stat keep their order */
+struct UNIVERSALACTIONSYSTEM_API FStatModifierTable
+{
+	TArray<FStatModifier> Modifiers;
+
+	// index of the first modifier on each stat
+	TMap<FGameplayTag, int32> FirstModifierByStat;
+
+	const FStatModifier* Find(FGameplayTag Stat) const
+	{
+		const int32* Index = FirstModifierByStat.Find(Stat);
+		return Index ? &Modifiers[*Index] : nullptr;
+	}
+};
+
 /**
  * 
  */
@@ -87,6 +111,17 @@ class UNIVERSALACTIONSYSTEM_API UStatEffect : public UObject
 public:
 
 	virtual UWorld* GetWorld() const override;
+
+	/* Keep the stat ActionSystem object counters */
+	virtual void PostInitProperties() override;
+	virtual void BeginDestroy() override;
+
+	/* Compiles the magnitude expressions of the class defaults */
+	virtual void PostLoad() override;
+
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
 	
 	/** True if this has been instanced, always true for blueprints */
 	bool IsInstantiated() const;
@@ -128,20 +163,59 @@ public:
 	int MaxStacks = 0;
 
 	UFUNCTION(BlueprintCallable, BlueprintPure)
-	float GetRemainingDuration();
+	float GetRemainingDuration() const;
 	
 	UFUNCTION(BlueprintCallable, BlueprintPure)
-	int GetCurrentStacks();
-	int CurrentStacks = 1;
+	int GetCurrentStacks() const;
 	
 	UPROPERTY(BlueprintReadWrite, EditAnywhere)
 	TArray<FStatModifier> Modifiers;
 
+	/* Assets used by the effect's events (cues, niagara...). Streamed in with the actions that list this effect
+	 * class in their ClassDependencies */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Assets")
+	TArray<TSoftObjectPtr<UObject>> AssetDependencies;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Assets")
+	TArray<TSoftClassPtr<UObject>> ClassDependencies;
+
+	virtual void GetAssetDependencies(TArray<FSoftObjectPath>& OutPaths) const;
+
+	/* Modifiers of this application. Empty when the class table is shared instead; read through GetAppliedModifiers */
 	TArray<FStatModifier> ModifiersApplied;
 
+	const TArray<FStatModifier>& GetAppliedModifiers() const
+	{
+		return SharedModifiers.IsValid() ? SharedModifiers->Modifiers : ModifiersApplied;
+	}
+
+	const FStatModifier* FindAppliedModifier(FGameplayTag Stat) const;
+
+	/* The class's modifier table when every application has the same modifiers: GetModifiers is not overridden and
+	 * no modifier has a magnitude expression. Built once on the class default object */
+	TSharedPtr<const FStatModifierTable> GetSharedModifierTable() const;
+
+	/* C++ subclasses overriding GetModifiers_Implementation must return true so their modifiers are not shared;
+	 * builds with checks ensure once per class, with no target, that an override which does not still returns Modifiers */
+	virtual bool HasDynamicModifiers() const;
+
+	/* Whether GetModifiers is overridden, in C++ or Blueprint, and so may depend on the target */
+	bool HasTargetDependentModifiers() const;
+
+	/* Drops the compiled expressions and the shared modifier table. Call on the class default object after
+	 * changing its modifiers at runtime */
+	void ResetClassModifierCaches();
+
 	UFUNCTION(BlueprintNativeEvent)
 	TArray<FStatModifier> GetModifiers(UStatsComponent* TargetStatsComponent);
 
+	/* GetModifiers, without going through the Blueprint VM when the class does not override it */
+	TArray<FStatModifier> EvaluateModifiers(UStatsComponent* TargetStatsComponent);
+
+	/* Curves magnitude expressions can read with curve(<name>, x) */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
+	TMap<FName, UCurveFloat*> MagnitudeCurves;
+
 	UFUNCTION()
 	float GetModifierMagnitudeForStat(FGameplayTag Stat);
 
@@ -166,8 +240,8 @@ public:
 	UFUNCTION(BlueprintCallable, BlueprintPure)
 	AActor* GetEffectTarget() const;
 
-	// Called by StatsComponent; initialized some values.
-	bool ApplyEffect(UStatsComponent* Component, AActor* inEffectCauser, APawn* inEffectInstigator);
+	// Called by StatsComponent; initialized some values. Modifiers replaces the GetModifiers call when given
+	bool ApplyEffect(UStatsComponent* Component, AActor* inEffectCauser, APawn* inEffectInstigator, const TArray<FStatModifier>* Modifiers = nullptr);
 
 	void RemoveEffect();
 
@@ -183,6 +257,9 @@ public:
 	float GetDuration() const;
 	bool ResetDuration();
 
+	/* Duration and stacking properties in the form the ActionSystemCore rules take */
+	ActionSystemCore::FEffectSpec GetEffectSpec() const;
+
 	UFUNCTION(BlueprintCallable, BlueprintPure)
 	AActor* GetEffectCauser() const;
 
@@ -210,7 +287,9 @@ private:
 	void OnPeriodicTick();
 	
 	void BeginTick();
-	float RemainingDuration;
+
+	/* Stack count and remaining duration, advanced by the ActionSystemCore rules */
+	ActionSystemCore::FEffectStack Stack;
 
 	FTimerHandle EffectTimerHandle;
 
@@ -220,6 +299,22 @@ private:
 
 	float CalculateModifierMagnitude(FStatModifier Modifier);
 
+	/* Replaces the magnitude of every modifier with an expression by its value for the current target and source */
+	void EvaluateMagnitudeExpressions(TArray<FStatModifier>& InOutModifiers, UStatsComponent* Target) const;
+
+	/* Compiled on the class default object the first time each expression is used, or when the class loads */
+	const FStatExpressionProgram* FindMagnitudeProgram(const FString& Expression) const;
+
+	// only filled on the class default object; failed compiles are kept as empty programs so they are reported once
+	mutable TMap<FString, FStatExpressionProgram> CompiledExpressions;
+
+	// class default object only: the shared table, and whether it was looked for yet
+	mutable TSharedPtr<const FStatModifierTable> ClassModifierTable;
+	mutable bool bClassModifierTableBuilt = false;
+
+	// set instead of ModifiersApplied when this application uses the class table
+	TSharedPtr<const FStatModifierTable> SharedModifiers;
+
 	TWeakObjectPtr<UStatsComponent> TargetComponent;
 
 	bool IsSupportedForNetworking() const override;
@@ -0,0 +1,70 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameplayTagContainer.h"
+
+class UCurveFloat;
+class UStatsComponent;
+
+/*
+ * Magnitude formulas for stat modifiers, compiled once into a small stack program and evaluated natively.
+ *
+ *   2.5 * Source[Stat.Level] + Target[Stat.Health] * 0.1
+ *   max(10, curve(LevelScaling, Source[Stat.Level]))
+ *
+ * Operands are numbers, Target[<stat>] and Source[<stat>] (current values of the effect's target and of its
+ * instigator or causer), and min(a, b), max(a, b), curve(<name>, x) where the name is a key of the effect's
+ * MagnitudeCurves. Operators are + - * / with the usual precedence, unary minus and parentheses.
+ * Expressions are evaluated once as the effect is applied; stacks scale the result like any other magnitude.
+ */
+
+enum class EStatExpressionOp : uint8
+{
+	Constant,
+	TargetStat,
+	SourceStat,
+	Add,
+	Subtract,
+	Multiply,
+	Divide,
+	Negate,
+	Min,
+	Max,
+	Curve,
+};
+
+struct FStatExpressionInstruction
+{
+	EStatExpressionOp Op;
+
+	// index into the program's Constants, Stats or Curves, depending on Op
+	int32 Operand = INDEX_NONE;
+};
+
+/* What an expression reads while it is evaluated */
+struct FStatExpressionContext
+{
+	UStatsComponent* Target = nullptr;
+	UStatsComponent* Source = nullptr;
+};
+
+struct UNIVERSALACTIONSYSTEM_API FStatExpressionProgram
+{
+	TArray<FStatExpressionInstruction> Code;
+	TArray<float> Constants;
+	TArray<FGameplayTag> Stats;
+	TArray<const UCurveFloat*> Curves;
+
+	bool IsValid() const
+	{
+		return Code.Num() > 0;
+	}
+
+	/* Compiles Expression, resolving curve names through Curves. Returns false and fills OutError when it does not parse */
+	static bool Compile(const FString& Expression, const TMap<FName, UCurveFloat*>& CurveTable, FStatExpressionProgram& OutProgram, FString& OutError);
+
+	/* Missing stats and components read as 0; a division by 0 yields 0 */
+	float Evaluate(const FStatExpressionContext& Context) const;
+};
@@ -4,16 +4,21 @@
 
 #include "CoreMinimal.h"
 #include "Components/ActorComponent.h"
+#include "Engine/DataTable.h"
 #include "GameplayTags.h"
 #include "StatEffect.h"
 #include "StatsComponent.generated.h"
 
 class UStatEffect;
+class UCurveFloat;
+class UCurveTable;
+class UNetConnection;
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FOnStatChanged, FGameplayTag, Stat, float, NewValue, float, OldValue);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnStatEffectRemoved, UStatEffect*, Effect);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnStatEffectApplied, UStatEffect*, Effect);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnStatEffectStackChange, UStatEffect*, Effect, int, Stacks);
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnStatValuesUpdated, UStatsComponent*);
 
 USTRUCT(BlueprintType)
 struct FStat
@@ -79,6 +84,136 @@ struct FStat
 };
 
 
+/* One input of a derived stat: Coefficient * Input, or Coefficient * Curve(Input) when a curve is set */
+USTRUCT(BlueprintType)
+struct FDerivedStatTerm
+{
+	GENERATED_BODY()
+
+	/* Read with modifiers applied, like GetStatCurrentValue */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta=(Categories="Stat"))
+	FGameplayTag Input;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float Coefficient = 1.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	UCurveFloat* Curve = nullptr;
+};
+
+/* Stat whose base value is Constant plus the sum of its terms, e.g. MaxHealth = Vitality * 10 + Level * 5 */
+USTRUCT(BlueprintType)
+struct FDerivedStat
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta=(Categories="Stat"))
+	FGameplayTag Stat;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float Constant = 0.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta=(TitleProperty="Input"))
+	TArray<FDerivedStatTerm> Terms;
+};
+
+/* One stat of an archetype row. Base and max value grow by the per level amounts above level 1, unless the component's
+ * StatInitCurves has a "<Row>.<Stat>" or "<Row>.<Stat>.Max" curve, which is evaluated at the level instead */
+USTRUCT(BlueprintType)
+struct FStatInitEntry
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta=(Categories="Stat"))
+	FGameplayTag Stat;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float BaseValue = 0.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float MaxValue = 0.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float BaseValuePerLevel = 0.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float MaxValuePerLevel = 0.0f;
+};
+
+/* Data table row holding the stats of one archetype */
+USTRUCT(BlueprintType)
+struct FStatInitRow : public FTableRowBase
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta=(TitleProperty="Stat"))
+	TArray<FStatInitEntry> Stats;
+};
+
+/* One recorded change of a stat's base value. Use GetStatHistoryEntrySource for the source in Blueprint */
+USTRUCT(BlueprintType)
+struct FStatHistoryEntry
+{
+	GENERATED_BODY()
+
+	/* World time of the change */
+	UPROPERTY(BlueprintReadOnly)
+	float Time = 0.0f;
+
+	UPROPERTY(BlueprintReadOnly)
+	float OldValue = 0.0f;
+
+	UPROPERTY(BlueprintReadOnly)
+	float NewValue = 0.0f;
+
+	/* Effect whose modifier made the change, if any */
+	UPROPERTY()
+	TWeakObjectPtr<UStatEffect> SourceEffect;
+
+	UPROPERTY()
+	TWeakObjectPtr<AActor> Instigator;
+};
+
+/* Fixed capacity ring buffer of the last changes of one stat */
+struct UNIVERSALACTIONSYSTEM_API FStatHistoryBuffer
+{
+	void Init(int32 Capacity);
+	void Add(const FStatHistoryEntry& Entry);
+	void Reset();
+
+	int32 Num() const { return Count; }
+
+	/* Index 0 is the newest entry */
+	const FStatHistoryEntry& GetFromNewest(int32 Index) const;
+
+private:
+	TArray<FStatHistoryEntry> Entries;
+
+	// slot the next entry is written to
+	int32 Head = 0;
+	int32 Count = 0;
+};
+
+/* Copy of everything a stats component's modifier totals depend on. Evaluate() only reads the copy, so snapshots of
+ * many components can be evaluated in parallel and written back on the game thread */
+struct UNIVERSALACTIONSYSTEM_API FStatMagnitudeSnapshot
+{
+	struct FEffectEntry
+	{
+		TArray<FStatModifier> Modifiers;
+		int32 Stacks = 0;
+	};
+
+	TArray<FGameplayTag> StatTags;
+	TArray<float> BaseValues;
+	TArray<FEffectEntry> Effects;
+
+	/* Modifier total of each stat, filled by Evaluate() */
+	TArray<float> Magnitudes;
+
+	void Evaluate();
+};
+
 UCLASS( ClassGroup=(ActionSystem), meta=(BlueprintSpawnableComponent) )
 class UNIVERSALACTIONSYSTEM_API UStatsComponent : public UActorComponent
 {
@@ -103,9 +238,91 @@ public:
 	UPROPERTY(BlueprintAssignable)
 	FOnStatEffectStackChange OnEffectStackChange;
 
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Replicated, meta=(TitleProperty="Stat", Categories="Stat"))
+	/* Fires when values change without an OnStatChanged per stat: new modifier totals, and Stats replicating to the owner */
+	FOnStatValuesUpdated OnStatValuesUpdated;
+
+	/* Unique values of this component. Empty while the shared StatInitRow values are in use, so read GetStats */
+	UPROPERTY(EditAnywhere, ReplicatedUsing=OnRep_Stats, meta=(TitleProperty="Stat", Categories="Stat"))
 	TArray<FStat> Stats;
 
+	/* Archetype the stats are initialised from instead of Stats. Components with the same row, curves and level share
+	 * one read-only copy of the resolved values and copy it into Stats the first time one of their stats changes */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta=(RowType="StatInitRow"))
+	FDataTableRowHandle StatInitRow;
+
+	/* Optional per level values for StatInitRow, see FStatInitEntry */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	UCurveTable* StatInitCurves = nullptr;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, ReplicatedUsing=OnRep_StatLevel, meta=(ClampMin=1))
+	int32 StatLevel = 1;
+
+	/* Re-initialises the stats from StatInitRow at NewLevel. Changes made to the stats so far are dropped.
+	 * Does nothing without a StatInitRow */
+	UFUNCTION(BlueprintCallable)
+	void SetStatLevel(int32 NewLevel);
+
+	UFUNCTION(BlueprintCallable, Server, Reliable)
+	void SetStatLevel_Server(int32 NewLevel);
+
+	/* The stats in effect: Stats, or the shared archetype values while none of them has changed */
+	const TArray<FStat>& GetStats() const;
+
+	UFUNCTION(BlueprintPure, meta=(DisplayName="Get Stats"))
+	TArray<FStat> K2_GetStats() const;
+
+	/* Adds Stat, or replaces the stat with the same tag, after copying the shared archetype values. Meant for setup:
+	 * modifier totals and derived stats are not recomputed */
+	void AddStat(const FStat& Stat);
+
+	// History
+
+	/* Changes kept per stat in StatHistoryStats, 0 disables the history. The buffers are allocated at BeginPlay, after
+	 * which recording does not allocate. Changes are recorded where base values are written, i.e. on the server */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta=(ClampMin=0))
+	int32 StatHistoryCapacity = 0;
+
+	/* Stats whose changes are recorded, e.g. health for a damage meter */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta=(Categories="Stat"))
+	FGameplayTagContainer StatHistoryStats;
+
+	/* Recorded changes of Stat, oldest first */
+	UFUNCTION(BlueprintCallable)
+	void GetStatHistory(FGameplayTag Stat, TArray<FStatHistoryEntry>& OutEntries) const;
+
+	/* Sum of NewValue - OldValue over the recorded changes of the last Seconds */
+	UFUNCTION(BlueprintCallable, BlueprintPure)
+	float GetStatChangeInWindow(FGameplayTag Stat, float Seconds) const;
+
+	/* Amount of Stat lost per second over the last Seconds, e.g. damage per second for health. Gains are ignored */
+	UFUNCTION(BlueprintCallable, BlueprintPure)
+	float GetStatLossPerSecond(FGameplayTag Stat, float Seconds) const;
+
+	UFUNCTION(BlueprintCallable)
+	void ClearStatHistory();
+
+	/* Recorded buffer of Stat, null when it is not tracked */
+	const FStatHistoryBuffer* FindStatHistory(FGameplayTag Stat) const;
+
+	/* Stats computed from other stats. The server recomputes only the stats downstream of a change, each once, in
+	 * dependency order. Cycles are reported and left out. Use SetDerivedStats to change them at runtime */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta=(TitleProperty="Stat"))
+	TArray<FDerivedStat> DerivedStats;
+
+	UFUNCTION(BlueprintCallable)
+	void SetDerivedStats(const TArray<FDerivedStat>& NewDerivedStats);
+
+	// Transactions
+
+	/* While a transaction is open, derived stats are only marked dirty; they are recomputed once when the outermost
+	 * transaction ends. Prefer FScopedStatTransaction */
+	void BeginStatTransaction();
+	void EndStatTransaction();
+	bool IsInStatTransaction() const;
+
+	/* Recomputes the derived stats whose inputs changed */
+	void FlushDerivedStats();
+
 	UFUNCTION(BlueprintCallable)
 	void ModifyStatAdditive(FGameplayTag Stat, float Value);
 
@@ -130,12 +347,34 @@ public:
 	UFUNCTION(BlueprintCallable)
 	bool ApplyStatEffect(TSubclassOf<UStatEffect> EffectToApply, AActor* EffectCauser, APawn* EffectInstigator);
 
+	/* Applies one effect to many targets, e.g. everything an area of effect overlaps. The modifier list is copied
+	 * once unless GetModifiers is overridden, which is then called per target; magnitude expressions are always
+	 * evaluated per target. Modifier totals are recalculated once per target for the whole batch and notifications
+	 * are sent after every target has its effect. Clients send the batch to the server in one call.
+	 * Returns the number of targets affected */
+	UFUNCTION(BlueprintCallable)
+	static int32 ApplyStatEffectToTargets(const TArray<UStatsComponent*>& Targets, TSubclassOf<UStatEffect> EffectToApply, AActor* EffectCauser, APawn* EffectInstigator);
+
 	UFUNCTION(BlueprintCallable)
 	bool RemoveStatEffect(TSubclassOf<UStatEffect> EffectToRemove);
 
+	/* True when the asset dependencies declared by EffectClass are in memory */
+	UFUNCTION(BlueprintCallable, BlueprintPure)
+	static bool AreStatEffectAssetsLoaded(TSubclassOf<UStatEffect> EffectClass);
+
 	UFUNCTION()
 	void RecalculateModifiers();
 
+	/* RecalculateModifiers for many components. From ActionSystem.Effects.ParallelMagnitudeThreshold targets on the
+	 * magnitudes are snapshotted, evaluated in parallel and written back on the calling thread */
+	static void RecalculateModifiersForTargets(TArrayView<UStatsComponent* const> Targets);
+
+	/* Evaluates the snapshots, in parallel when bParallel is set */
+	static void EvaluateMagnitudeSnapshots(TArrayView<FStatMagnitudeSnapshot> Snapshots, bool bParallel);
+
+	void MakeMagnitudeSnapshot(FStatMagnitudeSnapshot& OutSnapshot) const;
+	void ApplyMagnitudeSnapshot(const FStatMagnitudeSnapshot& Snapshot);
+
 	UFUNCTION(BlueprintCallable, BlueprintPure)
 	int GetEffectStacksByClass(TSubclassOf<UStatEffect> EffectClass);
 
@@ -149,10 +388,21 @@ protected:
 	// Called when the game starts
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 private:
 	UFUNCTION(Server, Reliable)
 	void ApplyStatEffect_Server(TSubclassOf<UStatEffect> EffectToApply, AActor* inEffectCauser, APawn* inEffectInstigator);
 
+	/* Sent through a target this client owns. The server drops the batch unless the causer and instigator belong to
+	 * the sending connection, and applies the effect only to targets passing IsClientBatchTargetAllowed */
+	UFUNCTION(Server, Reliable)
+	void ApplyStatEffectToTargets_Server(const TArray<UStatsComponent*>& Targets, TSubclassOf<UStatEffect> EffectToApply, AActor* inEffectCauser, APawn* inEffectInstigator);
+
+	/* Targets the sender owns, or that are within ActionSystem.Effects.ClientBatchRange of its instigator and
+	 * relevant to its connection */
+	bool IsClientBatchTargetAllowed(const UStatsComponent* Target, UNetConnection* Connection, const APawn* EffectInstigator) const;
+
 	UFUNCTION(Server, Reliable)
 	void RemoveStatEffect_Server(TSubclassOf<UStatEffect> EffectToRemove);
 	
@@ -161,10 +411,81 @@ private:
 
 	UFUNCTION()
 	void OnRep_ActiveEffects();
+
+	UFUNCTION()
+	void OnRep_Stats();
 	
 	UFUNCTION()
 	void EffectRemoved(UStatEffect* Effect);
 
+	UFUNCTION()
+	void OnRep_StatLevel();
+
+	/* Points the component at the shared values of StatInitRow at StatLevel */
+	void ResolveInitialStats();
+
+	const FStat* FindStat(FGameplayTag Stat) const;
+
+	/* Copies the shared archetype values into Stats if they are still in use, before a stat is written */
+	void MakeStatsUnique();
+	FStat* FindMutableStat(FGameplayTag Stat);
+
+	// resolved StatInitRow values, used while Stats is empty
+	TSharedPtr<const TArray<FStat>> SharedStats;
+
+	/* Allocates a buffer of StatHistoryCapacity for every stat in StatHistoryStats */
+	void InitializeStatHistory();
+
+	void RecordStatHistory(FGameplayTag Stat, float OldValue, float NewValue);
+
+	/* Records, traces and broadcasts a base value change */
+	void NotifyStatValueChanged(FGameplayTag Stat, float OldValue, float NewValue);
+
+	TMap<FGameplayTag, FStatHistoryBuffer> StatHistory;
+
+	// source of the changes being written, set by FScopedStatChangeSource
+	UStatEffect* StatChangeEffect = nullptr;
+	AActor* StatChangeInstigator = nullptr;
+
+	friend struct FScopedStatChangeSource;
+
+	/* Stacks or creates the effect without recalculating or notifying. Modifiers are shared by batched applies,
+	 * which also send their own server call instead of one per target when bSendToServer is false */
+	bool ApplyStatEffectInternal(TSubclassOf<UStatEffect> EffectToApply, AActor* EffectCauser, APawn* EffectInstigator,
+		const TArray<FStatModifier>* Modifiers, UStatEffect*& OutEffect, bool& bOutStacked, bool bSendToServer = true);
+
+	void NotifyStatEffectApplied(UStatEffect* Effect, bool bStacked);
+
+	/* Sets the modifier total of the stat at StatIndex. Returns false when it kept its value */
+	bool WriteModifierMagnitude(int32 StatIndex, float Magnitude);
+
+	/* Writes a base value and notifies. Returns false when the stat does not exist or kept its value */
+	bool WriteStatValue(FGameplayTag Stat, float NewValue);
+
+	/* Marks the derived stats reading Stat dirty and flushes them unless a transaction or flush is open */
+	void MarkStatChanged(FGameplayTag Stat);
+
+	/* Orders DerivedStats so every stat comes after the derived stats it reads */
+	void BuildDerivedStatGraph();
+
+	/* Whether the derived stat at Index reads itself through the edges in DownstreamOf */
+	bool IsDerivedStatOnCycle(int32 Index, const TMultiMap<int32, int32>& DownstreamOf) const;
+
+	// indices into DerivedStats in evaluation order; stats in a cycle are missing
+	TArray<int32> DerivedStatOrder;
+
+	// derived stats to recompute when the key stat changes
+	TMultiMap<FGameplayTag, int32> DerivedStatDependents;
+
+	TBitArray<> DirtyDerivedStats;
+
+	int32 StatTransactionDepth = 0;
+	bool bFlushingDerivedStats = false;
+
+	// set while applying an effect, so stack changes leave the recalculation to the caller
+	bool bDeferModifierRecalculation = false;
+	bool bModifierRecalculationPending = false;
+
 public:	
 	// Called every frame
 	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
@@ -172,6 +493,11 @@ public:
 		
 };
 
+inline const TArray<FStat>& UStatsComponent::GetStats() const
+{
+	return SharedStats.IsValid() && Stats.Num() == 0 ? *SharedStats : Stats;
+}
+
 inline UStatEffect* UStatsComponent::GetActiveEffectByClass(TSubclassOf<UStatEffect> EffectClass)
 {
 	for (UStatEffect* Effect : ActiveEffects)
@@ -183,3 +509,63 @@ inline UStatEffect* UStatsComponent::GetActiveEffectByClass(TSubclassOf<UStatEff
 	}
 	return nullptr;
 }
+
+/* Opens a stat transaction on the component for the lifetime of the scope */
+struct UNIVERSALACTIONSYSTEM_API FScopedStatTransaction
+{
+	explicit FScopedStatTransaction(UStatsComponent* InComponent)
+		: Component(InComponent)
+	{
+		if (Component)
+		{
+			Component->BeginStatTransaction();
+		}
+	}
+
+	~FScopedStatTransaction()
+	{
+		if (Component)
+		{
+			Component->EndStatTransaction();
+		}
+	}
+
+	FScopedStatTransaction(const FScopedStatTransaction&) = delete;
+	FScopedStatTransaction& operator=(const FScopedStatTransaction&) = delete;
+
+private:
+	UStatsComponent* Component;
+};
+
+/* Attributes the stat changes made in the scope to an effect and instigator in the stat history */
+struct UNIVERSALACTIONSYSTEM_API FScopedStatChangeSource
+{
+	FScopedStatChangeSource(UStatsComponent* InComponent, UStatEffect* Effect, AActor* Instigator)
+		: Component(InComponent)
+	{
+		if (Component)
+		{
+			PreviousEffect = Component->StatChangeEffect;
+			PreviousInstigator = Component->StatChangeInstigator;
+			Component->StatChangeEffect = Effect;
+			Component->StatChangeInstigator = Instigator;
+		}
+	}
+
+	~FScopedStatChangeSource()
+	{
+		if (Component)
+		{
+			Component->StatChangeEffect = PreviousEffect;
+			Component->StatChangeInstigator = PreviousInstigator;
+		}
+	}
+
+	FScopedStatChangeSource(const FScopedStatChangeSource&) = delete;
+	FScopedStatChangeSource& operator=(const FScopedStatChangeSource&) = delete;
+
+private:
+	UStatsComponent* Component;
+	UStatEffect* PreviousEffect = nullptr;
+	AActor* PreviousInstigator = nullptr;
+};
@@ -7,6 +7,7 @@
 #include "Templates/SubclassOf.h"
 #include "GameplayTask.h"
 #include "ActionBase.h"
+#include "UniversalActionSystem.h"
 #include "ActionTask.generated.h"
 
 class UActionSystemComponent;
@@ -57,6 +58,7 @@ public:
 	{
 		check(ThisAction);
 
+		LLM_SCOPE_BYTAG(ActionSystem_Tasks);
 		T* MyObj = NewObject<T>();
 		MyObj->InitTask(*ThisAction, ThisAction->GetGameplayTaskDefaultPriority());
 		MyObj->InstanceName = InstanceName;
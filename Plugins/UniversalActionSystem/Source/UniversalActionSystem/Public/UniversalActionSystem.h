@@ -4,8 +4,70 @@
 
 #include "CoreMinimal.h"
 #include "Modules/ModuleManager.h"
+#include "HAL/LowLevelMemTracker.h"
+#include "ProfilingDebugging/CsvProfiler.h"
 
 DECLARE_STATS_GROUP(TEXT("STANFORD_Game"), STATGROUP_STANFORD, STATCAT_Advanced);
+DECLARE_STATS_GROUP(TEXT("ActionSystem"), STATGROUP_ActionSystem, STATCAT_Advanced);
+
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Granted Actions"), STAT_ActionSystem_GrantedActions, STATGROUP_ActionSystem, UNIVERSALACTIONSYSTEM_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Running Actions"), STAT_ActionSystem_RunningActions, STATGROUP_ActionSystem, UNIVERSALACTIONSYSTEM_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Action Objects"), STAT_ActionSystem_ActionObjects, STATGROUP_ActionSystem, UNIVERSALACTIONSYSTEM_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Action Tasks"), STAT_ActionSystem_ActiveTasks, STATGROUP_ActionSystem, UNIVERSALACTIONSYSTEM_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Active Stat Effects"), STAT_ActionSystem_ActiveEffects, STATGROUP_ActionSystem, UNIVERSALACTIONSYSTEM_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Stat Effect Objects"), STAT_ActionSystem_EffectObjects, STATGROUP_ActionSystem, UNIVERSALACTIONSYSTEM_API);
+
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Action Object Memory"), STAT_ActionSystem_ActionObjectMemory, STATGROUP_ActionSystem, UNIVERSALACTIONSYSTEM_API);
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Action Component Storage"), STAT_ActionSystem_ComponentMemory, STATGROUP_ActionSystem, UNIVERSALACTIONSYSTEM_API);
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Stat Effect Object Memory"), STAT_ActionSystem_EffectObjectMemory, STATGROUP_ActionSystem, UNIVERSALACTIONSYSTEM_API);
+
+/* Per-frame counts for -csvprofile captures */
+CSV_DECLARE_CATEGORY_MODULE_EXTERN(UNIVERSALACTIONSYSTEM_API, ActionSystem);
+
+/* Low level memory tracker tags; allocations made while granting, starting and applying are reported under these */
+LLM_DECLARE_TAG_API(ActionSystem, UNIVERSALACTIONSYSTEM_API);
+LLM_DECLARE_TAG_API(ActionSystem_Actions, UNIVERSALACTIONSYSTEM_API);
+LLM_DECLARE_TAG_API(ActionSystem_Effects, UNIVERSALACTIONSYSTEM_API);
+LLM_DECLARE_TAG_API(ActionSystem_Tasks, UNIVERSALACTIONSYSTEM_API);
+
+/* Running totals read by ActionSystem.NetBench. RPCs are counted on the process that executes them */
+struct UNIVERSALACTIONSYSTEM_API FActionSystemNetCounters
+{
+	static uint64 ServerActionRPCs;
+	static uint64 ServerStatRPCs;
+
+	/* Set while a net benchmark measures; replication is only timed while it is */
+	static bool bRecordReplication;
+
+	/* Cycles and calls spent replicating objects, by class */
+	static TMap<FName, TPair<uint64, uint64>> ReplicationCycles;
+
+	static void RecordReplication(const UObject* Object, uint32 Cycles);
+
+	static void Reset();
+};
+
+/* Adds the time until the end of the scope to FActionSystemNetCounters::ReplicationCycles while it records */
+struct FActionReplicationTimerScope
+{
+	explicit FActionReplicationTimerScope(const UObject* InObject)
+		: Object(FActionSystemNetCounters::bRecordReplication ? InObject : nullptr)
+		, StartCycles(Object ? FPlatformTime::Cycles() : 0)
+	{
+	}
+
+	~FActionReplicationTimerScope()
+	{
+		if (Object)
+		{
+			FActionSystemNetCounters::RecordReplication(Object, FPlatformTime::Cycles() - StartCycles);
+		}
+	}
+
+private:
+	const UObject* Object;
+	uint32 StartCycles;
+};
 
 
 class FUniversalActionSystemModule : public IModuleInterface
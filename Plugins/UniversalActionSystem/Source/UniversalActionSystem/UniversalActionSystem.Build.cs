@@ -39,7 +39,11 @@ public class UniversalActionSystem : ModuleRules
 				"Slate",
 				"SlateCore",
 				"GameplayTags", 
-				"GameplayTasks"
+				"GameplayTasks",
+				"NetCore",
+				"Json",
+				"Projects",
+				"TraceLog"
 				// ... add private dependencies that you statically link with here ...	
 			}
 			);
@@ -0,0 +1,92 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "ActionSystemCore.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace ActionSystemCore;
+
+namespace
+{
+	using FClock = std::chrono::steady_clock;
+
+	// keeps the optimizer from dropping the measured work
+	volatile float Sink = 0.0f;
+
+	template<typename FunctionType>
+	void Measure(const char* Name, long long Iterations, FunctionType&& Function)
+	{
+		const FClock::time_point Start = FClock::now();
+		Function(Iterations);
+		const double Seconds = std::chrono::duration<double>(FClock::now() - Start).count();
+		std::printf("%-24s %12lld iterations %10.3f ms %8.2f ns/iteration\n", Name, Iterations, Seconds * 1000.0, Seconds * 1e9 / static_cast<double>(Iterations));
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const long long Iterations = argc > 1 ? std::atoll(argv[1]) : 10000000;
+	if (Iterations <= 0)
+	{
+		std::printf("Usage: %s [iterations]\n", argv[0]);
+		return 1;
+	}
+
+	// one modifier of each kind, like the totals RecalculateModifiers builds per stat
+	Measure("ModifierMagnitude", Iterations, [](long long Count)
+	{
+		float Total = 0.0f;
+		for (long long i = 0; i < Count; i++)
+		{
+			const EModifyOp Op = static_cast<EModifyOp>(i & 3);
+			Total += ModifierMagnitude(Op, 1.5f, static_cast<int32_t>(i & 7) + 1, 100.0f);
+		}
+		Sink = Total;
+	});
+
+	Measure("BaseValueDelta+Clamp", Iterations, [](long long Count)
+	{
+		float Value = 50.0f;
+		for (long long i = 0; i < Count; i++)
+		{
+			const EModifyOp Op = (i & 1) ? EModifyOp::Add : EModifyOp::Subtract;
+			Value = ClampStatValue(Value + BaseValueDelta(Op, 1.0f, Value), 100.0f);
+		}
+		Sink = Value;
+	});
+
+	// the per-tick work of many live stacking effects
+	Measure("EffectStack", Iterations, [](long long Count)
+	{
+		FEffectSpec Spec;
+		Spec.Duration = 2.0f;
+		Spec.MaxStacks = 5;
+		Spec.StackAddResponse = EStackResponse::ResetDuration;
+		std::vector<FEffectStack> Stacks(256);
+		for (FEffectStack& Stack : Stacks)
+		{
+			Stack.ResetDuration(Spec);
+		}
+
+		int32_t Expired = 0;
+		for (long long i = 0; i < Count; i++)
+		{
+			FEffectStack& Stack = Stacks[static_cast<size_t>(i) & 255];
+			if (!Stack.AddStack(Spec))
+			{
+				Stack.RemoveStack(Spec);
+			}
+			if (Stack.ConsumeDuration(0.25f))
+			{
+				Expired++;
+				Stack.ResetDuration(Spec);
+			}
+		}
+		Sink = static_cast<float>(Expired);
+	});
+
+	return 0;
+}
@@ -0,0 +1,171 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "ActionSystemCore.h"
+
+#include <cmath>
+#include <cstdio>
+
+using namespace ActionSystemCore;
+
+namespace
+{
+	int Failures = 0;
+
+	void Check(bool bCondition, const char* Expression, const char* File, int Line)
+	{
+		if (!bCondition)
+		{
+			std::printf("%s:%d: check failed: %s\n", File, Line, Expression);
+			Failures++;
+		}
+	}
+
+	bool NearlyEqual(float A, float B)
+	{
+		return std::fabs(A - B) <= 1e-4f;
+	}
+
+	FEffectSpec MakeSpec(EDurationKind DurationType, float Duration, int32_t MaxStacks)
+	{
+		FEffectSpec Spec;
+		Spec.DurationType = DurationType;
+		Spec.Duration = Duration;
+		Spec.MaxStacks = MaxStacks;
+		return Spec;
+	}
+}
+
+#define CHECK(Expression) Check((Expression), #Expression, __FILE__, __LINE__)
+
+static void TestModifierMagnitude()
+{
+	CHECK(NearlyEqual(ModifierMagnitude(EModifyOp::Add, 5.0f, 3, 100.0f), 15.0f));
+	CHECK(NearlyEqual(ModifierMagnitude(EModifyOp::Subtract, 5.0f, 2, 100.0f), -10.0f));
+	// Multiply and Divide are relative to the base value
+	CHECK(NearlyEqual(ModifierMagnitude(EModifyOp::Multiply, 2.0f, 1, 50.0f), 50.0f));
+	CHECK(NearlyEqual(ModifierMagnitude(EModifyOp::Divide, 2.0f, 1, 50.0f), -25.0f));
+	// no stacks contribute nothing, and never divide by zero
+	CHECK(ModifierMagnitude(EModifyOp::Add, 5.0f, 0, 100.0f) == 0.0f);
+	CHECK(ModifierMagnitude(EModifyOp::Multiply, 2.0f, 0, 100.0f) == 0.0f);
+	CHECK(ModifierMagnitude(EModifyOp::Divide, 2.0f, 0, 100.0f) == 0.0f);
+	CHECK(ModifierMagnitude(EModifyOp::Divide, 2.0f, -1, 100.0f) == 0.0f);
+}
+
+static void TestBaseValueDelta()
+{
+	CHECK(NearlyEqual(BaseValueDelta(EModifyOp::Add, 5.0f, 10.0f), 5.0f));
+	CHECK(NearlyEqual(BaseValueDelta(EModifyOp::Subtract, 5.0f, 10.0f), -5.0f));
+	CHECK(NearlyEqual(BaseValueDelta(EModifyOp::Multiply, 3.0f, 10.0f), 20.0f));
+	CHECK(NearlyEqual(BaseValueDelta(EModifyOp::Divide, 4.0f, 10.0f), -7.5f));
+	CHECK(NearlyEqual(10.0f + BaseValueDelta(EModifyOp::Multiply, 0.5f, 10.0f), 5.0f));
+}
+
+static void TestClampStatValue()
+{
+	CHECK(ClampStatValue(50.0f, 100.0f) == 50.0f);
+	CHECK(ClampStatValue(150.0f, 100.0f) == 100.0f);
+	CHECK(ClampStatValue(100.0f, 100.0f) == 100.0f);
+	// there is no lower bound
+	CHECK(ClampStatValue(-20.0f, 100.0f) == -20.0f);
+}
+
+static void TestEffectSpec()
+{
+	CHECK(MakeSpec(EDurationKind::HasDuration, 2.0f, 0).ManagesDuration());
+	CHECK(!MakeSpec(EDurationKind::HasDuration, 0.0f, 0).ManagesDuration());
+	CHECK(MakeSpec(EDurationKind::HasDuration, 0.0f, 0).IsInfinite());
+	CHECK(!MakeSpec(EDurationKind::Instant, 2.0f, 0).ManagesDuration());
+	CHECK(MakeSpec(EDurationKind::Instant, 2.0f, 0).GetDuration() == 0.0f);
+	CHECK(MakeSpec(EDurationKind::Infinite, 2.0f, 0).AllowsStacking());
+	CHECK(!MakeSpec(EDurationKind::Instant, 2.0f, 0).ShouldApplyAsMagnitude());
+	// infinite effects tick into the base value while they have a period
+	FEffectSpec Infinite = MakeSpec(EDurationKind::Infinite, 0.0f, 0);
+	CHECK(Infinite.IsPeriodic());
+	CHECK(!Infinite.ShouldApplyAsMagnitude());
+	Infinite.Period = 0.0f;
+	CHECK(!Infinite.IsPeriodic());
+	CHECK(Infinite.ShouldApplyAsMagnitude());
+}
+
+static void TestEffectStack()
+{
+	FEffectSpec Spec = MakeSpec(EDurationKind::HasDuration, 4.0f, 3);
+	FEffectStack Stack;
+	CHECK(Stack.ResetDuration(Spec));
+	CHECK(Stack.RemainingDuration == 4.0f);
+
+	// keeps the remaining duration unless asked to reset it
+	CHECK(!Stack.ConsumeDuration(1.0f));
+	CHECK(Stack.AddStack(Spec));
+	CHECK(Stack.Stacks == 2);
+	CHECK(Stack.RemainingDuration == 3.0f);
+
+	Spec.StackAddResponse = EStackResponse::ResetDuration;
+	CHECK(Stack.AddStack(Spec));
+	CHECK(Stack.Stacks == 3);
+	CHECK(Stack.RemainingDuration == 4.0f);
+
+	// overflow is refused, and only resets when configured to
+	CHECK(!Stack.ConsumeDuration(1.0f));
+	CHECK(!Stack.AddStack(Spec));
+	CHECK(Stack.Stacks == 3);
+	CHECK(Stack.RemainingDuration == 3.0f);
+	Spec.StackOverflowResponse = EStackResponse::ResetDuration;
+	CHECK(!Stack.AddStack(Spec));
+	CHECK(Stack.RemainingDuration == 4.0f);
+
+	Spec.StackRemoveResponse = EStackResponse::ResetDuration;
+	CHECK(!Stack.ConsumeDuration(2.0f));
+	CHECK(Stack.RemoveStack(Spec));
+	CHECK(Stack.Stacks == 2);
+	CHECK(Stack.RemainingDuration == 4.0f);
+	CHECK(Stack.RemoveStack(Spec));
+	// the last stack is only removed by expiring
+	CHECK(!Stack.RemoveStack(Spec));
+	CHECK(Stack.Stacks == 1);
+
+	CHECK(!Stack.IsExpired());
+	CHECK(Stack.ConsumeDuration(4.0f));
+	CHECK(Stack.IsExpired());
+
+	Stack.RemainingDuration = 1.0f;
+	Stack.Clear();
+	CHECK(Stack.IsExpired());
+	// a fresh stack always starts with the full duration
+	Spec.StackAddResponse = EStackResponse::None;
+	CHECK(Stack.AddStack(Spec));
+	CHECK(Stack.Stacks == 1);
+	CHECK(Stack.RemainingDuration == 4.0f);
+
+	// effects that do not count down never stack
+	FEffectStack InstantStack;
+	CHECK(!InstantStack.AddStack(MakeSpec(EDurationKind::Instant, 4.0f, 0)));
+	CHECK(!InstantStack.ResetDuration(MakeSpec(EDurationKind::Instant, 4.0f, 0)));
+	CHECK(InstantStack.Stacks == 1);
+
+	// 0 max stacks means unlimited
+	FEffectSpec Unlimited = MakeSpec(EDurationKind::HasDuration, 1.0f, 0);
+	FEffectStack UnlimitedStack;
+	for (int32_t i = 0; i < 100; i++)
+	{
+		CHECK(UnlimitedStack.AddStack(Unlimited));
+	}
+	CHECK(UnlimitedStack.Stacks == 101);
+}
+
+int main()
+{
+	TestModifierMagnitude();
+	TestBaseValueDelta();
+	TestClampStatValue();
+	TestEffectSpec();
+	TestEffectStack();
+
+	if (Failures > 0)
+	{
+		std::printf("%d check(s) failed\n", Failures);
+		return 1;
+	}
+	std::printf("All checks passed\n");
+	return 0;
+}